@@ -29,21 +29,99 @@
 #ifndef LIBOPENCAD_CADFILE_HPP
 #define LIBOPENCAD_CADFILE_HPP
 
+#include "cadlayer.hpp"
+#include "internal/io/cadentitystream.hpp"
+#include "internal/io/cadgeometrysource.hpp"
+#include "internal/io/cadspatialindex.hpp"
+
+#include <functional>
+#include <mutex>
+
 namespace libopencad
 {
 
+    /*
+     * Outcome of a CADFile::VisitEntities() pass. The color and layer filters count model
+     * space entities only. Types left out are counted from the object directory without
+     * reading the entities, so those counts also take in block and layout entities.
+     */
+    struct CADVisitStatistics
+    {
+        size_t  visitedCount;
+        size_t  damagedCount;   // skipped entities, also the ones on a layer missing from the table
+        size_t  filteredCount;  // entities left out by the filter without decoding their geometry
+        size_t  filteredBytes;  // data bytes of those entities
+    };
+
+
+    using CADEntityVisitor = std::function<void(const CADLayerData& layer, const CADGeometry& geometry)>;
+
+
+    /*
+     * R2000 drawing opened for reading its layers. Opening reads the file layout and the
+     * layer table only. Entities are assigned to layers on the first GetLayer() call by
+     * reading their common data, and decoded one by one as the layers are asked for them.
+     * Throws std::runtime_error if the drawing can not be read.
+     */
     class CADFile
     {
     public:
-        CADFile();
+        explicit CADFile(const std::string& path, const CADOpenOptions& options = CADOpenOptions());
+        explicit CADFile(const std::shared_ptr<ICADFileIO>& fileIO, const CADOpenOptions& options = CADOpenOptions());
 
+        size_t GetLayersCount() const;
         CADLayerPtr GetLayer(size_t idx);
 
+        /*
+         * Streams the model space entities to visitor in file order, reading the object
+         * data in one sequential pass. Each geometry is decoded for the call only and
+         * released once visitor returns, so memory stays flat whatever the count of
+         * entities. Needs neither GetLayer() nor the geometry cache. Only entities passing
+         * filter are decoded and visited.
+         */
+        CADVisitStatistics VisitEntities(const CADEntityVisitor& visitor,
+                                         const CADReadFilter& filter = CADReadFilter()) const;
+
+        // Entity by handle, through the geometry cache. nullptr if the handle is not an
+        // entity's or the entity is damaged.
+        CADGeometryPtr GetGeometry(uint64_t handle);
+
+        /*
+         * R-tree over the bounding boxes of the model space entities, built on the first
+         * call by CADOpenOptions::threadsCount workers and the calling thread. Queries give
+         * candidate handles for GetGeometry(). Drawings opened by path with useSidecarIndex
+         * reuse the index stored at the drawing path (or sidecarIndexPath) + ".rtree" while
+         * it matches the drawing, and (re)write it otherwise.
+         */
+        const CADSpatialIndex& GetSpatialIndex();
+
+        // True if GetSpatialIndex() loaded the index from its file
+        bool IsSpatialIndexLoaded() const
+        { return _spatialIndexLoaded; }
+
+        const CADFileReader& GetReader() const;
+        CADGeometryCacheStatistics GetGeometryCacheStatistics() const;
+
+    private:
+        CADFile(const CADFile&) = delete;
+        CADFile& operator=(const CADFile&) = delete;
+
+        void BuildLayers();
+        void BuildSpatialIndex();
+
     private:
+        std::shared_ptr<CADGeometrySource>  _source;
+        std::once_flag                      _layersBuilt;
+        std::vector<CADLayerPtr>            _layers;
 
+        std::string                         _path;      // empty if opened through a file
+        CADOpenOptions                      _options;
+        std::once_flag                      _spatialIndexBuilt;
+        CADSpatialIndex                     _spatialIndex;
+        bool                                _spatialIndexLoaded;
     };
     DECLARE_PTR(CADFile);
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -30,16 +30,83 @@
 #define LIBOPENCAD_CADGEOMETRY_HPP
 
 #include "internal/toolkit.hpp"
+#include "internal/objects/cadentityschemas.hpp"
+
+#include <memory>
 
 namespace libopencad
 {
 
+    /*
+     * Model space entity of a layer. Geometries are immutable, the same one may be handed
+     * out to several callers by a geometry cache.
+     */
     class CADGeometry
     {
+    public:
+        CADGeometry(CADObject::Type type, uint64_t handle, int16_t color);
+        virtual ~CADGeometry();
+
+        CADObject::Type GetType() const
+        { return _type; }
+
+        uint64_t GetHandle() const
+        { return _handle; }
+
+        // 0 BYBLOCK, 256 BYLAYER
+        int16_t GetColor() const
+        { return _color; }
+
+        // Bytes held by the geometry, what a geometry cache is charged for it
+        virtual size_t GetMemoryUsage() const;
 
+    private:
+        CADObject::Type _type;
+        uint64_t        _handle;
+        int16_t         _color;
     };
     DECLARE_PTR(CADGeometry);
 
+
+    // Heap memory held by decoded entity data besides the structure itself
+    template<typename Data>
+    size_t GetHeapMemoryUsage(const Data&)
+    { return 0; }
+
+    size_t GetHeapMemoryUsage(const CADLWPolylineData& data);
+    size_t GetHeapMemoryUsage(const CADTextData& data);
+
+
+    // Entity of a type with a schema, carrying the data decoded with it
+    template<typename Schema>
+    class CADEntityGeometry : public CADGeometry
+    {
+    public:
+        typedef typename Schema::ObjectType DataType;
+
+        CADEntityGeometry(uint64_t handle, int16_t color, DataType&& data)
+            : CADGeometry(Schema::TYPE, handle, color),
+              _data(std::move(data))
+        { }
+
+        const DataType& GetData() const
+        { return _data; }
+
+        virtual size_t GetMemoryUsage() const
+        { return sizeof(*this) + GetHeapMemoryUsage(_data); }
+
+    private:
+        DataType _data;
+    };
+
+
+    using CADLineGeometry = CADEntityGeometry<CADLineSchema>;
+    using CADCircleGeometry = CADEntityGeometry<CADCircleSchema>;
+    using CADArcGeometry = CADEntityGeometry<CADArcSchema>;
+    using CADLWPolylineGeometry = CADEntityGeometry<CADLWPolylineSchema>;
+    using CADTextGeometry = CADEntityGeometry<CADTextSchema>;
+    using CADInsertGeometry = CADEntityGeometry<CADInsertSchema>;
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_CADLAYER_HPP
+#define LIBOPENCAD_CADLAYER_HPP
+
+#include "cadgeometry.hpp"
+#include "internal/objects/cadtableschemas.hpp"
+
+#include <vector>
+
+namespace libopencad
+{
+
+    class CADGeometrySource;
+
+
+    /*
+     * Layer of an opened drawing. It keeps only the directory entries of its model space
+     * entities, a geometry is decoded when it is asked for. Thread-safe, the layer stays
+     * usable after its CADFile is gone.
+     */
+    class CADLayer
+    {
+    public:
+        CADLayer(const std::shared_ptr<CADGeometrySource>& source, const CADLayerData& data,
+                 std::vector<uint32_t>&& objects);
+
+        const std::string& GetName() const
+        { return _data.name; }
+
+        uint64_t GetHandle() const
+        { return _data.handle; }
+
+        int16_t GetColor() const
+        { return _data.color; }
+
+        int16_t GetFlags() const
+        { return _data.flags; }
+
+        // Entities in handle order
+        size_t GetGeometryCount() const
+        { return _objects.size(); }
+
+        uint64_t GetGeometryHandle(size_t idx) const;
+
+        // Decoded on every call unless the file keeps a geometry cache. Entity types without
+        // a schema come as a plain CADGeometry, nullptr if the entity is damaged.
+        CADGeometryPtr GetGeometry(size_t idx) const;
+
+        // Every geometry of the layer, decoded on threadsCount threads (0 means one per
+        // core) past the geometry cache. Same order and contents as GetGeometry(idx).
+        std::vector<CADGeometryPtr> GetGeometries(size_t threadsCount = 0) const;
+
+    private:
+        std::shared_ptr<CADGeometrySource>  _source;
+        CADLayerData                        _data;
+        std::vector<uint32_t>               _objects;   // indices into the object directory
+    };
+    DECLARE_PTR(CADLayer);
+
+}
+
+#endif
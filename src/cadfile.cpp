@@ -0,0 +1,212 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "libopencad/cadfile.hpp"
+#include "internal/objects/cadobjectheader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        // Layers are sorted by handle, nullptr if the table has no such layer
+        const CADLayerData* FindLayer(const std::vector<CADLayerData>& layers, uint64_t handle)
+        {
+            auto layer = std::lower_bound(layers.begin(), layers.end(), handle,
+                [](const CADLayerData& left, uint64_t right) { return left.handle < right; });
+
+            return layer != layers.end() && layer->handle == handle ? &*layer : nullptr;
+        }
+
+    }
+
+
+    CADFile::CADFile(const std::string& path, const CADOpenOptions& options)
+        : _source(std::make_shared<CADGeometrySource>(path, options)),
+          _path(path),
+          _options(options),
+          _spatialIndexLoaded(false)
+    { }
+
+
+    CADFile::CADFile(const std::shared_ptr<ICADFileIO>& fileIO, const CADOpenOptions& options)
+        : _source(std::make_shared<CADGeometrySource>(fileIO, options)),
+          _options(options),
+          _spatialIndexLoaded(false)
+    { }
+
+
+    size_t CADFile::GetLayersCount() const
+    { return _source->GetReader().GetLayers().size(); }
+
+
+    CADLayerPtr CADFile::GetLayer(size_t idx)
+    {
+        std::call_once(_layersBuilt, &CADFile::BuildLayers, this);
+
+        if (idx >= _layers.size())
+            throw std::runtime_error("CADFile: layer index is out of range");
+
+        return _layers[idx];
+    }
+
+
+    CADVisitStatistics CADFile::VisitEntities(const CADEntityVisitor& visitor, const CADReadFilter& filter) const
+    {
+        const CADFileReader& reader = _source->GetReader();
+        CADEntityStream stream(reader, filter);
+        CADVisitStatistics statistics = { 0, 0, 0, 0 };
+
+        CADGeometryPtr geometry;
+        uint64_t layerHandle = 0;
+        while (stream.Next(geometry, layerHandle))
+        {
+            const CADLayerData* layer = FindLayer(reader.GetLayers(), layerHandle);
+            if (layer == nullptr)
+            {
+                ++statistics.damagedCount;
+                continue;
+            }
+
+            visitor(*layer, *geometry);
+            geometry.reset();
+            ++statistics.visitedCount;
+        }
+
+        statistics.damagedCount += stream.GetDamagedCount();
+        statistics.filteredCount = stream.GetFilteredCount();
+        statistics.filteredBytes = stream.GetFilteredBytes();
+        return statistics;
+    }
+
+
+    CADGeometryPtr CADFile::GetGeometry(uint64_t handle)
+    {
+        const CADObjectDirectory& objects = _source->GetReader().GetLayout().objects;
+        size_t objectIdx = objects.Find(handle);
+        if (objectIdx == CADObjectDirectory::NPOS || !IsCADEntityType(static_cast<int16_t>(objects.GetType(objectIdx))))
+            return nullptr;
+
+        return _source->GetGeometry(objectIdx);
+    }
+
+
+    const CADSpatialIndex& CADFile::GetSpatialIndex()
+    {
+        std::call_once(_spatialIndexBuilt, &CADFile::BuildSpatialIndex, this);
+        return _spatialIndex;
+    }
+
+
+    const CADFileReader& CADFile::GetReader() const
+    { return _source->GetReader(); }
+
+
+    CADGeometryCacheStatistics CADFile::GetGeometryCacheStatistics() const
+    { return _source->GetStatistics(); }
+
+
+    void CADFile::BuildLayers()
+    {
+        const CADFileReader& reader = _source->GetReader();
+        const CADObjectDirectory& objects = reader.GetLayout().objects;
+        const std::vector<CADLayerData>& layers = reader.GetLayers();
+
+        // DWG keeps the layer of an entity in the entity only: the common data and the
+        // handle stream of every entity are read, the geometry is left for later
+        std::vector<std::vector<uint32_t>> layerObjects(layers.size());
+        for (int16_t type = CADObject::TEXT; type <= CADObject::HATCH; ++type)
+        {
+            if (!IsCADLayerEntityType(type))
+                continue;
+
+            const uint32_t* end = objects.GetTypeEnd(static_cast<uint8_t>(type));
+            for (const uint32_t* objectIdx = objects.GetTypeBegin(static_cast<uint8_t>(type)); objectIdx != end;
+                 ++objectIdx)
+            {
+                CADStickyBitStreamReader stream = reader.ReadObject(*objectIdx).SubReader<CADStickyErrorBounds>(
+                    0, objects.GetSize(*objectIdx));
+                stream.ReadBitShort();
+
+                CADObjectHeader objectHeader;
+                ReadCADObjectHeader(stream, objectHeader);
+
+                CADEntityHeader entityHeader;
+                ReadCADEntityHeader(stream, entityHeader);
+
+                // Only model space entities, the others belong to blocks and layouts
+                if (entityHeader.ownerMode != 2)
+                    continue;
+
+                uint64_t layerHandle = ReadCADEntityLayer(stream, objectHeader, entityHeader);
+                if (stream.GetError() != CADReadError::NONE)
+                    continue;
+
+                const CADLayerData* layer = FindLayer(layers, layerHandle);
+                if (layer != nullptr)
+                    layerObjects[layer - layers.data()].push_back(*objectIdx);
+            }
+        }
+
+        for (size_t layerIdx = 0; layerIdx < layers.size(); ++layerIdx)
+        {
+            std::vector<uint32_t>& entities = layerObjects[layerIdx];
+            std::sort(entities.begin(), entities.end());
+            entities.shrink_to_fit();
+            _layers.push_back(std::make_shared<CADLayer>(_source, layers[layerIdx], std::move(entities)));
+        }
+    }
+
+
+    void CADFile::BuildSpatialIndex()
+    {
+        const CADFileReader& reader = _source->GetReader();
+
+        CADFileStamp stamp;
+        std::string indexPath = (_options.sidecarIndexPath.empty() ? _path : _options.sidecarIndexPath) + ".rtree";
+        bool useIndex = _options.useSidecarIndex && !_path.empty() && GetCADFileStamp(_path, reader.GetFileIO(), stamp);
+
+        if (useIndex && LoadCADSpatialIndex(indexPath, stamp, _spatialIndex))
+        {
+            _spatialIndexLoaded = true;
+            return;
+        }
+
+        // The workers and the calling thread
+        _spatialIndex = BuildCADSpatialIndex(reader, _options.threadsCount == 0 ? 0 : _options.threadsCount + 1);
+
+        // A failed write only costs the next open a rebuild
+        if (useIndex)
+            WriteCADSpatialIndex(indexPath, stamp, _spatialIndex);
+    }
+
+}
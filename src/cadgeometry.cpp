@@ -0,0 +1,59 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "libopencad/cadgeometry.hpp"
+
+namespace libopencad
+{
+
+    CADGeometry::CADGeometry(CADObject::Type type, uint64_t handle, int16_t color)
+        : _type(type),
+          _handle(handle),
+          _color(color)
+    { }
+
+
+    CADGeometry::~CADGeometry()
+    { }
+
+
+    size_t CADGeometry::GetMemoryUsage() const
+    { return sizeof(*this); }
+
+
+    size_t GetHeapMemoryUsage(const CADLWPolylineData& data)
+    {
+        return data.points.capacity() * sizeof(CADPoint2D) + data.bulges.capacity() * sizeof(double) +
+               data.widths.capacity() * sizeof(CADLWPolylineWidth);
+    }
+
+
+    size_t GetHeapMemoryUsage(const CADTextData& data)
+    { return data.value.capacity(); }
+
+}
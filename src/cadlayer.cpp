@@ -0,0 +1,66 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "libopencad/cadlayer.hpp"
+#include "internal/io/cadgeometrysource.hpp"
+
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    CADLayer::CADLayer(const std::shared_ptr<CADGeometrySource>& source, const CADLayerData& data,
+                       std::vector<uint32_t>&& objects)
+        : _source(source),
+          _data(data),
+          _objects(std::move(objects))
+    { }
+
+
+    uint64_t CADLayer::GetGeometryHandle(size_t idx) const
+    {
+        if (idx >= _objects.size())
+            throw std::runtime_error("CADLayer: geometry index is out of range");
+
+        return _source->GetReader().GetLayout().objects.GetHandle(_objects[idx]);
+    }
+
+
+    CADGeometryPtr CADLayer::GetGeometry(size_t idx) const
+    {
+        if (idx >= _objects.size())
+            throw std::runtime_error("CADLayer: geometry index is out of range");
+
+        return _source->GetGeometry(_objects[idx]);
+    }
+
+
+    std::vector<CADGeometryPtr> CADLayer::GetGeometries(size_t threadsCount) const
+    { return _source->GetGeometries(_objects, threadsCount); }
+
+}
@@ -0,0 +1,569 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadbitkernels.hpp"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define LIBOPENCAD_HAVE_BMI2_KERNELS
+#define LIBOPENCAD_BMI2_TARGET __attribute__((target("bmi,bmi2"), flatten))
+#include <immintrin.h>
+#endif
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        /*
+         * The kernel bodies are written once in portable C++ and compiled for every
+         * instruction set. With BMI2 enabled the variable shifts and masks below become
+         * shlx/shrx/bzhi, which do not go through CL and the flags register.
+         */
+
+        // 64 bits of the stream starting at byte byteOffset, MSB first, zero padded past the end
+        inline uint64_t LoadWindow(const uint8_t* data, size_t size, size_t byteOffset)
+        {
+            uint64_t window = 0;
+
+            if (byteOffset + 8 <= size)
+            {
+                const uint8_t* bytes = data + byteOffset;
+                return (uint64_t(bytes[0]) << 56) | (uint64_t(bytes[1]) << 48) |
+                       (uint64_t(bytes[2]) << 40) | (uint64_t(bytes[3]) << 32) |
+                       (uint64_t(bytes[4]) << 24) | (uint64_t(bytes[5]) << 16) |
+                       (uint64_t(bytes[6]) << 8)  |  uint64_t(bytes[7]);
+            }
+
+            for (size_t idx = 0; idx < 8; ++idx)
+            {
+                window <<= 8;
+                if (byteOffset + idx < size)
+                    window |= data[byteOffset + idx];
+            }
+
+            return window;
+        }
+
+
+        // At least 57 valid bits starting at bit offset, left aligned
+        inline uint64_t Peek(const uint8_t* data, size_t size, size_t offset)
+        { return LoadWindow(data, size, offset / 8) << (offset % 8); }
+
+
+        inline uint64_t Field(uint64_t window, size_t start, size_t bitsCount)
+        { return (window << start) >> (64 - bitsCount); }
+
+
+        inline uint16_t SwapBytes16(uint64_t value)
+        { return static_cast<uint16_t>(((value & 0x00FF) << 8) | ((value & 0xFF00) >> 8)); }
+
+
+        inline uint32_t SwapBytes32(uint64_t value)
+        {
+            return static_cast<uint32_t>(((value & 0x000000FF) << 24) |
+                                         ((value & 0x0000FF00) << 8)  |
+                                         ((value & 0x00FF0000) >> 8)  |
+                                         ((value & 0xFF000000) >> 24));
+        }
+
+
+        /*
+         * BS/BL/BD values are decoded without branching on the 2 bit code: every
+         * possible payload is extracted and the code selects one of them through mask
+         * tables. On real data the codes are close to random, a branch per value would
+         * be mispredicted about half of the time.
+         */
+        const size_t   BITSHORT_SIZES[4]       = { 2 + 16, 2 + 8, 2, 2 };
+        const uint16_t BITSHORT_RAW_MASKS[4]   = { 0xFFFF, 0, 0, 0 };
+        const uint16_t BITSHORT_CHAR_MASKS[4]  = { 0, 0xFFFF, 0, 0 };
+        const uint16_t BITSHORT_CONSTANTS[4]   = { 0, 0, 0, 256 };
+
+        const size_t   BITLONG_SIZES[4]        = { 2 + 32, 2 + 8, 2, 2 };
+        const uint32_t BITLONG_RAW_MASKS[4]    = { 0xFFFFFFFF, 0, 0, 0 };
+        const uint32_t BITLONG_CHAR_MASKS[4]   = { 0, 0xFFFFFFFF, 0, 0 };
+
+        const size_t   BITDOUBLE_SIZES[4]      = { 2 + 64, 2, 2, 2 };
+        const uint64_t BITDOUBLE_RAW_MASKS[4]  = { 0xFFFFFFFFFFFFFFFFULL, 0, 0, 0 };
+        const uint64_t BITDOUBLE_CONSTANTS[4]  = { 0, 0x3FF0000000000000ULL /* 1.0 */, 0, 0 };
+
+        // DD: default, default with 4 or 6 low bytes patched, full raw double
+        const size_t   BITDOUBLEWD_SIZES[4]    = { 2, 2 + 32, 2 + 48, 2 + 64 };
+        const uint64_t BITDOUBLEWD_MASKS[4]    = { 0, 0xFFFFFFFFULL, 0xFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL };
+
+
+        inline uint64_t SwapBytes64(uint64_t value)
+        { return (uint64_t(SwapBytes32(value)) << 32) | SwapBytes32(value >> 32); }
+
+
+        inline size_t CountLeadingZeros(uint64_t value)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<size_t>(__builtin_clzll(value));
+#else
+            size_t result = 0;
+            for (; !(value & 0x8000000000000000ULL); value <<= 1)
+                ++result;
+            return result;
+#endif
+        }
+
+
+        // 64 bits at offset read as a little-endian raw double
+        inline uint64_t RawDoubleBits(const uint8_t* data, size_t size, size_t offset)
+        {
+            uint64_t low = SwapBytes32(Peek(data, size, offset) >> 32);
+            uint64_t high = SwapBytes32(Peek(data, size, offset + 32) >> 32);
+            return (high << 32) | low;
+        }
+
+
+        template<size_t BitsCount>
+        inline size_t ReadSmallFields(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count && position + BitsCount <= limit; ++idx)
+            {
+                values[idx] = static_cast<uint8_t>(Peek(data, size, position) >> (64 - BitsCount));
+                position += BitsCount;
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        inline size_t ReadBitShortsImpl(const uint8_t* data, size_t size, size_t& offset, int16_t* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                size_t bitcode = static_cast<size_t>(window >> 62);
+
+                if (position + BITSHORT_SIZES[bitcode] > limit)
+                    break;
+
+                uint16_t raw = SwapBytes16(Field(window, 2, 16));
+                uint16_t unsignedChar = static_cast<uint16_t>(Field(window, 2, 8));
+
+                values[idx] = static_cast<int16_t>((raw & BITSHORT_RAW_MASKS[bitcode]) |
+                                                   (unsignedChar & BITSHORT_CHAR_MASKS[bitcode]) |
+                                                   BITSHORT_CONSTANTS[bitcode]);
+                position += BITSHORT_SIZES[bitcode];
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        inline size_t ReadBitLongsImpl(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                size_t bitcode = static_cast<size_t>(window >> 62);
+
+                if (position + BITLONG_SIZES[bitcode] > limit)
+                    break;
+
+                uint32_t raw = SwapBytes32(Field(window, 2, 32));
+                uint32_t unsignedChar = static_cast<uint32_t>(Field(window, 2, 8));
+
+                values[idx] = static_cast<int32_t>((raw & BITLONG_RAW_MASKS[bitcode]) |
+                                                   (unsignedChar & BITLONG_CHAR_MASKS[bitcode]));
+                position += BITLONG_SIZES[bitcode];
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        inline size_t ReadBitDoublesImpl(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                size_t bitcode = static_cast<size_t>(window >> 62);
+
+                if (position + BITDOUBLE_SIZES[bitcode] > limit)
+                    break;
+
+                uint64_t bits = (RawDoubleBits(data, size, position + 2) & BITDOUBLE_RAW_MASKS[bitcode]) |
+                                BITDOUBLE_CONSTANTS[bitcode];
+
+                std::memcpy(&values[idx], &bits, sizeof(bits));
+                position += BITDOUBLE_SIZES[bitcode];
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        inline size_t ReadRawDoublesImpl(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count && position + 64 <= limit; ++idx)
+            {
+                uint64_t bits = RawDoubleBits(data, size, position);
+                std::memcpy(&values[idx], &bits, sizeof(bits));
+                position += 64;
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        inline size_t ReadBitDoublesWdImpl(const uint8_t* data, size_t size, size_t& offset, const double* defaults,
+                                           double* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                size_t bitcode = static_cast<size_t>(window >> 62);
+
+                if (position + BITDOUBLEWD_SIZES[bitcode] > limit)
+                    break;
+
+                uint64_t defaultBits;
+                std::memcpy(&defaultBits, &defaults[idx], sizeof(defaultBits));
+
+                uint64_t mask = BITDOUBLEWD_MASKS[bitcode];
+                uint64_t bits = (defaultBits & ~mask) | (RawDoubleBits(data, size, position + 2) & mask);
+
+                std::memcpy(&values[idx], &bits, sizeof(bits));
+                position += BITDOUBLEWD_SIZES[bitcode];
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        /*
+         * MC: little-endian groups of 7 bits, the high bit of every byte is a continuation
+         * flag and bit 6 of the last byte is the sign. The terminating byte is found with
+         * one scan of the continuation bits of a 7 byte window, then the groups are packed
+         * together by the Compactor, either a SWAR shift ladder or a single pext.
+         */
+        const uint64_t MCHAR_CONTINUATION_BITS = 0x8080808080808000ULL;
+
+
+        struct PortableMCharCompactor
+        {
+            // x holds bytesCount little-endian bytes with the continuation bits cleared
+            static uint64_t Compact(uint64_t x)
+            {
+                x = (x & 0x007F007F007F007FULL) | ((x & 0x7F007F007F007F00ULL) >> 1);
+                x = (x & 0x00003FFF00003FFFULL) | ((x & 0x3FFF00003FFF0000ULL) >> 2);
+                x = (x & 0x000000000FFFFFFFULL) | ((x & 0x0FFFFFFF00000000ULL) >> 4);
+                return x;
+            }
+        };
+
+
+        // Byte by byte decoder for values the 7 byte window does not hold
+        inline bool ReadLongMChar(const uint8_t* data, size_t size, size_t& position, int32_t& value)
+        {
+            const size_t limit = size * 8;
+            int64_t result = 0;
+
+            for (size_t idx = 0; idx < 8; ++idx)
+            {
+                if (position + 8 > limit)
+                    return false;
+
+                uint8_t byte = static_cast<uint8_t>(Peek(data, size, position) >> 56);
+                position += 8;
+
+                if (!(byte & 0x80))
+                {
+                    result |= static_cast<int64_t>(byte & 0x3F) << (idx * 7);
+
+                    if (byte & 0x40)
+                        result = -result;
+                    break;
+                }
+
+                result |= static_cast<int64_t>(byte & 0x7F) << (idx * 7);
+            }
+
+            value = static_cast<int32_t>(result);
+            return true;
+        }
+
+
+        template<typename Compactor>
+        inline size_t ReadMCharsImpl(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                uint64_t terminators = ~window & MCHAR_CONTINUATION_BITS;
+
+                if (!terminators)
+                {
+                    size_t end = position;
+                    if (!ReadLongMChar(data, size, end, values[idx]))
+                        break;
+
+                    position = end;
+                    continue;
+                }
+
+                size_t bitsCount = (CountLeadingZeros(terminators) / 8 + 1) * 8;
+                if (position + bitsCount > limit)
+                    break;
+
+                uint64_t x = SwapBytes64(window) & (~0ULL >> (64 - bitsCount)) & 0x7F7F7F7F7F7F7F7FULL;
+                uint64_t sign = (x >> (bitsCount - 2)) & 1;
+                x ^= sign << (bitsCount - 2);
+
+                int64_t result = static_cast<int64_t>((Compactor::Compact(x) ^ (0 - sign)) + sign);
+                values[idx] = static_cast<int32_t>(result);
+                position += bitsCount;
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        // MS: one or two little-endian words of 15 bits, the high bit is a continuation flag
+        inline size_t ReadMShortsImpl(const uint8_t* data, size_t size, size_t& offset, uint32_t* values, size_t count)
+        {
+            const size_t limit = size * 8;
+            size_t position = offset;
+            size_t idx = 0;
+
+            for (; idx < count; ++idx)
+            {
+                uint64_t window = Peek(data, size, position);
+                uint32_t low = SwapBytes16(window >> 48);
+                uint32_t high = SwapBytes16(window >> 32);
+                uint32_t continued = low >> 15;
+
+                size_t bitsCount = 16 << continued;
+                if (position + bitsCount > limit)
+                    break;
+
+                values[idx] = (low & 0x7FFF) | (((high & 0x7FFF) << 15) & (0 - continued));
+                position += bitsCount;
+            }
+
+            offset = position;
+            return idx;
+        }
+
+
+        size_t PortableRead2Bits(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count)
+        { return ReadSmallFields<2>(data, size, offset, values, count); }
+
+
+        size_t PortableRead3Bits(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count)
+        { return ReadSmallFields<3>(data, size, offset, values, count); }
+
+
+        size_t PortableReadBitShorts(const uint8_t* data, size_t size, size_t& offset, int16_t* values, size_t count)
+        { return ReadBitShortsImpl(data, size, offset, values, count); }
+
+
+        size_t PortableReadBitLongs(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        { return ReadBitLongsImpl(data, size, offset, values, count); }
+
+
+        size_t PortableReadBitDoubles(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        { return ReadBitDoublesImpl(data, size, offset, values, count); }
+
+
+        size_t PortableReadRawDoubles(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        { return ReadRawDoublesImpl(data, size, offset, values, count); }
+
+
+        size_t PortableReadBitDoublesWd(const uint8_t* data, size_t size, size_t& offset, const double* defaults,
+                                        double* values, size_t count)
+        { return ReadBitDoublesWdImpl(data, size, offset, defaults, values, count); }
+
+
+        size_t PortableReadMChars(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        { return ReadMCharsImpl<PortableMCharCompactor>(data, size, offset, values, count); }
+
+
+        size_t PortableReadMShorts(const uint8_t* data, size_t size, size_t& offset, uint32_t* values, size_t count)
+        { return ReadMShortsImpl(data, size, offset, values, count); }
+
+
+        const CADBitKernels PORTABLE_KERNELS =
+        {
+            "portable",
+            PortableRead2Bits,
+            PortableRead3Bits,
+            PortableReadBitShorts,
+            PortableReadBitLongs,
+            PortableReadBitDoubles,
+            PortableReadRawDoubles,
+            PortableReadBitDoublesWd,
+            PortableReadMChars,
+            PortableReadMShorts
+        };
+
+#ifdef LIBOPENCAD_HAVE_BMI2_KERNELS
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2Read2Bits(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count)
+        { return ReadSmallFields<2>(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2Read3Bits(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count)
+        { return ReadSmallFields<3>(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadBitShorts(const uint8_t* data, size_t size, size_t& offset, int16_t* values, size_t count)
+        { return ReadBitShortsImpl(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadBitLongs(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        { return ReadBitLongsImpl(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadBitDoubles(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        { return ReadBitDoublesImpl(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadRawDoubles(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count)
+        { return ReadRawDoublesImpl(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadBitDoublesWd(const uint8_t* data, size_t size, size_t& offset, const double* defaults,
+                                    double* values, size_t count)
+        { return ReadBitDoublesWdImpl(data, size, offset, defaults, values, count); }
+
+
+        struct BMI2MCharCompactor
+        {
+            LIBOPENCAD_BMI2_TARGET
+            static uint64_t Compact(uint64_t x)
+            { return _pext_u64(x, 0x7F7F7F7F7F7F7F7FULL); }
+        };
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadMChars(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count)
+        { return ReadMCharsImpl<BMI2MCharCompactor>(data, size, offset, values, count); }
+
+
+        LIBOPENCAD_BMI2_TARGET
+        size_t BMI2ReadMShorts(const uint8_t* data, size_t size, size_t& offset, uint32_t* values, size_t count)
+        { return ReadMShortsImpl(data, size, offset, values, count); }
+
+
+        const CADBitKernels BMI2_KERNELS =
+        {
+            "bmi2",
+            BMI2Read2Bits,
+            BMI2Read3Bits,
+            BMI2ReadBitShorts,
+            BMI2ReadBitLongs,
+            BMI2ReadBitDoubles,
+            BMI2ReadRawDoubles,
+            BMI2ReadBitDoublesWd,
+            BMI2ReadMChars,
+            BMI2ReadMShorts
+        };
+
+#endif
+
+
+        const CADBitKernels& SelectKernels()
+        {
+            const CADBitKernels* bmi2Kernels = GetBMI2CADBitKernels();
+            return bmi2Kernels ? *bmi2Kernels : PORTABLE_KERNELS;
+        }
+
+    }
+
+
+    const CADBitKernels& GetCADBitKernels()
+    {
+        static const CADBitKernels& kernels = SelectKernels();
+        return kernels;
+    }
+
+
+    const CADBitKernels& GetPortableCADBitKernels()
+    { return PORTABLE_KERNELS; }
+
+
+    const CADBitKernels* GetBMI2CADBitKernels()
+    {
+#ifdef LIBOPENCAD_HAVE_BMI2_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"))
+            return &BMI2_KERNELS;
+#endif
+        return nullptr;
+    }
+
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADBITKERNELS_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADBITKERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace libopencad
+{
+
+    /*
+     * Bit field decoding kernels, one table per instruction set. Every kernel decodes
+     * up to count values from the bit stream data[0, size) starting at bit offset,
+     * advances offset past the decoded values and returns how many were decoded. A
+     * value which would end past the buffer is not consumed.
+     */
+    struct CADBitKernels
+    {
+        const char* name;
+
+        size_t (*read2Bits)(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count);
+        size_t (*read3Bits)(const uint8_t* data, size_t size, size_t& offset, uint8_t* values, size_t count);
+        size_t (*readBitShorts)(const uint8_t* data, size_t size, size_t& offset, int16_t* values, size_t count);
+        size_t (*readBitLongs)(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count);
+        size_t (*readBitDoubles)(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count);
+        size_t (*readRawDoubles)(const uint8_t* data, size_t size, size_t& offset, double* values, size_t count);
+
+        // values[idx] defaults to defaults[idx], which is read after values[idx - 1] was stored
+        size_t (*readBitDoublesWd)(const uint8_t* data, size_t size, size_t& offset, const double* defaults,
+                                   double* values, size_t count);
+
+        size_t (*readMChars)(const uint8_t* data, size_t size, size_t& offset, int32_t* values, size_t count);
+        size_t (*readMShorts)(const uint8_t* data, size_t size, size_t& offset, uint32_t* values, size_t count);
+    };
+
+    // Kernels for the running CPU, selected once on first use
+    const CADBitKernels& GetCADBitKernels();
+
+    // Reference implementation in plain C++
+    const CADBitKernels& GetPortableCADBitKernels();
+
+    // x86-64 BMI1/BMI2 build of the same kernels, nullptr if the CPU or compiler lacks them
+    const CADBitKernels* GetBMI2CADBitKernels();
+
+}
+
+#endif
@@ -1,62 +1,245 @@
 #include "cadbitstreamreader.hpp"
+#include "cadbitkernels.hpp"
 
 #include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
 
 
 namespace libopencad
 {
 
-    CADBitStreamReader::CADBitStreamReader(const CADBitBuffer& buffer, size_t initialOffset)
-        : _buffer(buffer),
-          _offset(initialOffset)
-    { }
+    namespace
+    {
+
+        inline uint16_t SwapBytes16(uint64_t value)
+        { return static_cast<uint16_t>(((value & 0x00FF) << 8) | ((value & 0xFF00) >> 8)); }
+
+
+        inline uint32_t SwapBytes32(uint64_t value)
+        {
+            return static_cast<uint32_t>(((value & 0x000000FF) << 24) |
+                                         ((value & 0x0000FF00) << 8)  |
+                                         ((value & 0x00FF0000) >> 8)  |
+                                         ((value & 0xFF000000) >> 24));
+        }
+
+
+        // Bits taken by each 2 bit code, including the code itself
+        const size_t BITSHORT_SIZES[4]   = { 2 + 16, 2 + 8, 2, 2 };
+        const size_t BITLONG_SIZES[4]    = { 2 + 32, 2 + 8, 2, 2 };
+        const size_t BITDOUBLE_SIZES[4]  = { 2 + 64, 2, 2, 2 };
+        const size_t BITDOUBLEWD_SIZES[4] = { 2, 2 + 32, 2 + 48, 2 + 64 };
+
+    }
+
+
+    template<typename BoundsPolicy>
+    CADBasicBitStreamReader<BoundsPolicy>::CADBasicBitStreamReader(const CADBitBuffer& buffer, size_t initialOffset)
+        : _storage(std::make_shared<CADBitBuffer>(buffer)),
+          _data(_storage->data()),
+          _size(_storage->size()),
+          _offset(initialOffset),
+          _cache(0),
+          _cacheOffset(0),
+          _error(CADReadError::NONE),
+          _errorOffset(0)
+    { RefillCache(); }
+
+
+    template<typename BoundsPolicy>
+    CADBasicBitStreamReader<BoundsPolicy>::CADBasicBitStreamReader(CADBitBuffer&& buffer, size_t initialOffset)
+        : _storage(std::make_shared<CADBitBuffer>(std::move(buffer))),
+          _data(_storage->data()),
+          _size(_storage->size()),
+          _offset(initialOffset),
+          _cache(0),
+          _cacheOffset(0),
+          _error(CADReadError::NONE),
+          _errorOffset(0)
+    { RefillCache(); }
+
+
+    template<typename BoundsPolicy>
+    CADBasicBitStreamReader<BoundsPolicy>::CADBasicBitStreamReader(const uint8_t* data, size_t size, size_t initialOffset)
+        : _data(data),
+          _size(size),
+          _offset(initialOffset),
+          _cache(0),
+          _cacheOffset(0),
+          _error(CADReadError::NONE),
+          _errorOffset(0)
+    { RefillCache(); }
+
+
+    template<typename BoundsPolicy>
+    template<typename SubBoundsPolicy>
+    CADBasicBitStreamReader<SubBoundsPolicy> CADBasicBitStreamReader<BoundsPolicy>::SubReader(size_t byteOffset,
+                                                                                             size_t bytesCount) const
+    {
+        if (byteOffset > _size || bytesCount > _size - byteOffset)
+        {
+            if (BoundsPolicy::THROWS)
+                throw std::runtime_error("CADBitStreamReader: requested range is out of buffer range");
+
+            CADBasicBitStreamReader<SubBoundsPolicy> result(_data, 0);
+            result._error = CADReadError::OUT_OF_RANGE;
+            result._offset = 1;
+            return result;
+        }
+
+        CADBasicBitStreamReader<SubBoundsPolicy> result(_data + byteOffset, bytesCount);
+        result._storage = _storage;
+        return result;
+    }
+
+
+    template<typename BoundsPolicy>
+    const uint8_t* CADBasicBitStreamReader<BoundsPolicy>::GetData() const
+    { return _data; }
 
 
-    bool CADBitStreamReader::Available() const
-    { return _offset / 8 + 1 < _buffer.size(); }
+    template<typename BoundsPolicy>
+    size_t CADBasicBitStreamReader<BoundsPolicy>::GetSize() const
+    { return _size; }
 
 
-    size_t CADBitStreamReader::GetOffset() const
+    template<typename BoundsPolicy>
+    bool CADBasicBitStreamReader<BoundsPolicy>::Available() const
+    { return _offset / 8 + 1 < _size; }
+
+
+    template<typename BoundsPolicy>
+    size_t CADBasicBitStreamReader<BoundsPolicy>::GetOffset() const
     { return _offset; }
 
 
-    void CADBitStreamReader::SetOffset(size_t offset)
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SetOffset(size_t offset)
     {
-        ValidateOffset(offset);
+        if (offset > _size * 8)
+        {
+            Fail(CADReadError::OUT_OF_RANGE);
+            return;
+        }
+
         _offset = offset;
     }
 
 
-    void CADBitStreamReader::ValidateOffset(size_t offset)
+    template<typename BoundsPolicy>
+    bool CADBasicBitStreamReader<BoundsPolicy>::IsOverrun() const
+    { return _offset > _size * 8; }
+
+
+    template<typename BoundsPolicy>
+    CADReadError CADBasicBitStreamReader<BoundsPolicy>::GetError() const
+    {
+        if (_error == CADReadError::NONE && IsOverrun())
+            return CADReadError::OUT_OF_RANGE;
+
+        return _error;
+    }
+
+
+    template<typename BoundsPolicy>
+    size_t CADBasicBitStreamReader<BoundsPolicy>::GetErrorOffset() const
+    { return _error == CADReadError::NONE && IsOverrun() ? _size * 8 : _errorOffset; }
+
+
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::Fail(CADReadError error)
     {
-        if (offset > _buffer.size() * 8)
+        if (BoundsPolicy::THROWS)
+        {
+            if (error == CADReadError::CORRUPTED_DATA)
+                throw std::runtime_error("CADBitStreamReader: corrupted data");
+
             throw std::runtime_error("CADBitStreamReader: requested offset is out of buffer range");
+        }
+
+        if (_error == CADReadError::NONE)
+        {
+            _error = error;
+            _errorOffset = _offset;
+        }
+
+        // every following read fails as well
+        _offset = _size * 8 + 1;
     }
 
 
-    int32_t CADBitStreamReader::ReadRawLong()
-    { return *reinterpret_cast<int32_t*>(ReadBitsImpl(32).data()); }
+    template<typename BoundsPolicy>
+    bool CADBasicBitStreamReader<BoundsPolicy>::ValidateOffset(size_t offset)
+    {
+        if (!BoundsPolicy::CHECKED || offset <= _size * 8)
+            return true;
+
+        Fail(CADReadError::OUT_OF_RANGE);
+        return false;
+    }
 
 
-    int16_t CADBitStreamReader::ReadRawShort()
-    { return *reinterpret_cast<int16_t*>(ReadBitsImpl(16).data()); }
+    template<typename BoundsPolicy>
+    template<typename T>
+    void CADBasicBitStreamReader<BoundsPolicy>::BulkReadFailed(T* values, size_t count)
+    {
+        if (BoundsPolicy::CHECKED)
+            Fail(CADReadError::OUT_OF_RANGE);
+        else
+            _offset = _size * 8 + 1;
+
+        // the rest of the values reads as zeros, as the single value reads past the end do
+        std::fill(values, values + count, T());
+    }
 
 
-    double CADBitStreamReader::ReadRawDouble()
-    { return *reinterpret_cast<double*>(ReadBitsImpl(64).data()); }
+    template<typename BoundsPolicy>
+    int32_t CADBasicBitStreamReader<BoundsPolicy>::ReadRawLong()
+    { return static_cast<int32_t>(SwapBytes32(ReadBitsImpl(32))); }
 
 
-    uint8_t CADBitStreamReader::ReadChar()
-    { return ReadBitsImpl(8)[0]; }
+    template<typename BoundsPolicy>
+    int16_t CADBasicBitStreamReader<BoundsPolicy>::ReadRawShort()
+    { return static_cast<int16_t>(SwapBytes16(ReadBitsImpl(16))); }
 
 
-    std::string CADBitStreamReader::ReadTv()
+    template<typename BoundsPolicy>
+    double CADBasicBitStreamReader<BoundsPolicy>::ReadRawDouble()
+    {
+        if (!ValidateOffset(_offset + 64))
+            return 0.0;
+
+        uint64_t low = SwapBytes32(ReadBitsImpl(32));
+        uint64_t high = SwapBytes32(ReadBitsImpl(32));
+        uint64_t bits = (high << 32) | low;
+
+        double result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+
+    template<typename BoundsPolicy>
+    uint8_t CADBasicBitStreamReader<BoundsPolicy>::ReadChar()
+    { return static_cast<uint8_t>(ReadBitsImpl(8)); }
+
+
+    template<typename BoundsPolicy>
+    std::string CADBasicBitStreamReader<BoundsPolicy>::ReadTv()
     {
         int16_t stringLength = ReadBitShort();
 
         std::string result;
+        if (stringLength <= 0)
+            return result;
+
+        // a length running past the data fails at once rather than char by char
+        if (!ValidateOffset(_offset + static_cast<size_t>(stringLength) * 8))
+            return result;
+
+        result.reserve(stringLength);
 
         for (int16_t idx = 0; idx < stringLength; ++idx)
             result += ReadChar();
@@ -65,62 +248,78 @@ namespace libopencad
     }
 
 
-    bool CADBitStreamReader::ReadBit()
-    { return ReadBitsImpl(1)[0] & binary(10000000); }
+    template<typename BoundsPolicy>
+    bool CADBasicBitStreamReader<BoundsPolicy>::ReadBit()
+    { return ReadBitsImpl(1) != 0; }
 
 
-    uint8_t CADBitStreamReader::Read2Bits()
-    { return (ReadBitsImpl(2)[0] >> 6) & binary(00000011); }
+    template<typename BoundsPolicy>
+    uint8_t CADBasicBitStreamReader<BoundsPolicy>::Read2Bits()
+    { return static_cast<uint8_t>(ReadBitsImpl(2)); }
 
 
-    uint8_t CADBitStreamReader::Read3Bits()
-    { return (ReadBitsImpl(3)[0] >> 5) & binary(00000111); }
+    template<typename BoundsPolicy>
+    uint8_t CADBasicBitStreamReader<BoundsPolicy>::Read3Bits()
+    { return static_cast<uint8_t>(ReadBitsImpl(3)); }
 
 
-    uint8_t CADBitStreamReader::Read4Bits()
-    { return (ReadBitsImpl(4)[0] >> 4) & binary(00001111); }
+    template<typename BoundsPolicy>
+    uint8_t CADBasicBitStreamReader<BoundsPolicy>::Read4Bits()
+    { return static_cast<uint8_t>(ReadBitsImpl(4)); }
 
 
-    int16_t CADBitStreamReader::ReadBitShort()
+    template<typename BoundsPolicy>
+    int16_t CADBasicBitStreamReader<BoundsPolicy>::ReadBitShort()
     {
-        uint8_t bitcode = Read2Bits();
-
-        switch (bitcode)
-        {
-        case BITSHORT_NORMAL:
-            return *reinterpret_cast<int16_t*>(ReadBitsImpl(16).data());
+        int16_t result;
+        ReadBitShorts(&result, 1);
+        return result;
+    }
 
-        case BITSHORT_UNSIGNED_CHAR:
-            return ReadBitsImpl(8)[0];
 
-        case BITSHORT_ZERO_VALUE:
-            return 0;
+    template<typename BoundsPolicy>
+    CADHandle CADBasicBitStreamReader<BoundsPolicy>::ReadHandle()
+    {
+        CADHandle result(Read4Bits());
+        uint8_t counter = Read4Bits();
 
-        case BITSHORT_256:
-            return 256;
-        }
+        for (uint8_t idx = 0; idx < counter; ++idx)
+            result.addOffset(ReadChar());
 
-        return -1;
+        return result;
     }
 
 
-    CADHandle CADBitStreamReader::ReadHandle()
+    template<typename BoundsPolicy>
+    CADHandleReference CADBasicBitStreamReader<BoundsPolicy>::ReadHandleReference()
     {
-        CADHandle result(Read4Bits());
-        uint8_t counter = Read4Bits();
+        uint8_t codeAndCounter = static_cast<uint8_t>(ReadBitsImpl(8));
+
+        CADHandleReference result = { static_cast<uint8_t>(codeAndCounter >> 4), 0 };
+        uint8_t counter = codeAndCounter & binary(00001111);
+        if (counter > 8)
+        {
+            Fail(CADReadError::CORRUPTED_DATA);
+            return result;
+        }
 
         for (uint8_t idx = 0; idx < counter; ++idx)
-            result.addOffset(ReadChar());
+            result.value = (result.value << 8) | ReadChar();
 
         return result;
     }
 
 
-    void CADBitStreamReader::SeekHandle()
-    { ReadHandle(); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekHandle()
+    {
+        uint8_t counter = static_cast<uint8_t>(ReadBitsImpl(8) & binary(00001111));
+        SeekBitsImpl(counter * 8);
+    }
 
 
-    CADHandle CADBitStreamReader::ReadHandle8BitsLength()
+    template<typename BoundsPolicy>
+    CADHandle CADBasicBitStreamReader<BoundsPolicy>::ReadHandle8BitsLength()
     {
         CADHandle result;
         uint8_t counter = ReadChar();
@@ -132,267 +331,345 @@ namespace libopencad
     }
 
 
-    int32_t CADBitStreamReader::ReadBitLong()
+    template<typename BoundsPolicy>
+    int32_t CADBasicBitStreamReader<BoundsPolicy>::ReadBitLong()
     {
-        uint8_t bitcode = Read2Bits();
+        int32_t result;
+        ReadBitLongs(&result, 1);
+        return result;
+    }
 
-        switch (bitcode)
-        {
-        case BITLONG_NORMAL:
-            return *reinterpret_cast<int32_t*>(ReadBitsImpl(32).data());
 
-        case BITLONG_UNSIGNED_CHAR:
-            return ReadBitsImpl(8)[0];
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadBitShorts(int16_t* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readBitShorts(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-        case BITLONG_ZERO_VALUE:
-        case BITLONG_NOT_USED:
-            return 0;
-        }
 
-        return -1;
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadBitLongs(int32_t* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readBitLongs(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
     }
 
 
-    void CADBitStreamReader::SeekBitLong()
-    { ReadBitLong(); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBitLong()
+    { SeekBitsImpl(BITLONG_SIZES[PeekBitsImpl(2)]); }
 
 
-    void CADBitStreamReader::SeekBitShort()
-    { ReadBitShort(); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBitShort()
+    { SeekBitsImpl(BITSHORT_SIZES[PeekBitsImpl(2)]); }
 
 
-    void CADBitStreamReader::SeekBitDouble()
-    { ReadBitDouble(); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBitDouble()
+    { SeekBitsImpl(BITDOUBLE_SIZES[PeekBitsImpl(2)]); }
 
 
-    void CADBitStreamReader::SeekTv()
-    { ReadTv(); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBitDoubleWd()
+    { SeekBitsImpl(BITDOUBLEWD_SIZES[PeekBitsImpl(2)]); }
 
 
-    void CADBitStreamReader::SeekBits(size_t bitsCount)
-    { ReadBitsImpl(bitsCount); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekTv()
+    {
+        int16_t stringLength = ReadBitShort();
+        if (stringLength > 0)
+            SeekBitsImpl(static_cast<size_t>(stringLength) * 8);
+    }
 
 
-    double CADBitStreamReader::ReadBitDouble()
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekMChar()
     {
-        uint8_t bitcode = Read2Bits();
-
-        switch (bitcode)
+        for (size_t idx = 0; idx < 8; ++idx)
         {
-        case BITDOUBLE_NORMAL:
-            return ReadRawDouble();
-
-        case BITDOUBLE_ONE_VALUE:
-            return 1.0;
-
-        case BITDOUBLE_ZERO_VALUE:
-        case BITDOUBLE_NOT_USED:
-            return 0.0;
+            if (!(ReadBitsImpl(8) & binary(10000000)))
+                break;
         }
+    }
 
-        return -1.0;
+
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekMShort()
+    {
+        if (ReadBitsImpl(16) & 0x80)
+            SeekBitsImpl(16);
     }
 
 
-    double CADBitStreamReader::ReadBitDoubleWd(double defaultValue)
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekThickness()
     {
-        uint8_t bitcode = Read2Bits();
+        // R2000+: a set bit means zero thickness, otherwise a BD follows
+        if (!ReadBitsImpl(1))
+            SeekBitDouble();
+    }
 
-        switch (bitcode)
-        {
-        case BITDOUBLEWD_DEFAULT_VALUE:
-        {
-            return defaultValue;
-        }
 
-        case BITDOUBLEWD_4BYTES_PATCHED:
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekExtrusion()
+    {
+        // R2000+: a set bit means the (0, 0, 1) default, otherwise a 3BD follows
+        if (!ReadBitsImpl(1))
         {
-            for (size_t idx = 0; idx < 4; ++idx)
-                *(reinterpret_cast<char*>(&defaultValue) + idx) = ReadChar();
-
-            return defaultValue;
+            SeekBitDouble();
+            SeekBitDouble();
+            SeekBitDouble();
         }
+    }
 
-        case BITDOUBLEWD_6BYTES_PATCHED:
-        {
-            for (size_t idx = 0; idx < 6; ++idx)
-                *(reinterpret_cast<char*>(&defaultValue) + idx) = ReadChar();
 
-            return defaultValue;
-        }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekFields(std::initializer_list<CADFieldKind> fields)
+    { SeekFields(fields.begin(), fields.size()); }
+
 
-        case BITDOUBLEWD_FULL_RD:
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekFields(const CADFieldKind* fields, size_t count)
+    {
+        for (size_t idx = 0; idx < count; ++idx)
         {
-            return ReadRawDouble();
-        }
+            switch (fields[idx])
+            {
+            case CADFieldKind::BIT:          SeekBitsImpl(1); break;
+            case CADFieldKind::BITS2:        SeekBitsImpl(2); break;
+            case CADFieldKind::BITS3:        SeekBitsImpl(3); break;
+            case CADFieldKind::BITSHORT:     SeekBitShort(); break;
+            case CADFieldKind::BITLONG:      SeekBitLong(); break;
+            case CADFieldKind::BITDOUBLE:    SeekBitDouble(); break;
+            case CADFieldKind::BITDOUBLEWD:  SeekBitDoubleWd(); break;
+            case CADFieldKind::RAWCHAR:      SeekBitsImpl(8); break;
+            case CADFieldKind::RAWSHORT:     SeekBitsImpl(16); break;
+            case CADFieldKind::RAWLONG:      SeekBitsImpl(32); break;
+            case CADFieldKind::RAWDOUBLE:    SeekBitsImpl(64); break;
+            case CADFieldKind::MODULARCHAR:  SeekMChar(); break;
+            case CADFieldKind::MODULARSHORT: SeekMShort(); break;
+            case CADFieldKind::TEXT:         SeekTv(); break;
+            case CADFieldKind::HANDLE:       SeekHandle(); break;
+            case CADFieldKind::VECTOR:       SeekBitDouble(); SeekBitDouble(); SeekBitDouble(); break;
+            case CADFieldKind::RAWVECTOR:    SeekBitsImpl(128); break;
+            case CADFieldKind::THICKNESS:    SeekThickness(); break;
+            case CADFieldKind::EXTRUSION:    SeekExtrusion(); break;
+            }
         }
+    }
+
+
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBits(size_t bitsCount)
+    { SeekBitsImpl(bitsCount); }
+
+
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBit()
+    { SeekBitsImpl(1); }
 
-        return -1.0;
+
+    template<typename BoundsPolicy>
+    double CADBasicBitStreamReader<BoundsPolicy>::ReadBitDouble()
+    {
+        double result;
+        ReadBitDoubles(&result, 1);
+        return result;
     }
 
 
-    int32_t CADBitStreamReader::ReadMChar()
+    template<typename BoundsPolicy>
+    double CADBasicBitStreamReader<BoundsPolicy>::ReadBitDoubleWd(double defaultValue)
     {
-        int64_t result = 0;
-        bool negative = false;
+        double result;
+        ReadBitDoublesWd(&defaultValue, &result, 1);
+        return result;
+    }
 
-        ByteArray mcharBytes;
-        for (size_t idx = 0; idx < 8; ++idx)
-        {
-            mcharBytes.push_back(ReadChar());
 
-            if (!(mcharBytes.back() & binary(10000000)))
-                break;
-        }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadBitDoubles(double* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readBitDoubles(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-        std::reverse(mcharBytes.begin(), mcharBytes.end());
 
-        if (mcharBytes[0] & binary(01000000))
-        {
-            mcharBytes[0] &= binary(10111111);
-            negative = true;
-        }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadRawDoubles(double* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readRawDoubles(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-        for (size_t idx = 0; idx < mcharBytes.size(); ++idx)
-            mcharBytes[idx] &= binary(01111111);
 
-        switch (mcharBytes.size())
-        {
-        case 1:
-            break;
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadBitDoublesWd(const double* defaults, double* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readBitDoublesWd(_data, _size, _offset, defaults, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-        case 2:
-        {
-            char tmp = mcharBytes[0] & binary(00000001);
-            mcharBytes[0] = mcharBytes[0] >> 1;
-            mcharBytes[1] |= ( tmp << 7 );
-            break;
-        }
 
-        case 3:
-        {
-            unsigned char tmp1 = mcharBytes[0] & binary(00000011);
-            unsigned char tmp2 = mcharBytes[1] & binary(00000001);
-            mcharBytes[0] = mcharBytes[0] >> 2;
-            mcharBytes[1] = mcharBytes[1] >> 1;
-            mcharBytes[1] |= ( tmp1 << 6 );
-            mcharBytes[2] |= ( tmp2 << 7 );
-            break;
-        }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadVectors(double* xyz, size_t count)
+    { ReadBitDoubles(xyz, count * 3); }
 
-        case 4:
-        {
-            unsigned char tmp1 = mcharBytes[0] & binary(00000111);
-            unsigned char tmp2 = mcharBytes[1] & binary(00000011);
-            unsigned char tmp3 = mcharBytes[2] & binary(00000001);
-            mcharBytes[0] = mcharBytes[0] >> 3;
-            mcharBytes[1] = mcharBytes[1] >> 2;
-            mcharBytes[2] = mcharBytes[2] >> 1;
-            mcharBytes[1] |= ( tmp1 << 5 );
-            mcharBytes[2] |= ( tmp2 << 6 );
-            mcharBytes[3] |= ( tmp3 << 7 );
-            break;
-        }
-        }
 
-        std::reverse(mcharBytes.begin(), mcharBytes.end());
-        std::memcpy(&result, mcharBytes.data(), mcharBytes.size());
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadRawVectors(double* xy, size_t count)
+    { ReadRawDoubles(xy, count * 2); }
 
-        if (negative) result *= -1;
 
+    template<typename BoundsPolicy>
+    int32_t CADBasicBitStreamReader<BoundsPolicy>::ReadMChar()
+    {
+        int32_t result;
+        ReadMChars(&result, 1);
         return result;
     }
 
 
-    uint32_t CADBitStreamReader::ReadMShort()
+    template<typename BoundsPolicy>
+    uint32_t CADBasicBitStreamReader<BoundsPolicy>::ReadMShort()
     {
-        int32_t result = 0;
+        uint32_t result;
+        ReadMShorts(&result, 1);
+        return result;
+    }
 
-        ByteArray mshortBytes;
-        mshortBytes.push_back(ReadChar());
-        mshortBytes.push_back(ReadChar());
 
-        if (mshortBytes[1] & binary(10000000))
-        {
-            mshortBytes.push_back(ReadChar());
-            mshortBytes.push_back(ReadChar());
-        }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadMChars(int32_t* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readMChars(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-        std::reverse(mshortBytes.begin(), mshortBytes.end());
 
-        if (mshortBytes.size() == 2)
-        {
-            mshortBytes[0] &= binary(01111111);
-        }
-        else if (mshortBytes.size() == 4)
-        {
-            mshortBytes[0] &= binary(01111111);
-            mshortBytes[2] &= binary(01111111);
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::ReadMShorts(uint32_t* values, size_t count)
+    {
+        size_t decoded = GetCADBitKernels().readMShorts(_data, _size, _offset, values, count);
+        if (decoded != count)
+            BulkReadFailed(values + decoded, count - decoded);
+    }
 
-            mshortBytes[2] |= (mshortBytes[1] << 7);
-            mshortBytes[1] = (mshortBytes[1] >> 1);
-            mshortBytes[1] |= (mshortBytes[0] << 7);
-            mshortBytes[0] = (mshortBytes[0] >> 1);
-        }
 
-        std::reverse(mshortBytes.begin(), mshortBytes.end());
-        std::memcpy(&result, mshortBytes.data(), mshortBytes.size());
+    template<typename BoundsPolicy>
+    CADVector CADBasicBitStreamReader<BoundsPolicy>::ReadVector()
+    {
+        double x = ReadBitDouble();
+        double y = ReadBitDouble();
+        double z = ReadBitDouble();
+        return CADVector(x, y, z);
+    }
 
-        return result;
+
+    template<typename BoundsPolicy>
+    CADVector CADBasicBitStreamReader<BoundsPolicy>::ReadRawVector()
+    {
+        double x = ReadRawDouble();
+        double y = ReadRawDouble();
+        return CADVector(x, y);
     }
 
 
-    CADVector CADBitStreamReader::ReadVector()
-    { return CADVector(ReadBitDouble(), ReadBitDouble(), ReadBitDouble()); }
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::SeekBitsImpl(size_t offset)
+    {
+        if (ValidateOffset(_offset + offset))
+            _offset += offset;
+    }
 
 
-    CADVector CADBitStreamReader::ReadRawVector()
-    { return CADVector(ReadRawDouble(), ReadRawDouble()); }
+    template<typename BoundsPolicy>
+    uint64_t CADBasicBitStreamReader<BoundsPolicy>::ReadBitsImpl(size_t bitsCount)
+    {
+        if (!ValidateOffset(_offset + bitsCount))
+            return 0;
+
+        uint64_t result = CachedBits(bitsCount);
+        _offset += bitsCount;
+
+        return result;
+    }
 
 
-    void CADBitStreamReader::SeekBitsImpl(size_t offset)
+    template<typename BoundsPolicy>
+    uint64_t CADBasicBitStreamReader<BoundsPolicy>::PeekBitsImpl(size_t bitsCount)
     {
-        ValidateOffset(_offset + offset);
-        _offset += offset;
+        if (!ValidateOffset(_offset + bitsCount))
+            return 0;
+
+        return CachedBits(bitsCount);
     }
 
 
-    ByteArray CADBitStreamReader::ReadBitsImpl(size_t bitsCount)
+    template<typename BoundsPolicy>
+    uint64_t CADBasicBitStreamReader<BoundsPolicy>::CachedBits(size_t bitsCount)
     {
-        ValidateOffset(_offset + bitsCount);
+        if (_offset < _cacheOffset || _offset + bitsCount > _cacheOffset + 64)
+            RefillCache();
 
-        size_t byteOffset = _offset / 8;
-        size_t bitOffset = _offset % 8;
+        return (_cache << (_offset - _cacheOffset)) >> (64 - bitsCount);
+    }
 
-        size_t resultSizeBits = bitOffset + bitsCount;
-        size_t resultSizeBytes = (resultSizeBits / 8) + (resultSizeBits % 8 ? 1 : 0);
 
-        ByteArray result(resultSizeBytes, 0);
+    template<typename BoundsPolicy>
+    void CADBasicBitStreamReader<BoundsPolicy>::RefillCache()
+    {
+        size_t byteOffset = _offset / 8;
 
-        std::copy(_buffer.cbegin() + byteOffset, _buffer.cbegin() + byteOffset + resultSizeBytes, result.begin());
+        _cache = 0;
+        _cacheOffset = byteOffset * 8;
 
-        switch (bitOffset)
+        if (byteOffset + 8 <= _size)
         {
-        case 0:
-            break;
+            const uint8_t* bytes = _data + byteOffset;
+            _cache = (uint64_t(bytes[0]) << 56) | (uint64_t(bytes[1]) << 48) |
+                     (uint64_t(bytes[2]) << 40) | (uint64_t(bytes[3]) << 32) |
+                     (uint64_t(bytes[4]) << 24) | (uint64_t(bytes[5]) << 16) |
+                     (uint64_t(bytes[6]) << 8)  |  uint64_t(bytes[7]);
+            return;
+        }
 
-        default:
-            if (result.size() == 1)
-                result[0] <<= bitOffset;
-            else
-            {
-                for (size_t idx = 0; idx < result.size() - 1; ++idx)
-                {
-                    result[idx] <<= bitOffset;
-                    result[idx] |= (result[idx+1] >> (8 - bitOffset));
-                }
-            }
-            break;
+        for (size_t idx = 0; idx < 8; ++idx)
+        {
+            _cache <<= 8;
+            if (byteOffset + idx < _size)
+                _cache |= _data[byteOffset + idx];
         }
+    }
 
-        _offset += bitsCount;
 
-        return result;
-    }
+    template class CADBasicBitStreamReader<CADCheckedBounds>;
+    template class CADBasicBitStreamReader<CADUncheckedBounds>;
+    template class CADBasicBitStreamReader<CADStickyErrorBounds>;
+
+#define INSTANTIATE_SUB_READER(BoundsPolicy, SubBoundsPolicy) \
+    template CADBasicBitStreamReader<SubBoundsPolicy> \
+    CADBasicBitStreamReader<BoundsPolicy>::SubReader<SubBoundsPolicy>(size_t, size_t) const;
+
+    INSTANTIATE_SUB_READER(CADCheckedBounds, CADCheckedBounds)
+    INSTANTIATE_SUB_READER(CADCheckedBounds, CADUncheckedBounds)
+    INSTANTIATE_SUB_READER(CADCheckedBounds, CADStickyErrorBounds)
+    INSTANTIATE_SUB_READER(CADUncheckedBounds, CADCheckedBounds)
+    INSTANTIATE_SUB_READER(CADUncheckedBounds, CADUncheckedBounds)
+    INSTANTIATE_SUB_READER(CADUncheckedBounds, CADStickyErrorBounds)
+    INSTANTIATE_SUB_READER(CADStickyErrorBounds, CADCheckedBounds)
+    INSTANTIATE_SUB_READER(CADStickyErrorBounds, CADUncheckedBounds)
+    INSTANTIATE_SUB_READER(CADStickyErrorBounds, CADStickyErrorBounds)
+
+#undef INSTANTIATE_SUB_READER
 
 }
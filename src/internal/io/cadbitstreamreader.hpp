@@ -33,6 +33,8 @@
 #include "../toolkit.hpp"
 
 #include <cstdint>
+#include <initializer_list>
+#include <memory>
 #include <vector>
 
 using ByteArray = std::vector<uint8_t>;
@@ -42,15 +44,132 @@ using CADBitBuffer = std::vector<uint8_t>;
 namespace libopencad
 {
 
-    class CADBitStreamReader
+    // Field kinds of the DWG bit stream, used to skip runs of fields in a single call
+    enum class CADFieldKind : uint8_t
+    {
+        BIT,            // B
+        BITS2,          // BB
+        BITS3,          // 3B
+        BITSHORT,       // BS
+        BITLONG,        // BL
+        BITDOUBLE,      // BD
+        BITDOUBLEWD,    // DD
+        RAWCHAR,        // RC
+        RAWSHORT,       // RS
+        RAWLONG,        // RL
+        RAWDOUBLE,      // RD
+        MODULARCHAR,    // MC
+        MODULARSHORT,   // MS
+        TEXT,           // TV
+        HANDLE,         // H
+        VECTOR,         // 3BD
+        RAWVECTOR,      // 2RD
+        THICKNESS,      // BT
+        EXTRUSION       // BE
+    };
+
+
+    enum class CADReadError : uint8_t
+    {
+        NONE,
+        OUT_OF_RANGE,       // read past the end of the data
+        CORRUPTED_DATA      // decoded values are inconsistent (sizes, counts)
+    };
+
+
+    // Handle reference as stored in the bit stream: a code and up to 8 bytes of value
+    struct CADHandleReference
+    {
+        uint8_t     code;
+        uint64_t    value;
+
+        // Absolute handle, codes 6, 8, 0xA and 0xC are relative to the referencing object
+        uint64_t Resolve(uint64_t ownerHandle) const
+        {
+            switch (code)
+            {
+                case 0x6: return ownerHandle + 1;
+                case 0x8: return ownerHandle - 1;
+                case 0xA: return ownerHandle + value;
+                case 0xC: return ownerHandle - value;
+                default: return value;
+            }
+        }
+    };
+
+
+    /*
+     * Bounds policies. CHECKED validates every read, THROWS turns errors into
+     * std::runtime_error instead of recording them in the reader.
+     *
+     * The checked policy throws on the first read crossing the end of the data.
+     *
+     * The unchecked one is meant for hot decode loops over a range validated up front
+     * (an object of known size): reads past the end return zeros, never touch memory
+     * outside of the data and leave the reader in the overrun state, which the caller
+     * tests once at the object boundary.
+     *
+     * The sticky error one never throws: the first failure is recorded, every later
+     * read returns zero, and the caller tests GetError() once per object. Unwinding is
+     * expensive enough to dominate parsing of damaged files.
+     */
+    struct CADCheckedBounds
+    {
+        static const bool CHECKED = true;
+        static const bool THROWS = true;
+    };
+
+
+    struct CADUncheckedBounds
+    {
+        static const bool CHECKED = false;
+        static const bool THROWS = true;
+    };
+
+
+    struct CADStickyErrorBounds
+    {
+        static const bool CHECKED = true;
+        static const bool THROWS = false;
+    };
+
+
+    template<typename BoundsPolicy>
+    class CADBasicBitStreamReader
     {
     public:
-        explicit CADBitStreamReader(const CADBitBuffer& buffer, size_t initialOffset = 0);
+        typedef BoundsPolicy Policy;
+
+        explicit CADBasicBitStreamReader(const CADBitBuffer& buffer, size_t initialOffset = 0);
+        explicit CADBasicBitStreamReader(CADBitBuffer&& buffer, size_t initialOffset = 0);
+
+        // Non-owning view, the caller keeps [data, data + size) alive while the reader is in use
+        CADBasicBitStreamReader(const uint8_t* data, size_t size, size_t initialOffset = 0);
+
+        // Reader over [byteOffset, byteOffset + bytesCount) of this reader's data. No bytes are
+        // copied, the sub-reader shares the owned buffer (if any) and starts at offset 0. The
+        // range is always validated, so it is the place to switch to unchecked reads. A bad
+        // range given to a non-throwing reader yields an empty sub-reader in the error state.
+        template<typename SubBoundsPolicy = BoundsPolicy>
+        CADBasicBitStreamReader<SubBoundsPolicy> SubReader(size_t byteOffset, size_t bytesCount) const;
+
+        const uint8_t* GetData() const;
+        size_t GetSize() const;
 
         bool Available() const;
         size_t GetOffset() const;
         void SetOffset(size_t offset);
 
+        // True once a read went past the end of the data, never set by checked readers
+        bool IsOverrun() const;
+
+        // First error met by a non-throwing reader (an overrun counts as OUT_OF_RANGE)
+        CADReadError GetError() const;
+        size_t GetErrorOffset() const;
+
+        // Reports an error found by the caller: throws or records it, depending on the policy
+        void Fail(CADReadError error);
+
         double  ReadRawDouble();
         int64_t ReadRawLongLong();
         int32_t ReadRawLong();
@@ -66,14 +185,36 @@ namespace libopencad
         int32_t ReadBitLong();
         int16_t ReadBitShort();
 
+        // Bulk variants, decode count values into caller provided arrays
+        void ReadBitShorts(int16_t* values, size_t count);
+        void ReadBitLongs(int32_t* values, size_t count);
+        void ReadBitDoubles(double* values, size_t count);
+        void ReadRawDoubles(double* values, size_t count);
+
+        // values[idx] is patched over defaults[idx]. Arrays may overlap as long as defaults
+        // does not run ahead of values, so defaults = values - 2 decodes LWPOLYLINE style
+        // vertex chains where each point is relative to the previous one.
+        void ReadBitDoublesWd(const double* defaults, double* values, size_t count);
+
+        // Vectors are stored as contiguous x, y(, z) doubles
+        void ReadVectors(double* xyz, size_t count);
+        void ReadRawVectors(double* xy, size_t count);
+
         int32_t ReadMChar();
         uint32_t ReadMShort();
+
+        // Bulk variants for runs of modular values such as the object map
+        void ReadMChars(int32_t* values, size_t count);
+        void ReadMShorts(uint32_t* values, size_t count);
         
         std::string ReadTv();
 
         CADHandle ReadHandle();
         CADHandle ReadHandle8BitsLength();
 
+        // Same as ReadHandle, the value bytes folded into an integer
+        CADHandleReference ReadHandleReference();
+
         CADVector ReadVector();
         CADVector ReadRawVector();
 
@@ -86,10 +227,33 @@ namespace libopencad
         void SeekTv();
         void SeekHandle();
 
+        void SeekBitDoubleWd();
+        void SeekMChar();
+        void SeekMShort();
+        void SeekThickness();
+        void SeekExtrusion();
+
+        // Skips fields of the given kinds, only length prefixes and bit codes are decoded
+        void SeekFields(const CADFieldKind* fields, size_t count);
+        void SeekFields(std::initializer_list<CADFieldKind> fields);
+
     private:
-        void ValidateOffset(size_t offset);
+        template<typename OtherBoundsPolicy>
+        friend class CADBasicBitStreamReader;
+
+        // False if the read ending at offset has to be dropped
+        bool ValidateOffset(size_t offset);
         void SeekBitsImpl(size_t offset);
-        ByteArray ReadBitsImpl(size_t bitsCount);
+
+        // Bulk read stopped at the end of the data with count values left
+        template<typename T>
+        void BulkReadFailed(T* values, size_t count);
+
+        // Returns next bitsCount (1..57) bits of the stream, MSB first, right-aligned.
+        uint64_t ReadBitsImpl(size_t bitsCount);
+        uint64_t PeekBitsImpl(size_t bitsCount);
+        uint64_t CachedBits(size_t bitsCount);
+        void RefillCache();
 
     private:
         enum Bitcodes
@@ -116,10 +280,29 @@ namespace libopencad
         };
 
     private:
-        CADBitBuffer    _buffer;
+        std::shared_ptr<const CADBitBuffer> _storage;
+        const uint8_t*  _data;
+        size_t          _size;
         size_t          _offset;
+
+        // 64 bits of the buffer starting at byte-aligned bit offset _cacheOffset, MSB first.
+        // Bytes past the end of the buffer are read as zeros.
+        uint64_t        _cache;
+        size_t          _cacheOffset;
+
+        CADReadError    _error;
+        size_t          _errorOffset;
     };
 
+
+    using CADBitStreamReader = CADBasicBitStreamReader<CADCheckedBounds>;
+    using CADUncheckedBitStreamReader = CADBasicBitStreamReader<CADUncheckedBounds>;
+    using CADStickyBitStreamReader = CADBasicBitStreamReader<CADStickyErrorBounds>;
+
+    extern template class CADBasicBitStreamReader<CADCheckedBounds>;
+    extern template class CADBasicBitStreamReader<CADUncheckedBounds>;
+    extern template class CADBasicBitStreamReader<CADStickyErrorBounds>;
+
 }
 
 #endif
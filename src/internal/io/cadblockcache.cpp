@@ -0,0 +1,223 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadblockcache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace libopencad
+{
+
+    CADBlockCache::CADBlockCache(size_t capacity, size_t blockSize)
+        : _capacity(capacity),
+          _blockSize(std::max<size_t>(blockSize, 1)),
+          _statistics(),
+          _nextFileId(0)
+    { }
+
+
+    CADBlockCache::Statistics CADBlockCache::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+
+    void CADBlockCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _entries.clear();
+        _files.clear();
+        _statistics.bytesUsed = 0;
+        _statistics.blocksCount = 0;
+    }
+
+
+    uint64_t CADBlockCache::RegisterFile()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _nextFileId++;
+    }
+
+
+    void CADBlockCache::ForgetFile(uint64_t fileId)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto file = _files.find(fileId);
+        if (file == _files.end())
+            return;
+
+        for (const auto& block : file->second)
+        {
+            _statistics.bytesUsed -= block.second->block->size();
+            --_statistics.blocksCount;
+            _entries.erase(block.second);
+        }
+
+        _files.erase(file);
+    }
+
+
+    CADBlockCache::Block CADBlockCache::GetBlock(uint64_t fileId, size_t blockIdx, const ICADFileIO& source)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto file = _files.find(fileId);
+            if (file != _files.end())
+            {
+                auto found = file->second.find(blockIdx);
+                if (found != file->second.end())
+                {
+                    ++_statistics.hits;
+                    _entries.splice(_entries.begin(), _entries, found->second);
+                    return found->second->block;
+                }
+            }
+
+            ++_statistics.misses;
+        }
+
+        // Load outside of the lock, concurrent misses on other blocks proceed in parallel
+        std::shared_ptr<ByteArray> loaded = std::make_shared<ByteArray>();
+        source.ReadAt(blockIdx * _blockSize, *loaded, _blockSize);
+
+        // Blocks past the end of the file are empty, nothing to keep
+        if (loaded->empty() || loaded->size() > _capacity)
+            return loaded;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Another thread may have loaded the same block meanwhile
+        auto file = _files.find(fileId);
+        if (file != _files.end())
+        {
+            auto found = file->second.find(blockIdx);
+            if (found != file->second.end())
+                return found->second->block;
+        }
+
+        EvictUntilFits(loaded->size());
+
+        Entry entry = { fileId, blockIdx, loaded };
+        _entries.push_front(entry);
+        _files[fileId][blockIdx] = _entries.begin();
+        _statistics.bytesUsed += loaded->size();
+        ++_statistics.blocksCount;
+
+        return loaded;
+    }
+
+
+    void CADBlockCache::EvictUntilFits(size_t bytesCount)
+    {
+        while (!_entries.empty() && _statistics.bytesUsed + bytesCount > _capacity)
+        {
+            ++_statistics.evictions;
+            RemoveEntry(std::prev(_entries.end()));
+        }
+    }
+
+
+    void CADBlockCache::RemoveEntry(EntryList::iterator entry)
+    {
+        _statistics.bytesUsed -= entry->block->size();
+        --_statistics.blocksCount;
+
+        auto file = _files.find(entry->fileId);
+        file->second.erase(entry->blockIdx);
+        if (file->second.empty())
+            _files.erase(file);
+
+        _entries.erase(entry);
+    }
+
+
+    CachedCADFileIO::CachedCADFileIO(const std::shared_ptr<ICADFileIO>& fileIO, const CADBlockCachePtr& cache)
+        : _fileIO(fileIO),
+          _cache(cache),
+          _fileId(cache->RegisterFile()),
+          _position(0)
+    { }
+
+
+    CachedCADFileIO::~CachedCADFileIO()
+    { _cache->ForgetFile(_fileId); }
+
+
+    size_t CachedCADFileIO::ReadInto(void* buffer, size_t bytesCount)
+    { return ReadIntoAt(_position, buffer, bytesCount); }
+
+
+    const uint8_t* CachedCADFileIO::ReadView(size_t bytesCount)
+    { return ViewAtCursor(_position, bytesCount); }
+
+
+    size_t CachedCADFileIO::Write(const ByteArray&)
+    { return 0; }
+
+
+    size_t CachedCADFileIO::Seek(int64_t offset, SeekOrigin origin)
+    { return SeekCursor(_position, offset, origin); }
+
+
+    size_t CachedCADFileIO::ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        const size_t blockSize = _cache->GetBlockSize();
+        uint8_t* output = static_cast<uint8_t*>(buffer);
+        size_t readCount = 0;
+
+        while (readCount < bytesCount)
+        {
+            size_t position = offset + readCount;
+            CADBlockCache::Block block = _cache->GetBlock(_fileId, position / blockSize, *_fileIO);
+
+            size_t blockOffset = position % blockSize;
+            if (blockOffset >= block->size())
+                break;
+
+            size_t copyCount = std::min(bytesCount - readCount, block->size() - blockOffset);
+            std::memcpy(output + readCount, block->data() + blockOffset, copyCount);
+            readCount += copyCount;
+        }
+
+        return readCount;
+    }
+
+
+    const uint8_t* CachedCADFileIO::ViewAt(size_t offset, size_t bytesCount) const
+    {
+        // Cached blocks may be evicted at any time, only the wrapped file can lend memory
+        return _fileIO->ViewAt(offset, bytesCount);
+    }
+
+}
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADBLOCKCACHE_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADBLOCKCACHE_HPP
+
+#include "cadfileio.hpp"
+#include "../toolkit.hpp"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace libopencad
+{
+
+    /*
+     * LRU cache of fixed-size file blocks shared by any number of files, bounded by
+     * a global byte budget. Thread-safe.
+     */
+    class CADBlockCache
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t    hits;
+            uint64_t    misses;
+            uint64_t    evictions;
+            size_t      bytesUsed;
+            size_t      blocksCount;
+        };
+
+        using Block = std::shared_ptr<const ByteArray>;
+
+    public:
+        explicit CADBlockCache(size_t capacity, size_t blockSize = 64 * 1024);
+
+        size_t GetCapacity() const
+        { return _capacity; }
+
+        size_t GetBlockSize() const
+        { return _blockSize; }
+
+        Statistics GetStatistics() const;
+        void Clear();
+
+        // Unique key for a file sharing the cache, and removal of its blocks once it is closed
+        uint64_t RegisterFile();
+        void ForgetFile(uint64_t fileId);
+
+        // Block blockIdx of file, loaded with source.ReadAt on a miss
+        Block GetBlock(uint64_t fileId, size_t blockIdx, const ICADFileIO& source);
+
+    private:
+        CADBlockCache(const CADBlockCache&) = delete;
+        CADBlockCache& operator=(const CADBlockCache&) = delete;
+
+        struct Entry
+        {
+            uint64_t    fileId;
+            size_t      blockIdx;
+            Block       block;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        // Cached blocks of one file by block index, so a file is forgotten in the count
+        // of its own blocks
+        using FileBlocks = std::unordered_map<size_t, EntryList::iterator>;
+
+        void EvictUntilFits(size_t bytesCount);
+        void RemoveEntry(EntryList::iterator entry);
+
+    private:
+        const size_t            _capacity;
+        const size_t            _blockSize;
+
+        mutable std::mutex      _mutex;
+        EntryList               _entries; // most recently used first
+        std::unordered_map<uint64_t, FileBlocks> _files;
+        Statistics              _statistics;
+        uint64_t                _nextFileId;
+    };
+    DECLARE_PTR(CADBlockCache);
+
+
+    /*
+     * ICADFileIO decorator that serves reads from a CADBlockCache, falling back to the
+     * wrapped file's ReadAt on misses. Read-only.
+     */
+    class CachedCADFileIO : public ICADFileIO
+    {
+    public:
+        CachedCADFileIO(const std::shared_ptr<ICADFileIO>& fileIO, const CADBlockCachePtr& cache);
+        virtual ~CachedCADFileIO();
+
+        using ICADFileIO::ReadInto;
+        virtual size_t ReadInto(void* buffer, size_t bytesCount);
+        virtual const uint8_t* ReadView(size_t bytesCount);
+        virtual size_t Write(const ByteArray& data);
+        virtual size_t Seek(int64_t offset, SeekOrigin origin);
+
+        using ICADFileIO::ReadAt;
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const;
+        virtual const uint8_t* ViewAt(size_t offset, size_t bytesCount) const;
+
+        virtual size_t Tell() const
+        { return _position; }
+
+        virtual bool Eof() const
+        { return _position >= GetSize(); }
+
+        virtual bool IsOpened() const
+        { return _fileIO->IsOpened(); }
+
+        virtual size_t GetSize() const
+        { return _fileIO->GetSize(); }
+
+    private:
+        std::shared_ptr<ICADFileIO> _fileIO;
+        CADBlockCachePtr            _cache;
+        uint64_t                    _fileId;
+        size_t                      _position;
+    };
+}
+
+#endif
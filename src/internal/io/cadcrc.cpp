@@ -0,0 +1,196 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadcrc.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const size_t SLICES_COUNT = 8;
+
+        // Below this many bytes per thread, starting threads costs more than it saves
+        const size_t PARALLEL_CHUNK_MIN_SIZE = 256 * 1024;
+
+        struct CrcTables
+        {
+            CrcTables()
+            {
+                for (unsigned value = 0; value < 256; ++value)
+                {
+                    unsigned crc = value;
+                    for (int bitIdx = 0; bitIdx < 8; ++bitIdx)
+                        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+
+                    tables[0][value] = static_cast<uint16_t>(crc);
+                }
+
+                // tables[k][value] is the CRC of value followed by k zero bytes
+                for (size_t sliceIdx = 1; sliceIdx < SLICES_COUNT; ++sliceIdx)
+                {
+                    for (unsigned value = 0; value < 256; ++value)
+                    {
+                        uint16_t previous = tables[sliceIdx - 1][value];
+                        tables[sliceIdx][value] = static_cast<uint16_t>((previous >> 8) ^ tables[0][previous & 0xFF]);
+                    }
+                }
+            }
+
+            uint16_t tables[SLICES_COUNT][256];
+        };
+
+
+        const CrcTables& GetCrcTables()
+        {
+            static const CrcTables tables;
+            return tables;
+        }
+
+
+        // GF(2) 16x16 matrix stored by columns: column idx is the image of bit idx
+        typedef uint16_t CrcMatrix[16];
+
+        uint16_t MultiplyCrcMatrix(const CrcMatrix matrix, uint16_t vector)
+        {
+            uint16_t result = 0;
+            for (size_t bitIdx = 0; vector != 0; ++bitIdx, vector >>= 1)
+            {
+                if (vector & 1)
+                    result ^= matrix[bitIdx];
+            }
+
+            return result;
+        }
+
+
+        void SquareCrcMatrix(CrcMatrix square, const CrcMatrix matrix)
+        {
+            for (size_t bitIdx = 0; bitIdx < 16; ++bitIdx)
+                square[bitIdx] = MultiplyCrcMatrix(matrix, matrix[bitIdx]);
+        }
+
+    }
+
+
+    uint16_t CalculateCADCrc(const uint8_t* data, size_t size, uint16_t seed)
+    {
+        const CrcTables& crcTables = GetCrcTables();
+        const uint16_t (*tables)[256] = crcTables.tables;
+        uint32_t crc = seed;
+
+        for (; size >= SLICES_COUNT; data += SLICES_COUNT, size -= SLICES_COUNT)
+        {
+            crc = tables[7][(crc ^ data[0]) & 0xFF] ^ tables[6][((crc >> 8) ^ data[1]) & 0xFF] ^
+                  tables[5][data[2]] ^ tables[4][data[3]] ^ tables[3][data[4]] ^
+                  tables[2][data[5]] ^ tables[1][data[6]] ^ tables[0][data[7]];
+        }
+
+        for (; size > 0; ++data, --size)
+            crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xFF];
+
+        return static_cast<uint16_t>(crc);
+    }
+
+
+    uint16_t CombineCADCrc(uint16_t firstCrc, uint16_t secondCrc, size_t secondSize)
+    {
+        // The CRC is linear: appending B moves the state through secondSize zero bytes
+        // (a fixed linear map) and adds the CRC of B. The map is raised to the power
+        // secondSize by squaring, starting from the single zero byte one.
+        const uint16_t* table = GetCrcTables().tables[0];
+
+        CrcMatrix power;
+        for (size_t bitIdx = 0; bitIdx < 16; ++bitIdx)
+        {
+            uint16_t state = static_cast<uint16_t>(1u << bitIdx);
+            power[bitIdx] = static_cast<uint16_t>((state >> 8) ^ table[state & 0xFF]);
+        }
+
+        uint16_t state = firstCrc;
+        CrcMatrix square;
+        while (secondSize != 0)
+        {
+            if (secondSize & 1)
+                state = MultiplyCrcMatrix(power, state);
+
+            secondSize >>= 1;
+            if (secondSize != 0)
+            {
+                SquareCrcMatrix(square, power);
+                std::copy(square, square + 16, power);
+            }
+        }
+
+        return state ^ secondCrc;
+    }
+
+
+    uint16_t CalculateCADCrcParallel(const uint8_t* data, size_t size, uint16_t seed, size_t threadsCount)
+    {
+        if (threadsCount == 0)
+            threadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+        size_t chunksCount = std::min(threadsCount, size / PARALLEL_CHUNK_MIN_SIZE);
+        if (chunksCount < 2)
+            return CalculateCADCrc(data, size, seed);
+
+        size_t chunkSize = (size + chunksCount - 1) / chunksCount;
+        std::vector<uint16_t> chunkCrcs(chunksCount);
+        std::vector<std::thread> workers;
+
+        // Chunk 0 runs on the calling thread
+        for (size_t chunkIdx = 1; chunkIdx < chunksCount; ++chunkIdx)
+        {
+            workers.push_back(std::thread([=, &chunkCrcs]()
+            {
+                size_t chunkOffset = chunkIdx * chunkSize;
+                chunkCrcs[chunkIdx] = CalculateCADCrc(data + chunkOffset, std::min(chunkSize, size - chunkOffset), 0);
+            }));
+        }
+        chunkCrcs[0] = CalculateCADCrc(data, chunkSize, seed);
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        uint16_t crc = chunkCrcs[0];
+        for (size_t chunkIdx = 1; chunkIdx < chunksCount; ++chunkIdx)
+        {
+            size_t chunkOffset = chunkIdx * chunkSize;
+            crc = CombineCADCrc(crc, chunkCrcs[chunkIdx], std::min(chunkSize, size - chunkOffset));
+        }
+
+        return crc;
+    }
+
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADCRC_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADCRC_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace libopencad
+{
+
+    // Seeds used by the DWG format
+    const uint16_t CAD_CRC_FILE_HEADER_SEED = 0x0000;
+    const uint16_t CAD_CRC_SECTION_SEED = 0xC0C1;
+
+    /*
+     * The DWG "8-bit CRC": a 16-bit CRC driven by a 256 entry table (reflected 0xA001
+     * polynomial, no final xor). Sections, the object map and every object carry one.
+     * Decoded with slicing-by-8 tables, 8 input bytes per step.
+     */
+    uint16_t CalculateCADCrc(const uint8_t* data, size_t size, uint16_t seed);
+
+    // CRC of A followed by B, given the CRC of A and the CRC of B computed with a zero seed
+    uint16_t CombineCADCrc(uint16_t firstCrc, uint16_t secondCrc, size_t secondSize);
+
+    /*
+     * Same as CalculateCADCrc, large inputs are split in chunks checked on threadsCount
+     * threads (0 means one per core) and the chunk CRCs are combined.
+     */
+    uint16_t CalculateCADCrcParallel(const uint8_t* data, size_t size, uint16_t seed, size_t threadsCount = 0);
+
+}
+
+#endif
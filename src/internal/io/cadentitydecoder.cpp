@@ -0,0 +1,295 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadentitydecoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        // Entities taken by a thread at once, small enough for stealing to even out
+        // entities of very different sizes
+        const size_t DECODE_CHUNK_SIZE = 128;
+
+
+        template<typename Data>
+        void TrimTerminators(Data&)
+        { }
+
+
+        void TrimTerminators(CADTextData& data)
+        { TrimCADStringTerminator(data.value); }
+
+
+        template<typename Schema>
+        CADGeometryPtr DecodeEntity(CADStickyBitStreamReader& reader, uint64_t handle, int16_t color)
+        {
+            typename Schema::ObjectType data;
+            Schema::Read(reader, data);
+            TrimTerminators(data);
+
+            return std::make_shared<CADEntityGeometry<Schema>>(handle, color, std::move(data));
+        }
+
+
+        /*
+         * Chunks owned by one thread: the owner takes them from the front, thieves from the
+         * back. Both ends live in a single word, a compare and swap takes one chunk. The
+         * queue fills a cache line, so in an array the words of neighbours are a line apart
+         * and never share one, even where the allocation itself is not line aligned.
+         */
+        struct alignas(64) CADChunkQueue
+        {
+            std::atomic<uint64_t>   range;  // end chunk in the high half, next one in the low half
+        };
+
+        static_assert(sizeof(CADChunkQueue) == 64, "CADChunkQueue has to fill a cache line");
+
+
+        uint64_t MakeChunkRange(uint32_t firstChunk, uint32_t endChunk)
+        { return static_cast<uint64_t>(endChunk) << 32 | firstChunk; }
+
+
+        bool TakeFrontChunk(CADChunkQueue& queue, size_t& chunkIdx)
+        {
+            uint64_t range = queue.range.load();
+            while (true)
+            {
+                uint32_t firstChunk = static_cast<uint32_t>(range);
+                uint32_t endChunk = static_cast<uint32_t>(range >> 32);
+                if (firstChunk >= endChunk)
+                    return false;
+
+                if (queue.range.compare_exchange_weak(range, MakeChunkRange(firstChunk + 1, endChunk)))
+                {
+                    chunkIdx = firstChunk;
+                    return true;
+                }
+            }
+        }
+
+
+        bool TakeBackChunk(CADChunkQueue& queue, size_t& chunkIdx)
+        {
+            uint64_t range = queue.range.load();
+            while (true)
+            {
+                uint32_t firstChunk = static_cast<uint32_t>(range);
+                uint32_t endChunk = static_cast<uint32_t>(range >> 32);
+                if (firstChunk >= endChunk)
+                    return false;
+
+                if (queue.range.compare_exchange_weak(range, MakeChunkRange(firstChunk, endChunk - 1)))
+                {
+                    chunkIdx = endChunk - 1;
+                    return true;
+                }
+            }
+        }
+
+
+        struct CADChunksJob
+        {
+            CADChunksJob(size_t tasksCount, size_t threadsCount, const CADDecodeTask& decodeTask)
+                : count(tasksCount),
+                  queues(threadsCount),
+                  task(decodeTask),
+                  stopped(false)
+            { }
+
+            size_t                      count;
+            std::vector<CADChunkQueue>  queues;     // one per thread
+            const CADDecodeTask&        task;
+
+            std::atomic<bool>           stopped;
+            std::mutex                  mutex;
+            std::exception_ptr          error;
+        };
+
+
+        // Own chunks first, then the others' in a fixed order starting past this thread
+        bool TakeChunk(CADChunksJob& job, size_t threadIdx, size_t& chunkIdx)
+        {
+            if (TakeFrontChunk(job.queues[threadIdx], chunkIdx))
+                return true;
+
+            for (size_t victim = 1; victim < job.queues.size(); ++victim)
+            {
+                if (TakeBackChunk(job.queues[(threadIdx + victim) % job.queues.size()], chunkIdx))
+                    return true;
+            }
+
+            return false;
+        }
+
+
+        // Every thread has its own scratch buffer, tasks write to their own result slots only
+        void RunChunksThread(CADChunksJob& job, size_t threadIdx)
+        {
+            ByteArray scratch;
+
+            try
+            {
+                size_t chunkIdx;
+                while (!job.stopped && TakeChunk(job, threadIdx, chunkIdx))
+                {
+                    size_t firstIdx = chunkIdx * DECODE_CHUNK_SIZE;
+                    job.task(firstIdx, std::min(firstIdx + DECODE_CHUNK_SIZE, job.count), scratch);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(job.mutex);
+                if (!job.error)
+                    job.error = std::current_exception();
+                job.stopped = true;
+            }
+        }
+
+    }
+
+
+    CADGeometryPtr DecodeCADGeometry(CADStickyBitStreamReader& stream, int16_t type,
+                                     const CADObjectHeader& objectHeader, const CADEntityHeader& entityHeader)
+    {
+        uint64_t handle = objectHeader.handle;
+        int16_t color = entityHeader.color;
+
+        switch (type)
+        {
+            case CADObject::LINE:
+                return DecodeEntity<CADLineSchema>(stream, handle, color);
+            case CADObject::CIRCLE:
+                return DecodeEntity<CADCircleSchema>(stream, handle, color);
+            case CADObject::ARC:
+                return DecodeEntity<CADArcSchema>(stream, handle, color);
+            case CADObject::LWPOLYLINE:
+                return DecodeEntity<CADLWPolylineSchema>(stream, handle, color);
+            case CADObject::TEXT:
+                return DecodeEntity<CADTextSchema>(stream, handle, color);
+            case CADObject::INSERT:
+                return DecodeEntity<CADInsertSchema>(stream, handle, color);
+            default:
+                return std::make_shared<CADGeometry>(static_cast<CADObject::Type>(type), handle, color);
+        }
+    }
+
+
+    const uint8_t* ReadCADObjectData(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch,
+                                     size_t& dataSize)
+    {
+        const CADObjectDirectory& objects = reader.GetLayout().objects;
+        if (objectIdx >= objects.GetCount() || !objects.IsReadable(objectIdx))
+            return nullptr;
+
+        size_t dataOffset = objects.GetDataOffset(objectIdx);
+        dataSize = objects.GetSize(objectIdx);
+
+        const uint8_t* bytes = reader.GetFileIO().ViewAt(dataOffset, dataSize);
+        if (bytes != nullptr)
+            return bytes;
+
+        dataSize = reader.GetFileIO().ReadAt(dataOffset, scratch, dataSize);
+        return scratch.data();
+    }
+
+
+    CADGeometryPtr DecodeCADGeometry(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch)
+    {
+        size_t dataSize = 0;
+        const uint8_t* bytes = ReadCADObjectData(reader, objectIdx, scratch, dataSize);
+        if (bytes == nullptr)
+            return nullptr;
+
+        CADStickyBitStreamReader stream(bytes, dataSize);
+        int16_t type = stream.ReadBitShort();
+
+        CADObjectHeader objectHeader;
+        ReadCADObjectHeader(stream, objectHeader);
+
+        CADEntityHeader entityHeader;
+        ReadCADEntityHeader(stream, entityHeader);
+
+        CADGeometryPtr geometry = DecodeCADGeometry(stream, type, objectHeader, entityHeader);
+        return stream.GetError() == CADReadError::NONE ? geometry : nullptr;
+    }
+
+
+    void RunCADDecodeTasks(size_t count, size_t threadsCount, const CADDecodeTask& task)
+    {
+        if (threadsCount == 0)
+            threadsCount = std::max(1u, std::thread::hardware_concurrency());
+
+        size_t chunksCount = (count + DECODE_CHUNK_SIZE - 1) / DECODE_CHUNK_SIZE;
+        threadsCount = std::max<size_t>(1, std::min(threadsCount, chunksCount));
+
+        CADChunksJob job(count, threadsCount, task);
+
+        // Contiguous runs of chunks, a thread reads neighbouring objects until it steals
+        for (size_t threadIdx = 0; threadIdx < threadsCount; ++threadIdx)
+        {
+            job.queues[threadIdx].range = MakeChunkRange(static_cast<uint32_t>(chunksCount * threadIdx / threadsCount),
+                static_cast<uint32_t>(chunksCount * (threadIdx + 1) / threadsCount));
+        }
+
+        // Thread 0 is the calling one
+        std::vector<std::thread> workers;
+        for (size_t threadIdx = 1; threadIdx < threadsCount; ++threadIdx)
+            workers.push_back(std::thread(RunChunksThread, std::ref(job), threadIdx));
+        RunChunksThread(job, 0);
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        if (job.error)
+            std::rethrow_exception(job.error);
+    }
+
+
+    std::vector<CADGeometryPtr> DecodeCADGeometries(const CADFileReader& reader, const uint32_t* objects,
+                                                    size_t count, size_t threadsCount)
+    {
+        std::vector<CADGeometryPtr> geometries(count);
+        RunCADDecodeTasks(count, threadsCount, [&](size_t firstIdx, size_t lastIdx, ByteArray& scratch)
+        {
+            for (size_t idx = firstIdx; idx < lastIdx; ++idx)
+                geometries[idx] = DecodeCADGeometry(reader, objects[idx], scratch);
+        });
+
+        return geometries;
+    }
+
+}
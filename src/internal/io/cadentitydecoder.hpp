@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADENTITYDECODER_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADENTITYDECODER_HPP
+
+#include "cadfilereader.hpp"
+#include "../objects/cadobjectheader.hpp"
+#include "libopencad/cadgeometry.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace libopencad
+{
+
+    // Data of the object at objectIdx, read into scratch when the file can not lend its
+    // memory. nullptr if the object is out of the file, dataSize may come short.
+    const uint8_t* ReadCADObjectData(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch,
+                                     size_t& dataSize);
+
+    // Decodes the geometry of an entity whose headers were just read from stream, the
+    // caller tests the stream for errors
+    CADGeometryPtr DecodeCADGeometry(CADStickyBitStreamReader& stream, int16_t type,
+                                     const CADObjectHeader& objectHeader, const CADEntityHeader& entityHeader);
+
+    /*
+     * Decodes the entity at objectIdx of the directory. scratch holds the object's bytes
+     * when the file can not lend its memory, reusing it saves an allocation per entity.
+     * Entity types without a schema come as a plain CADGeometry, nullptr if the entity is
+     * damaged or out of the file.
+     */
+    CADGeometryPtr DecodeCADGeometry(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch);
+
+    // Decodes the items [firstIdx, lastIdx) of a list, scratch belongs to the calling thread
+    using CADDecodeTask = std::function<void(size_t firstIdx, size_t lastIdx, ByteArray& scratch)>;
+
+    /*
+     * Runs task over [0, count) on threadsCount threads (0 means one per core), the calling
+     * thread included. The range is cut in chunks spread evenly over the threads, a thread
+     * out of work steals chunks from the tail of the others. Tasks writing to the slots of
+     * their items only give the same results on any number of threads. The first exception
+     * thrown by a task is rethrown once every thread has stopped.
+     */
+    void RunCADDecodeTasks(size_t count, size_t threadsCount, const CADDecodeTask& task);
+
+    /*
+     * Decodes count entities with RunCADDecodeTasks, geometries come in the order of
+     * objects. I/O errors are rethrown, damaged entities yield nullptr.
+     */
+    std::vector<CADGeometryPtr> DecodeCADGeometries(const CADFileReader& reader, const uint32_t* objects,
+                                                    size_t count, size_t threadsCount = 0);
+
+}
+
+#endif
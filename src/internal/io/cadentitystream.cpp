@@ -0,0 +1,223 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadentitystream.hpp"
+#include "cadentitydecoder.hpp"
+#include "cadrangeplanner.hpp"
+
+#include <algorithm>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        // Reads of neighbouring entities are merged across gaps (other objects) up to
+        // STREAM_READ_GAP bytes into reads of up to STREAM_READ_SIZE bytes
+        const size_t STREAM_READ_GAP = 64 * 1024;
+        const size_t STREAM_READ_SIZE = 1024 * 1024;
+        const size_t STREAM_BUFFERS_COUNT = 4;
+
+        // Entity ranges planned at once, bounds the planner's temporary copies
+        const size_t STREAM_PLAN_BATCH_SIZE = 4096;
+
+    }
+
+
+    CADEntityStream::CADEntityStream(const CADFileReader& reader, const CADReadFilter& filter)
+        : _reader(reader),
+          _position(0),
+          _damagedCount(0),
+          _filteredCount(0),
+          _filteredBytes(0),
+          _layers(filter.layers),
+          _color(filter.color),
+          _readRange(),
+          _readData(nullptr)
+    {
+        const CADObjectDirectory& objects = reader.GetLayout().objects;
+        for (int16_t type = CADObject::TEXT; type <= CADObject::HATCH; ++type)
+        {
+            if (!IsCADLayerEntityType(type))
+                continue;
+
+            const uint32_t* begin = objects.GetTypeBegin(static_cast<uint8_t>(type));
+            const uint32_t* end = objects.GetTypeEnd(static_cast<uint8_t>(type));
+
+            // Types left out are known from the directory, their data is never read
+            if (!filter.types.empty() &&
+                std::find(filter.types.begin(), filter.types.end(), type) == filter.types.end())
+            {
+                for (const uint32_t* objectIdx = begin; objectIdx != end; ++objectIdx)
+                    FilterOut(*objectIdx);
+                continue;
+            }
+
+            _objects.insert(_objects.end(), begin, end);
+        }
+
+        std::sort(_layers.begin(), _layers.end());
+
+        std::sort(_objects.begin(), _objects.end(), [&objects](uint32_t first, uint32_t second)
+                  { return objects.GetOffset(first) < objects.GetOffset(second); });
+
+        if (_objects.empty() ||
+            reader.GetFileIO().ViewAt(objects.GetDataOffset(_objects[0]), objects.GetSize(_objects[0])) != nullptr)
+            return;
+
+        CADRangePlanner planner(STREAM_READ_GAP, STREAM_READ_SIZE);
+        std::vector<CADByteRange> reads;
+        std::vector<CADByteRange> ranges;
+        for (size_t firstIdx = 0; firstIdx < _objects.size(); firstIdx += STREAM_PLAN_BATCH_SIZE)
+        {
+            ranges.clear();
+
+            size_t lastIdx = std::min(firstIdx + STREAM_PLAN_BATCH_SIZE, _objects.size());
+            for (size_t idx = firstIdx; idx < lastIdx; ++idx)
+                ranges.push_back(CADByteRange { objects.GetDataOffset(_objects[idx]), objects.GetSize(_objects[idx]) });
+
+            std::vector<CADByteRange> planned = planner.Plan(ranges);
+            reads.insert(reads.end(), planned.begin(), planned.end());
+        }
+
+        _prefetcher.reset(new CADPrefetcher(reader.GetFileIO(), reads, STREAM_BUFFERS_COUNT));
+    }
+
+
+    bool CADEntityStream::Next(CADGeometryPtr& geometry, uint64_t& layerHandle)
+    {
+        const CADObjectDirectory& objects = _reader.GetLayout().objects;
+
+        while (_position < _objects.size())
+        {
+            size_t objectIdx = _objects[_position++];
+            const uint8_t* data = ReadObjectData(objectIdx);
+            if (data == nullptr)
+            {
+                ++_damagedCount;
+                continue;
+            }
+
+            CADStickyBitStreamReader stream(data, objects.GetSize(objectIdx));
+            int16_t type = stream.ReadBitShort();
+
+            CADObjectHeader objectHeader;
+            ReadCADObjectHeader(stream, objectHeader);
+
+            CADEntityHeader entityHeader;
+            ReadCADEntityHeader(stream, entityHeader);
+
+            // Block and layout contents are left out like in the layers
+            if (stream.GetError() == CADReadError::NONE && entityHeader.ownerMode != 2)
+                continue;
+
+            if (_color && stream.GetError() == CADReadError::NONE && !_color(entityHeader.color))
+            {
+                FilterOut(objectIdx);
+                continue;
+            }
+
+            if (_layers.empty())
+            {
+                geometry = DecodeCADGeometry(stream, type, objectHeader, entityHeader);
+                layerHandle = ReadCADEntityLayer(stream, objectHeader, entityHeader);
+            }
+            else
+            {
+                // The layer handle closes the object, the geometry in between is jumped over
+                size_t geometryOffset = stream.GetOffset();
+                layerHandle = ReadCADEntityLayer(stream, objectHeader, entityHeader);
+                if (stream.GetError() == CADReadError::NONE &&
+                    !std::binary_search(_layers.begin(), _layers.end(), layerHandle))
+                {
+                    FilterOut(objectIdx);
+                    continue;
+                }
+
+                stream.SetOffset(geometryOffset);
+                geometry = DecodeCADGeometry(stream, type, objectHeader, entityHeader);
+            }
+
+            if (stream.GetError() != CADReadError::NONE)
+            {
+                ++_damagedCount;
+                continue;
+            }
+
+            return true;
+        }
+
+        geometry.reset();
+        return false;
+    }
+
+
+    void CADEntityStream::FilterOut(size_t objectIdx)
+    {
+        ++_filteredCount;
+        _filteredBytes += _reader.GetLayout().objects.GetSize(objectIdx);
+    }
+
+
+    const uint8_t* CADEntityStream::ReadObjectData(size_t objectIdx)
+    {
+        const CADObjectDirectory& objects = _reader.GetLayout().objects;
+        size_t dataOffset = objects.GetDataOffset(objectIdx);
+        size_t dataSize = objects.GetSize(objectIdx);
+
+        // Backends lending their memory may still refuse some ranges, e.g. across chunks
+        if (!_prefetcher)
+        {
+            const uint8_t* bytes = _reader.GetFileIO().ViewAt(dataOffset, dataSize);
+            if (bytes != nullptr)
+                return bytes;
+
+            if (_reader.GetFileIO().ReadAt(dataOffset, _scratch, dataSize) != dataSize)
+                return nullptr;
+            return _scratch.data();
+        }
+
+        // Reads come in offset order, each one covering whole entities
+        while (_readData == nullptr || dataOffset + dataSize > _readRange.offset + _readRange.size)
+        {
+            if (!_prefetcher->Next(_readRange, _readData))
+            {
+                _readData = nullptr;
+                return nullptr;
+            }
+        }
+
+        // Short read at the end of the file
+        if (dataOffset < _readRange.offset || dataOffset + dataSize > _readRange.offset + _readData->size())
+            return nullptr;
+
+        return _readData->data() + (dataOffset - _readRange.offset);
+    }
+
+}
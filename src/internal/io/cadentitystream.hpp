@@ -0,0 +1,113 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADENTITYSTREAM_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADENTITYSTREAM_HPP
+
+#include "cadfilereader.hpp"
+#include "cadprefetcher.hpp"
+#include "libopencad/cadgeometry.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace libopencad
+{
+
+    /*
+     * Entities to keep, tested before their geometry is decoded: the type from the object
+     * directory (other types are not even read), the color from the common entity data
+     * and the layer from the handle stream. Empty lists and predicate keep everything.
+     */
+    struct CADReadFilter
+    {
+        std::vector<int16_t>                types;      // CADObject::Type values
+        std::vector<uint64_t>               layers;     // layer handles
+        std::function<bool(int16_t color)>  color;
+    };
+
+
+    /*
+     * Model space entities of a drawing decoded one at a time in file order, in a single
+     * sequential pass over the object data. Files that lend their memory are decoded in
+     * place, an object they refuse to lend is read on its own. The others are read ahead
+     * in large merged reads by a CADPrefetcher, so the bytes held stay within a few read
+     * buffers whatever the size of the drawing. Besides them the stream keeps the
+     * entities' directory indices sorted by offset, 4 bytes each.
+     */
+    class CADEntityStream
+    {
+    public:
+        explicit CADEntityStream(const CADFileReader& reader, const CADReadFilter& filter = CADReadFilter());
+
+        // Next entity and the handle of its layer, false once all were read. Damaged
+        // entities and the ones left out by the filter are skipped and counted.
+        bool Next(CADGeometryPtr& geometry, uint64_t& layerHandle);
+
+        size_t GetDamagedCount() const
+        { return _damagedCount; }
+
+        // Entities left out by the filter and the bytes of their data, which were either
+        // not read (type) or read up to the common data and the layer handle only. Types
+        // left out count entities of every space, their owner is never read.
+        size_t GetFilteredCount() const
+        { return _filteredCount; }
+
+        size_t GetFilteredBytes() const
+        { return _filteredBytes; }
+
+    private:
+        CADEntityStream(const CADEntityStream&) = delete;
+        CADEntityStream& operator=(const CADEntityStream&) = delete;
+
+        // nullptr if the object's data could not be read
+        const uint8_t* ReadObjectData(size_t objectIdx);
+
+        void FilterOut(size_t objectIdx);
+
+    private:
+        const CADFileReader&            _reader;
+        std::vector<uint32_t>           _objects;   // entities in offset order
+        size_t                          _position;
+        size_t                          _damagedCount;
+        size_t                          _filteredCount;
+        size_t                          _filteredBytes;
+
+        std::vector<uint64_t>           _layers;    // filter's layers, sorted
+        std::function<bool(int16_t)>    _color;
+
+        std::unique_ptr<CADPrefetcher>  _prefetcher;
+        CADByteRange                    _readRange;
+        const ByteArray*                _readData;
+        ByteArray                       _scratch;   // objects a lending backend refused
+    };
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadfileio.hpp"
+
+#include <algorithm>
+
+namespace libopencad
+{
+
+    ICADFileIO::~ICADFileIO()
+    { }
+
+
+    ByteArray ICADFileIO::Read(size_t bytesCount)
+    {
+        ByteArray result;
+        ReadInto(result, bytesCount);
+        return result;
+    }
+
+
+    size_t ICADFileIO::ReadInto(ByteArray& scratch, size_t bytesCount)
+    {
+        scratch.resize(bytesCount);
+        size_t readCount = ReadInto(scratch.data(), bytesCount);
+        scratch.resize(readCount);
+
+        return readCount;
+    }
+
+
+    const uint8_t* ICADFileIO::ReadView(size_t)
+    { return nullptr; }
+
+
+    size_t ICADFileIO::ReadAt(size_t offset, ByteArray& scratch, size_t bytesCount) const
+    {
+        scratch.resize(bytesCount);
+        size_t readCount = ReadAt(offset, scratch.data(), bytesCount);
+        scratch.resize(readCount);
+
+        return readCount;
+    }
+
+
+    const uint8_t* ICADFileIO::ViewAt(size_t, size_t) const
+    { return nullptr; }
+
+
+    size_t ICADFileIO::SeekCursor(size_t& position, int64_t offset, SeekOrigin origin) const
+    {
+        int64_t base = 0;
+
+        switch (origin)
+        {
+        case SeekOrigin::BEG:
+            base = 0;
+            break;
+
+        case SeekOrigin::CUR:
+            base = static_cast<int64_t>(position);
+            break;
+
+        case SeekOrigin::END:
+            base = static_cast<int64_t>(GetSize());
+            break;
+        }
+
+        int64_t target = std::max<int64_t>(0, base + offset);
+        position = std::min(static_cast<size_t>(target), GetSize());
+
+        return position;
+    }
+
+
+    size_t ICADFileIO::ReadIntoAt(size_t& position, void* buffer, size_t bytesCount) const
+    {
+        size_t readCount = ReadAt(position, buffer, bytesCount);
+        position += readCount;
+
+        return readCount;
+    }
+
+
+    const uint8_t* ICADFileIO::ViewAtCursor(size_t& position, size_t bytesCount) const
+    {
+        const uint8_t* result = ViewAt(position, bytesCount);
+        if (result)
+            position += bytesCount;
+
+        return result;
+    }
+
+}
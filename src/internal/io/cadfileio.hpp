@@ -29,6 +29,7 @@
 #ifndef LIBOPENCAD_INTERNAL_IO_CADFILEIO_HPP
 #define LIBOPENCAD_INTERNAL_IO_CADFILEIO_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -37,6 +38,13 @@ using ByteArray = std::vector<uint8_t>;
 namespace libopencad
 {
 
+    struct CADByteRange
+    {
+        size_t  offset;
+        size_t  size;
+    };
+
+
     struct ICADFileIO
     {
     public:
@@ -50,7 +58,28 @@ namespace libopencad
     public:
         virtual ~ICADFileIO();
 
-        virtual size_t Read(size_t bytesCount) = 0;
+        virtual ByteArray Read(size_t bytesCount);
+
+        // Copies up to bytesCount bytes into a caller supplied buffer, returns bytes read
+        virtual size_t ReadInto(void* buffer, size_t bytesCount) = 0;
+
+        // Same, but into a reusable scratch buffer: it is resized to the bytes read and keeps its capacity
+        size_t ReadInto(ByteArray& scratch, size_t bytesCount);
+
+        // Borrowed pointer to the next bytesCount bytes, valid while the backend is alive.
+        // Returns nullptr (cursor unchanged) if the backend can not lend its memory or fewer bytes are left.
+        virtual const uint8_t* ReadView(size_t bytesCount);
+
+        /*
+         * Positional reads. They neither use nor move the cursor and are safe to call
+         * from any number of threads at once, also concurrently with cursor reads.
+         */
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const = 0;
+        size_t ReadAt(size_t offset, ByteArray& scratch, size_t bytesCount) const;
+        virtual const uint8_t* ViewAt(size_t offset, size_t bytesCount) const;
+
+        virtual size_t GetSize() const = 0;
+
         virtual size_t Write(const ByteArray& data) = 0;
         virtual size_t Seek(int64_t offset, SeekOrigin origin) = 0;
         virtual size_t Tell() const = 0;
@@ -58,6 +87,15 @@ namespace libopencad
         virtual bool Eof() const = 0;
         virtual bool IsOpened() const = 0;
 
+    protected:
+        /*
+         * Cursor reads of backends built on ReadAt/ViewAt, over a cursor they keep. Seeks
+         * clamp the cursor to [0, GetSize()], so Tell() never passes the end.
+         */
+        size_t SeekCursor(size_t& position, int64_t offset, SeekOrigin origin) const;
+        size_t ReadIntoAt(size_t& position, void* buffer, size_t bytesCount) const;
+        const uint8_t* ViewAtCursor(size_t& position, size_t bytesCount) const;
+
     };
 
 }
@@ -0,0 +1,470 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadfilelayout.hpp"
+#include "cadbitstreamreader.hpp"
+#include "cadcrc.hpp"
+#include "cadrangeplanner.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const size_t FILE_HEADER_SIZE = 0x19;       // up to the section locators
+        const size_t SECTION_LOCATOR_SIZE = 9;
+        const size_t MAX_SECTION_LOCATORS = 16;
+        const size_t MAX_OBJECT_MAP_SECTION_SIZE = 2040;
+
+        // Objects taken by a validator worker at once
+        const size_t VALIDATION_BATCH_SIZE = 256;
+
+        // Object headers are read in merged reads: headers closer than HEADER_READ_GAP bytes
+        // share a read of up to HEADER_READ_SIZE bytes, planned HEADER_PLAN_BATCH_SIZE at once
+        const size_t OBJECT_HEADER_SIZE = 12;
+        const size_t HEADER_READ_GAP = 64 * 1024;
+        const size_t HEADER_READ_SIZE = 1024 * 1024;
+        const size_t HEADER_PLAN_BATCH_SIZE = 4096;
+
+
+        uint16_t ReadLittleEndian16(const uint8_t* data)
+        { return static_cast<uint16_t>(data[0] | (data[1] << 8)); }
+
+
+        uint32_t ReadLittleEndian32(const uint8_t* data)
+        { return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24); }
+
+
+        // File header CRC is xored with a constant depending on the count of locators
+        uint16_t FileHeaderCrcMask(size_t locatorsCount)
+        {
+            switch (locatorsCount)
+            {
+                case 3: return 0xA598;
+                case 4: return 0x8101;
+                case 5: return 0x3CC4;
+                case 6: return 0x8461;
+                default: return 0;
+            }
+        }
+
+
+        // Byte aligned modular char, signed ones keep the sign in bit 6 of the last byte
+        bool ReadModularChar(const uint8_t*& data, const uint8_t* end, bool isSigned, int64_t& value)
+        {
+            uint64_t result = 0;
+            for (size_t shift = 0; data < end && shift < 64; shift += 7)
+            {
+                uint8_t byte = *data++;
+                if (byte & 0x80)
+                {
+                    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    continue;
+                }
+
+                if (isSigned)
+                {
+                    result |= static_cast<uint64_t>(byte & 0x3F) << shift;
+                    value = (byte & 0x40) ? -static_cast<int64_t>(result) : static_cast<int64_t>(result);
+                }
+                else
+                {
+                    result |= static_cast<uint64_t>(byte) << shift;
+                    value = static_cast<int64_t>(result);
+                }
+                return true;
+            }
+
+            return false;
+        }
+
+
+        // Parses the MS size and the BS type opening an object from its first readCount
+        // bytes, type 0 if they do not fit into the file
+        uint16_t ParseObjectHeader(const uint8_t* bytes, size_t readCount, size_t objectOffset, size_t fileSize,
+                                   size_t& size)
+        {
+            // MS: little endian 16-bit words, the high bit of each tells another one follows.
+            // The type follows in at most 18 bits.
+            size = 0;
+            for (size_t wordIdx = 0; wordIdx < 3 && 2 * wordIdx + 1 < readCount; ++wordIdx)
+            {
+                uint16_t word = ReadLittleEndian16(bytes + 2 * wordIdx);
+                size |= static_cast<size_t>(word & 0x7FFF) << (15 * wordIdx);
+                if (word & 0x8000)
+                    continue;
+
+                // Sizes written in a longer form than needed are not expected, the
+                // directory derives the data offset from the size
+                size_t dataOffset = 2 * (wordIdx + 1);
+                if (dataOffset != (size < 0x8000 ? 2u : 4u) || objectOffset + dataOffset + size + 2 > fileSize)
+                    return 0;
+
+                CADStickyBitStreamReader reader(bytes + dataOffset, std::min(readCount - dataOffset, size));
+                int16_t type = reader.ReadBitShort();
+                return reader.GetError() == CADReadError::NONE ? static_cast<uint16_t>(type) : 0;
+            }
+
+            return 0;
+        }
+
+
+        /*
+         * Adds the objects of the entries to the directory. Their headers are parsed in place
+         * from fileData (the whole file, nullptr if the backend does not lend it), otherwise
+         * read in few merged reads.
+         */
+        void AddObjects(const ICADFileIO& fileIO, const uint8_t* fileData,
+                        const std::vector<CADObjectMapEntry>& entries, CADObjectDirectory& objects)
+        {
+            size_t fileSize = fileIO.GetSize();
+            if (fileData != nullptr)
+            {
+                for (const CADObjectMapEntry& entry : entries)
+                {
+                    size_t objectSize = 0;
+                    uint16_t objectType = 0;
+                    if (entry.offset < fileSize)
+                        objectType = ParseObjectHeader(fileData + entry.offset,
+                                                       std::min(OBJECT_HEADER_SIZE, fileSize - entry.offset),
+                                                       entry.offset, fileSize, objectSize);
+                    objects.Add(entry.handle, entry.offset, objectSize, objectType);
+                }
+                return;
+            }
+
+            std::vector<CADByteRange> ranges;
+            ranges.reserve(entries.size());
+            for (const CADObjectMapEntry& entry : entries)
+            {
+                if (entry.offset < fileSize)
+                    ranges.push_back(CADByteRange { entry.offset,
+                                                    std::min(OBJECT_HEADER_SIZE, fileSize - entry.offset) });
+            }
+
+            std::vector<CADByteRange> reads = CADRangePlanner(HEADER_READ_GAP, HEADER_READ_SIZE).Plan(ranges);
+
+            // Entries are visited in offset order, so that a read is fetched once
+            std::vector<uint32_t> order(entries.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&entries](uint32_t first, uint32_t second)
+                             { return entries[first].offset < entries[second].offset; });
+
+            std::vector<size_t> sizes(entries.size(), 0);
+            std::vector<uint16_t> types(entries.size(), 0);
+
+            ByteArray buffer;
+            const uint8_t* readData = nullptr;
+            size_t readSize = 0;
+            size_t readIdx = 0;
+            for (uint32_t entryIdx : order)
+            {
+                size_t objectOffset = entries[entryIdx].offset;
+                if (objectOffset >= fileSize)
+                    continue;
+
+                if (readData == nullptr || objectOffset >= reads[readIdx].offset + reads[readIdx].size)
+                {
+                    while (objectOffset >= reads[readIdx].offset + reads[readIdx].size)
+                        ++readIdx;
+
+                    const CADByteRange& read = reads[readIdx];
+                    readData = fileIO.ViewAt(read.offset, read.size);
+                    readSize = read.size;
+                    if (readData == nullptr)
+                    {
+                        readSize = fileIO.ReadAt(read.offset, buffer, read.size);
+                        readData = buffer.data();
+                    }
+                }
+
+                // A header split between two reads (overlapping objects) or cut by a short read
+                size_t headerSize = std::min(OBJECT_HEADER_SIZE, fileSize - objectOffset);
+                uint8_t header[OBJECT_HEADER_SIZE];
+                const uint8_t* bytes = header;
+                if (objectOffset + headerSize <= reads[readIdx].offset + readSize)
+                    bytes = readData + (objectOffset - reads[readIdx].offset);
+                else
+                    headerSize = fileIO.ReadAt(objectOffset, header, headerSize);
+
+                types[entryIdx] = ParseObjectHeader(bytes, headerSize, objectOffset, fileSize, sizes[entryIdx]);
+            }
+
+            for (size_t entryIdx = 0; entryIdx < entries.size(); ++entryIdx)
+                objects.Add(entries[entryIdx].handle, entries[entryIdx].offset, sizes[entryIdx], types[entryIdx]);
+        }
+
+    }
+
+
+    const CADSectionLocator* CADFileLayout::FindSection(CADSectionNumber number) const
+    {
+        for (const CADSectionLocator& locator : sections)
+        {
+            if (locator.number == static_cast<uint8_t>(number))
+                return &locator;
+        }
+
+        return nullptr;
+    }
+
+
+    CADFileLayout ReadCADFileHeader(const ICADFileIO& fileIO)
+    {
+        uint8_t header[FILE_HEADER_SIZE + MAX_SECTION_LOCATORS * SECTION_LOCATOR_SIZE + 2];
+        if (fileIO.ReadAt(0, header, FILE_HEADER_SIZE) != FILE_HEADER_SIZE)
+            throw std::runtime_error("ReadCADFileHeader: file header is truncated");
+
+        CADFileLayout layout;
+        layout.version.assign(header, header + 6);
+        if (layout.version != "AC1015")
+            throw std::runtime_error("ReadCADFileHeader: unsupported version " + layout.version);
+
+        size_t locatorsCount = ReadLittleEndian32(header + 0x15);
+        if (locatorsCount > MAX_SECTION_LOCATORS)
+            throw std::runtime_error("ReadCADFileHeader: file header is corrupted");
+
+        size_t headerSize = FILE_HEADER_SIZE + locatorsCount * SECTION_LOCATOR_SIZE;
+        if (fileIO.ReadAt(FILE_HEADER_SIZE, header + FILE_HEADER_SIZE, headerSize + 2 - FILE_HEADER_SIZE) !=
+            headerSize + 2 - FILE_HEADER_SIZE)
+            throw std::runtime_error("ReadCADFileHeader: file header is truncated");
+
+        for (size_t locatorIdx = 0; locatorIdx < locatorsCount; ++locatorIdx)
+        {
+            const uint8_t* record = header + FILE_HEADER_SIZE + locatorIdx * SECTION_LOCATOR_SIZE;
+            layout.sections.push_back(CADSectionLocator { record[0], ReadLittleEndian32(record + 1),
+                                                          ReadLittleEndian32(record + 5) });
+        }
+
+        uint16_t storedCrc = ReadLittleEndian16(header + headerSize);
+        uint16_t computedCrc = CalculateCADCrc(header, headerSize, CAD_CRC_FILE_HEADER_SEED) ^
+                               FileHeaderCrcMask(locatorsCount);
+        if (storedCrc != computedCrc)
+            layout.crcMismatches.push_back(CADCrcMismatch { { 0, headerSize }, storedCrc, computedCrc });
+
+        return layout;
+    }
+
+
+    CADObjectMapReader::CADObjectMapReader(const ICADFileIO& fileIO, const CADSectionLocator& locator)
+        : _fileIO(fileIO),
+          _offset(locator.offset),
+          _finished(false)
+    { }
+
+
+    bool CADObjectMapReader::ReadSection(std::vector<CADObjectMapEntry>& entries,
+                                         std::vector<CADCrcMismatch>& crcMismatches)
+    {
+        if (_finished)
+            return false;
+
+        // Sections: RS big endian size (counting itself), handle/offset pairs, big endian CRC
+        uint8_t sizeBytes[2];
+        if (_fileIO.ReadAt(_offset, sizeBytes, 2) != 2)
+            throw std::runtime_error("CADObjectMapReader: object map is truncated");
+
+        size_t sectionSize = (sizeBytes[0] << 8) | sizeBytes[1];
+        if (sectionSize == 2)
+        {
+            _finished = true;
+            return false;
+        }
+
+        if (sectionSize < 2 || sectionSize > MAX_OBJECT_MAP_SECTION_SIZE)
+            throw std::runtime_error("CADObjectMapReader: object map is corrupted");
+
+        if (_fileIO.ReadAt(_offset, _section, sectionSize + 2) != sectionSize + 2)
+            throw std::runtime_error("CADObjectMapReader: object map is truncated");
+
+        uint16_t storedCrc = static_cast<uint16_t>((_section[sectionSize] << 8) | _section[sectionSize + 1]);
+        uint16_t computedCrc = CalculateCADCrc(_section.data(), sectionSize, CAD_CRC_SECTION_SEED);
+        if (storedCrc != computedCrc)
+            crcMismatches.push_back(CADCrcMismatch { { _offset, sectionSize }, storedCrc, computedCrc });
+
+        // Handles and offsets are deltas, restarting from zero in every section
+        const uint8_t* data = _section.data() + 2;
+        const uint8_t* end = _section.data() + sectionSize;
+        uint64_t handle = 0;
+        int64_t objectOffset = 0;
+        while (data < end)
+        {
+            int64_t handleDelta, offsetDelta;
+            if (!ReadModularChar(data, end, false, handleDelta) || !ReadModularChar(data, end, true, offsetDelta))
+                throw std::runtime_error("CADObjectMapReader: object map is corrupted");
+
+            handle += static_cast<uint64_t>(handleDelta);
+            objectOffset += offsetDelta;
+            if (objectOffset < 0)
+                throw std::runtime_error("CADObjectMapReader: object map is corrupted");
+
+            entries.push_back(CADObjectMapEntry { handle, static_cast<size_t>(objectOffset) });
+        }
+
+        _offset += sectionSize + 2;
+        return true;
+    }
+
+
+    CADFileLayout ReadCADFileLayout(const ICADFileIO& fileIO)
+    {
+        CADFileLayout layout = ReadCADFileHeader(fileIO);
+
+        const CADSectionLocator* objectMap = layout.FindSection(CADSectionNumber::OBJECT_MAP);
+        if (objectMap == nullptr)
+            throw std::runtime_error("ReadCADFileLayout: object map is missing");
+
+        CADObjectMapReader mapReader(fileIO, *objectMap);
+        std::vector<CADObjectMapEntry> entries;
+        const uint8_t* fileData = fileIO.ViewAt(0, fileIO.GetSize());
+        bool mapRead = false;
+        while (!mapRead)
+        {
+            mapRead = !mapReader.ReadSection(entries, layout.crcMismatches);
+            if (entries.size() < HEADER_PLAN_BATCH_SIZE && !mapRead)
+                continue;
+
+            AddObjects(fileIO, fileData, entries, layout.objects);
+            entries.clear();
+        }
+
+        layout.objects.Sort();
+        layout.objects.Compact();
+
+        return layout;
+    }
+
+
+    CADObjectCrcValidator::CADObjectCrcValidator(const ICADFileIO& fileIO, const CADObjectDirectory& objects,
+                                                 size_t threadsCount)
+        : _fileIO(fileIO),
+          _objects(objects),
+          _nextIdx(0)
+    {
+        if (threadsCount == 0)
+            threadsCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        for (size_t threadIdx = 0; threadIdx < threadsCount; ++threadIdx)
+            _workers.push_back(std::thread(&CADObjectCrcValidator::Run, this));
+    }
+
+
+    CADObjectCrcValidator::~CADObjectCrcValidator()
+    {
+        // Pending objects are dropped
+        _nextIdx = _objects.GetCount();
+        for (std::thread& worker : _workers)
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+
+    const std::vector<CADCrcMismatch>& CADObjectCrcValidator::GetMismatches()
+    {
+        if (!_workers.empty())
+        {
+            for (std::thread& worker : _workers)
+                worker.join();
+
+            _workers.clear();
+            std::sort(_mismatches.begin(), _mismatches.end(),
+                      [](const CADCrcMismatch& first, const CADCrcMismatch& second)
+                      { return first.range.offset < second.range.offset; });
+        }
+
+        if (_error)
+            std::rethrow_exception(_error);
+
+        return _mismatches;
+    }
+
+
+    void CADObjectCrcValidator::Run()
+    {
+        std::vector<CADCrcMismatch> mismatches;
+        ByteArray scratch;
+
+        // The first failed read stops every worker, GetMismatches() throws it
+        std::exception_ptr error;
+        try
+        {
+            while (true)
+            {
+                size_t firstIdx = _nextIdx.fetch_add(VALIDATION_BATCH_SIZE);
+                if (firstIdx >= _objects.GetCount())
+                    break;
+
+                size_t lastIdx = std::min(firstIdx + VALIDATION_BATCH_SIZE, _objects.GetCount());
+                for (size_t objectIdx = firstIdx; objectIdx < lastIdx; ++objectIdx)
+                {
+                    // The CRC covers the MS size and the data, it is seeded like sections
+                    size_t objectOffset = _objects.GetOffset(objectIdx);
+                    if (!_objects.IsReadable(objectIdx))
+                    {
+                        mismatches.push_back(CADCrcMismatch { { objectOffset, 0 }, 0, 0 });
+                        continue;
+                    }
+
+                    size_t checkedSize = _objects.GetDataOffset(objectIdx) + _objects.GetSize(objectIdx) - objectOffset;
+                    const uint8_t* bytes = _fileIO.ViewAt(objectOffset, checkedSize + 2);
+                    if (bytes == nullptr)
+                    {
+                        if (_fileIO.ReadAt(objectOffset, scratch, checkedSize + 2) != checkedSize + 2)
+                        {
+                            mismatches.push_back(CADCrcMismatch { { objectOffset, 0 }, 0, 0 });
+                            continue;
+                        }
+                        bytes = scratch.data();
+                    }
+
+                    uint16_t storedCrc = ReadLittleEndian16(bytes + checkedSize);
+                    uint16_t computedCrc = CalculateCADCrc(bytes, checkedSize, CAD_CRC_SECTION_SEED);
+                    if (storedCrc != computedCrc)
+                        mismatches.push_back(CADCrcMismatch { { objectOffset, checkedSize }, storedCrc, computedCrc });
+                }
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            _nextIdx = _objects.GetCount();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _mismatches.insert(_mismatches.end(), mismatches.begin(), mismatches.end());
+        if (error && !_error)
+            _error = error;
+    }
+}
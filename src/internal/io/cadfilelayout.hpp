@@ -0,0 +1,159 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADFILELAYOUT_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADFILELAYOUT_HPP
+
+#include "cadfileio.hpp"
+#include "cadobjectdirectory.hpp"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace libopencad
+{
+
+    // Numbers of the section locator records in the R2000 file header
+    enum class CADSectionNumber : uint8_t
+    {
+        HEADER              = 0,
+        CLASSES             = 1,
+        OBJECT_MAP          = 2,
+        OBJECT_FREE_SPACE   = 3,
+        TEMPLATE            = 4,
+        AUX_HEADER          = 5
+    };
+
+
+    struct CADSectionLocator
+    {
+        uint8_t number;
+        size_t  offset;
+        size_t  size;
+    };
+
+
+    // A stored CRC which does not match the checked bytes
+    struct CADCrcMismatch
+    {
+        CADByteRange    range;
+        uint16_t        stored;
+        uint16_t        computed;
+    };
+
+
+    /*
+     * File structure of a R2000 (AC1015) drawing: the section locators from the file
+     * header and the object map, completed with the size and type of every object into
+     * a directory. CRC mismatches of the file header and of the object
+     * map sections are collected, not thrown.
+     */
+    struct CADFileLayout
+    {
+        std::string                     version;
+        std::vector<CADSectionLocator>  sections;
+        CADObjectDirectory              objects;
+        std::vector<CADCrcMismatch>     crcMismatches;
+
+        // nullptr if the file header has no such record
+        const CADSectionLocator* FindSection(CADSectionNumber number) const;
+    };
+
+    // Handle and file offset of an object as listed by the object map
+    struct CADObjectMapEntry
+    {
+        uint64_t    handle;
+        size_t      offset;
+    };
+
+    // Throws std::runtime_error on other versions and on unreadable structure
+    CADFileLayout ReadCADFileLayout(const ICADFileIO& fileIO);
+
+    // The file header part of the layout only: version, section locators and their CRC
+    CADFileLayout ReadCADFileHeader(const ICADFileIO& fileIO);
+
+    /*
+     * Reads the object map a section at a time. Sections come in handle order, so looking
+     * up the low handles of the table objects can stop long before the end of the map.
+     */
+    class CADObjectMapReader
+    {
+    public:
+        CADObjectMapReader(const ICADFileIO& fileIO, const CADSectionLocator& locator);
+
+        // Appends the entries of the next section, false once the map is over. Its CRC
+        // mismatch is appended to crcMismatches, a corrupted map throws std::runtime_error.
+        bool ReadSection(std::vector<CADObjectMapEntry>& entries, std::vector<CADCrcMismatch>& crcMismatches);
+
+    private:
+        const ICADFileIO&   _fileIO;
+        size_t              _offset;
+        bool                _finished;
+        ByteArray           _section;
+    };
+
+    /*
+     * Checks object CRCs on worker threads, meant to run while the caller decodes the
+     * same objects. Unreadable objects are reported as mismatches with an empty range.
+     */
+    class CADObjectCrcValidator
+    {
+    public:
+        // threadsCount 0 means one per core except the caller's. Both the file and the
+        // directory are used until GetMismatches() returns.
+        CADObjectCrcValidator(const ICADFileIO& fileIO, const CADObjectDirectory& objects, size_t threadsCount = 0);
+        ~CADObjectCrcValidator();
+
+        // Waits for the workers, mismatches come sorted by object offset. Objects read
+        // short are reported as unreadable, a read that threw is rethrown here.
+        const std::vector<CADCrcMismatch>& GetMismatches();
+
+    private:
+        CADObjectCrcValidator(const CADObjectCrcValidator&) = delete;
+        CADObjectCrcValidator& operator=(const CADObjectCrcValidator&) = delete;
+
+        void Run();
+
+    private:
+        const ICADFileIO&               _fileIO;
+        const CADObjectDirectory&       _objects;
+
+        std::atomic<size_t>             _nextIdx;
+        std::mutex                      _mutex;
+        std::vector<CADCrcMismatch>     _mismatches;
+        std::exception_ptr              _error;     // first failed read of the workers
+
+        std::vector<std::thread>        _workers;
+    };
+
+}
+
+#endif
@@ -0,0 +1,331 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadfilemetadata.hpp"
+#include "cadbitstreamreader.hpp"
+#include "cadcrc.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const size_t CODEPAGE_OFFSET = 0x13;
+
+        // Header variables and classes sections: sentinel, RL size, data, RS CRC, sentinel
+        const size_t SECTION_SENTINEL_SIZE = 16;
+        const size_t SECTION_FRAME_SIZE = 2 * SECTION_SENTINEL_SIZE + 4 + 2;
+
+
+        uint16_t ReadLittleEndian16(const uint8_t* data)
+        { return static_cast<uint16_t>(data[0] | (data[1] << 8)); }
+
+
+        uint32_t ReadLittleEndian32(const uint8_t* data)
+        { return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24); }
+
+
+        void SeekFieldRun(CADStickyBitStreamReader& reader, CADFieldKind kind, size_t count)
+        {
+            for (size_t idx = 0; idx < count; ++idx)
+                reader.SeekFields(&kind, 1);
+        }
+
+
+        // Data of a header variables or classes section, the CRC covers the size and the data
+        ByteArray ReadSectionData(const ICADFileIO& fileIO, const CADSectionLocator& locator,
+                                  std::vector<CADCrcMismatch>& crcMismatches)
+        {
+            ByteArray section;
+            if (locator.size < SECTION_FRAME_SIZE || locator.offset + locator.size > fileIO.GetSize() ||
+                fileIO.ReadAt(locator.offset, section, locator.size) != locator.size)
+                throw std::runtime_error("ReadCADFileMetadata: section is truncated");
+
+            size_t dataSize = ReadLittleEndian32(section.data() + SECTION_SENTINEL_SIZE);
+            if (dataSize > locator.size - SECTION_FRAME_SIZE)
+                throw std::runtime_error("ReadCADFileMetadata: section is corrupted");
+
+            const uint8_t* sizeAndData = section.data() + SECTION_SENTINEL_SIZE;
+            uint16_t storedCrc = ReadLittleEndian16(sizeAndData + 4 + dataSize);
+            uint16_t computedCrc = CalculateCADCrc(sizeAndData, dataSize + 4, CAD_CRC_SECTION_SEED);
+            if (storedCrc != computedCrc)
+                crcMismatches.push_back(CADCrcMismatch { { locator.offset + SECTION_SENTINEL_SIZE, dataSize + 4 },
+                                                         storedCrc, computedCrc });
+
+            return ByteArray(sizeAndData + 4, sizeAndData + 4 + dataSize);
+        }
+
+
+        // R2000 header variables in file order, the ones of no interest are stepped over
+        void ReadHeaderVariables(CADStickyBitStreamReader& reader, CADHeaderVariables& header)
+        {
+            // Unknown values, current viewport, DIMASO to PELLIPSE flags, PROXYGRAPHICS, TREEDEPTH
+            reader.SeekFields({ CADFieldKind::BITDOUBLE, CADFieldKind::BITDOUBLE, CADFieldKind::BITDOUBLE,
+                                CADFieldKind::BITDOUBLE, CADFieldKind::TEXT, CADFieldKind::TEXT, CADFieldKind::TEXT,
+                                CADFieldKind::TEXT, CADFieldKind::BITLONG, CADFieldKind::BITLONG,
+                                CADFieldKind::HANDLE });
+            reader.SeekBits(20);
+            reader.SeekFields({ CADFieldKind::BITSHORT, CADFieldKind::BITSHORT });
+
+            header.linearUnits = reader.ReadBitShort();
+            header.linearPrecision = reader.ReadBitShort();
+            header.angularUnits = reader.ReadBitShort();
+            header.angularPrecision = reader.ReadBitShort();
+
+            // ATTMODE to TEXTQLTY, LTSCALE to CELTSCALE, MENUNAME, dates, CECOLOR
+            SeekFieldRun(reader, CADFieldKind::BITSHORT, 21);
+            SeekFieldRun(reader, CADFieldKind::BITDOUBLE, 21);
+            reader.SeekTv();
+            SeekFieldRun(reader, CADFieldKind::BITLONG, 8);
+            reader.SeekBitShort();
+
+            header.handleSeed = reader.ReadHandleReference().value;
+            header.currentLayer = reader.ReadHandleReference().value;
+
+            // TEXTSTYLE, CELTYPE, DIMSTYLE, CMLSTYLE, PSVPSCALE
+            SeekFieldRun(reader, CADFieldKind::HANDLE, 4);
+            reader.SeekBitDouble();
+
+            // Paper space, then model space: INSBASE, EXTMIN, EXTMAX, then limits, elevation, UCS
+            CADPoint3D* spaces[2][3] = {
+                { &header.paperInsertionBase, &header.paperExtentsMin, &header.paperExtentsMax },
+                { &header.insertionBase, &header.extentsMin, &header.extentsMax } };
+            for (CADPoint3D** points : spaces)
+            {
+                for (size_t pointIdx = 0; pointIdx < 3; ++pointIdx)
+                    reader.ReadBitDoubles(&points[pointIdx]->x, 3);
+
+                reader.SeekFields({ CADFieldKind::RAWVECTOR, CADFieldKind::RAWVECTOR, CADFieldKind::BITDOUBLE,
+                                    CADFieldKind::VECTOR, CADFieldKind::VECTOR, CADFieldKind::VECTOR,
+                                    CADFieldKind::HANDLE, CADFieldKind::HANDLE, CADFieldKind::BITSHORT,
+                                    CADFieldKind::HANDLE });
+                SeekFieldRun(reader, CADFieldKind::VECTOR, 6);
+            }
+
+            // Dimension variables, DIMPOST to DIMLWE
+            reader.SeekFields({ CADFieldKind::TEXT, CADFieldKind::TEXT });
+            SeekFieldRun(reader, CADFieldKind::BITDOUBLE, 9);
+            reader.SeekBits(6);
+            SeekFieldRun(reader, CADFieldKind::BITSHORT, 3);
+            SeekFieldRun(reader, CADFieldKind::BITDOUBLE, 9);
+            reader.SeekFields({ CADFieldKind::BIT, CADFieldKind::BITSHORT });
+            reader.SeekBits(4);
+            SeekFieldRun(reader, CADFieldKind::BITSHORT, 14);
+            reader.SeekBits(2);
+            SeekFieldRun(reader, CADFieldKind::BITSHORT, 4);
+            reader.SeekFields({ CADFieldKind::BIT, CADFieldKind::BITSHORT });
+            SeekFieldRun(reader, CADFieldKind::HANDLE, 5);
+            reader.SeekFields({ CADFieldKind::BITSHORT, CADFieldKind::BITSHORT });
+
+            // Table control objects, from the block one
+            reader.SeekHandle();
+            header.layerControl = reader.ReadHandleReference().value;
+
+            // Other control objects, dictionaries, TSTACKALIGN to PLOTSTYLES, CELWEIGHT flags
+            SeekFieldRun(reader, CADFieldKind::HANDLE, 11);
+            reader.SeekFields({ CADFieldKind::BITSHORT, CADFieldKind::BITSHORT, CADFieldKind::TEXT,
+                                CADFieldKind::TEXT, CADFieldKind::HANDLE, CADFieldKind::HANDLE,
+                                CADFieldKind::HANDLE, CADFieldKind::BITLONG });
+
+            header.insertionUnits = reader.ReadBitShort();
+        }
+
+
+        void ReadClasses(const ByteArray& data, std::vector<CADClassDefinition>& classes)
+        {
+            // The data ends with the padding of the last byte
+            CADStickyBitStreamReader reader(data.data(), data.size());
+            while (reader.GetOffset() + 8 <= data.size() * 8)
+            {
+                CADClassDefinition definition;
+                definition.number = reader.ReadBitShort();
+                definition.proxyFlags = reader.ReadBitShort();
+                definition.applicationName = reader.ReadTv();
+                definition.cppClassName = reader.ReadTv();
+                definition.dxfName = reader.ReadTv();
+                definition.wasZombie = reader.ReadBit();
+                definition.itemClassId = reader.ReadBitShort();
+                if (reader.GetError() != CADReadError::NONE)
+                    break;
+
+                TrimCADStringTerminator(definition.applicationName);
+                TrimCADStringTerminator(definition.cppClassName);
+                TrimCADStringTerminator(definition.dxfName);
+                classes.push_back(definition);
+            }
+        }
+
+
+        // Object data past the MS size, without the CRC. False if it does not fit into the file.
+        bool ReadObjectData(const ICADFileIO& fileIO, size_t objectOffset, ByteArray& data)
+        {
+            uint8_t sizeBytes[4];
+            size_t readCount = fileIO.ReadAt(objectOffset, sizeBytes, sizeof(sizeBytes));
+            if (readCount < 2)
+                return false;
+
+            size_t size = ReadLittleEndian16(sizeBytes);
+            size_t dataOffset = 2;
+            if (size & 0x8000)
+            {
+                uint16_t highWord = readCount == 4 ? ReadLittleEndian16(sizeBytes + 2) : 0x8000;
+                if (highWord & 0x8000)
+                    return false;
+
+                size = (size & 0x7FFF) | (static_cast<size_t>(highWord) << 15);
+                dataOffset = 4;
+            }
+
+            if (objectOffset + dataOffset + size + 2 > fileIO.GetSize())
+                return false;
+
+            return fileIO.ReadAt(objectOffset + dataOffset, data, size) == size;
+        }
+
+
+        // Looks the handle up, reading map sections up to the first listing a higher handle
+        bool FindObject(CADObjectMapReader& mapReader, std::vector<CADObjectMapEntry>& entries, uint64_t handle,
+                        std::vector<CADCrcMismatch>& crcMismatches, size_t& objectOffset)
+        {
+            while ((entries.empty() || entries.back().handle < handle) &&
+                   mapReader.ReadSection(entries, crcMismatches))
+            { }
+
+            auto entry = std::lower_bound(entries.begin(), entries.end(), handle,
+                [](const CADObjectMapEntry& left, uint64_t right) { return left.handle < right; });
+
+            // Maps out of handle order are not expected, they are searched through
+            if (entry == entries.end() || entry->handle != handle)
+            {
+                while (mapReader.ReadSection(entries, crcMismatches))
+                { }
+
+                entry = std::find_if(entries.begin(), entries.end(),
+                    [handle](const CADObjectMapEntry& candidate) { return candidate.handle == handle; });
+                if (entry == entries.end())
+                    return false;
+            }
+
+            objectOffset = entry->offset;
+            return true;
+        }
+
+
+        // Layer handles owned by the layer control object, empty if it is damaged
+        std::vector<uint64_t> ReadLayerHandles(const ByteArray& data)
+        {
+            std::vector<uint64_t> handles;
+
+            CADStickyBitStreamReader reader(data.data(), data.size());
+            if (reader.ReadBitShort() != CADObject::LAYER_CONTROL_OBJ)
+                return handles;
+
+            CADObjectHeader header;
+            ReadCADObjectHeader(reader, header);
+            int32_t reactorsCount = reader.ReadBitLong();
+            int32_t entriesCount = reader.ReadBitLong();
+
+            // Handle stream: parent, reactors, extension dictionary, then the entries. Every
+            // handle takes at least a byte, which bounds the counts.
+            reader.SetOffset(header.bitSize);
+            size_t handlesLeft = reader.GetError() == CADReadError::NONE ? (data.size() * 8 - header.bitSize) / 8 : 0;
+            if (reactorsCount < 0 || entriesCount < 0 ||
+                static_cast<size_t>(reactorsCount) + static_cast<size_t>(entriesCount) + 2 > handlesLeft)
+                return handles;
+
+            SeekFieldRun(reader, CADFieldKind::HANDLE, static_cast<size_t>(reactorsCount) + 2);
+            for (int32_t entryIdx = 0; entryIdx < entriesCount; ++entryIdx)
+                handles.push_back(reader.ReadHandleReference().Resolve(header.handle));
+
+            if (reader.GetError() != CADReadError::NONE)
+                handles.clear();
+
+            return handles;
+        }
+
+    }
+
+
+    CADFileMetadata ReadCADFileMetadata(const ICADFileIO& fileIO)
+    {
+        CADFileLayout layout = ReadCADFileHeader(fileIO);
+
+        CADFileMetadata metadata;
+        metadata.version = layout.version;
+        metadata.crcMismatches = layout.crcMismatches;
+
+        uint8_t codepage[2];
+        if (fileIO.ReadAt(CODEPAGE_OFFSET, codepage, 2) == 2)
+            metadata.codepage = static_cast<int16_t>(ReadLittleEndian16(codepage));
+
+        const CADSectionLocator* headerSection = layout.FindSection(CADSectionNumber::HEADER);
+        const CADSectionLocator* classesSection = layout.FindSection(CADSectionNumber::CLASSES);
+        const CADSectionLocator* objectMap = layout.FindSection(CADSectionNumber::OBJECT_MAP);
+        if (headerSection == nullptr || classesSection == nullptr || objectMap == nullptr)
+            throw std::runtime_error("ReadCADFileMetadata: a section is missing");
+
+        ByteArray data = ReadSectionData(fileIO, *headerSection, metadata.crcMismatches);
+        CADStickyBitStreamReader headerReader(data.data(), data.size());
+        ReadHeaderVariables(headerReader, metadata.header);
+        if (headerReader.GetError() != CADReadError::NONE)
+            throw std::runtime_error("ReadCADFileMetadata: header variables are corrupted");
+
+        ReadClasses(ReadSectionData(fileIO, *classesSection, metadata.crcMismatches), metadata.classes);
+
+        // Only the layer table objects are looked up, the map is read as far as they are
+        CADObjectMapReader mapReader(fileIO, *objectMap);
+        std::vector<CADObjectMapEntry> entries;
+        auto readObject = [&](uint64_t handle, ByteArray& objectData)
+        {
+            size_t objectOffset;
+            return FindObject(mapReader, entries, handle, metadata.crcMismatches, objectOffset) &&
+                   ReadObjectData(fileIO, objectOffset, objectData);
+        };
+
+        if (!readObject(metadata.header.layerControl, data))
+            return metadata;
+
+        for (uint64_t handle : ReadLayerHandles(data))
+        {
+            CADLayerData layer;
+            if (!readObject(handle, data))
+                continue;
+
+            CADStickyBitStreamReader reader(data.data(), data.size());
+            if (ReadCADLayerObject(reader, layer))
+                metadata.layers.push_back(layer);
+        }
+
+        return metadata;
+    }
+
+}
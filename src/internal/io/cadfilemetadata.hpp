@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADFILEMETADATA_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADFILEMETADATA_HPP
+
+#include "cadfilelayout.hpp"
+#include "../objects/cadtableschemas.hpp"
+
+#include <string>
+#include <vector>
+
+namespace libopencad
+{
+
+    // Entry of the CLASSES section, numbers from 500 on are the custom object types
+    struct CADClassDefinition
+    {
+        int16_t     number = 0;
+        int16_t     proxyFlags = 0;
+        std::string applicationName;
+        std::string cppClassName;
+        std::string dxfName;
+        bool        wasZombie = false;
+        int16_t     itemClassId = 0;        // 0x1F2 for entities, 0x1F3 for objects
+    };
+
+
+    // Header variables needed to catalogue a drawing, the rest of the section is skipped
+    struct CADHeaderVariables
+    {
+        int16_t     linearUnits = 0;        // LUNITS
+        int16_t     linearPrecision = 0;    // LUPREC
+        int16_t     angularUnits = 0;       // AUNITS
+        int16_t     angularPrecision = 0;   // AUPREC
+        int16_t     insertionUnits = 0;     // INSUNITS
+        uint64_t    handleSeed = 0;         // HANDSEED, the next free handle
+        uint64_t    currentLayer = 0;       // CLAYER
+        uint64_t    layerControl = 0;       // LAYER CONTROL OBJECT
+        CADPoint3D  paperInsertionBase;     // INSBASE, EXTMIN and EXTMAX of paper space
+        CADPoint3D  paperExtentsMin;
+        CADPoint3D  paperExtentsMax;
+        CADPoint3D  insertionBase;          // the same for model space
+        CADPoint3D  extentsMin;
+        CADPoint3D  extentsMax;
+    };
+
+
+    /*
+     * What a catalogue needs from a R2000 drawing. Reading it touches the file header,
+     * the header variables and classes sections, the object map and the layer table
+     * objects, but no entity.
+     */
+    struct CADFileMetadata
+    {
+        std::string                     version;
+        int16_t                         codepage = 0;
+        CADHeaderVariables              header;
+        std::vector<CADClassDefinition> classes;
+        std::vector<CADLayerData>       layers;         // in the layer control object order
+        std::vector<CADCrcMismatch>     crcMismatches;
+    };
+
+
+    // Throws std::runtime_error on other versions and on unreadable structure, damaged
+    // layers are left out
+    CADFileMetadata ReadCADFileMetadata(const ICADFileIO& fileIO);
+
+}
+
+#endif
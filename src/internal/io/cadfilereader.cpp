@@ -0,0 +1,134 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadfilereader.hpp"
+#include "cadsidecarindex.hpp"
+#include "mappedcadfileio.hpp"
+
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    CADFileReader::CADFileReader(const std::shared_ptr<ICADFileIO>& fileIO, const CADOpenOptions& options)
+        : _fileIO(fileIO),
+          _indexLoaded(false)
+    { Open(std::string(), options); }
+
+
+    CADFileReader::CADFileReader(const std::string& path, const CADOpenOptions& options)
+        : _fileIO(std::make_shared<MappedCADFileIO>(path)),
+          _indexLoaded(false)
+    {
+        if (!_fileIO->IsOpened())
+            throw std::runtime_error("CADFileReader: can not open " + path);
+
+        Open(path, options);
+    }
+
+
+    void CADFileReader::Open(const std::string& path, const CADOpenOptions& options)
+    {
+        CADFileStamp stamp;
+        std::string indexPath = options.sidecarIndexPath.empty() ? path + ".idx" : options.sidecarIndexPath;
+        bool useIndex = options.useSidecarIndex && !path.empty() && GetCADFileStamp(path, *_fileIO, stamp);
+
+        if (useIndex && LoadCADSidecarIndex(indexPath, stamp, _layout, _layers))
+        {
+            _indexLoaded = true;
+        }
+        else
+        {
+            ReadContents();
+
+            // A failed write only costs the next open a rebuild
+            if (useIndex)
+                WriteCADSidecarIndex(indexPath, stamp, _layout, _layers);
+        }
+
+        if (options.validateObjectCrcs)
+            _validator.reset(new CADObjectCrcValidator(*_fileIO, _layout.objects, options.threadsCount));
+    }
+
+
+    void CADFileReader::ReadContents()
+    {
+        _layout = ReadCADFileLayout(*_fileIO);
+        _layout.objects.BuildTypeLists();
+        ReadLayers();
+    }
+
+
+    void CADFileReader::ReadLayers()
+    {
+        const CADObjectDirectory& objects = _layout.objects;
+        const uint32_t* end = objects.GetTypeEnd(CADObject::LAYER);
+        for (const uint32_t* objectIdx = objects.GetTypeBegin(CADObject::LAYER); objectIdx != end; ++objectIdx)
+        {
+            // A damaged layer is left out rather than failing the open
+            CADStickyBitStreamReader reader = ReadObject(*objectIdx).SubReader<CADStickyErrorBounds>(
+                0, objects.GetSize(*objectIdx));
+
+            CADLayerData layer;
+            if (ReadCADLayerObject(reader, layer))
+                _layers.push_back(layer);
+        }
+    }
+
+
+    CADBitStreamReader CADFileReader::ReadObject(size_t objectIdx) const
+    {
+        if (objectIdx >= _layout.objects.GetCount() || !_layout.objects.IsReadable(objectIdx))
+            throw std::runtime_error("CADFileReader: object is out of file range");
+
+        CADByteRange data = { _layout.objects.GetDataOffset(objectIdx), _layout.objects.GetSize(objectIdx) };
+
+        // Memory backed files are read in place, valid as long as this reader keeps the file
+        const uint8_t* bytes = _fileIO->ViewAt(data.offset, data.size);
+        if (bytes != nullptr)
+            return CADBitStreamReader(bytes, data.size);
+
+        ByteArray buffer;
+        _fileIO->ReadAt(data.offset, buffer, data.size);
+        return CADBitStreamReader(std::move(buffer));
+    }
+
+
+    std::vector<CADCrcMismatch> CADFileReader::GetCrcMismatches()
+    {
+        std::vector<CADCrcMismatch> mismatches = _layout.crcMismatches;
+        if (_validator)
+        {
+            const std::vector<CADCrcMismatch>& objectMismatches = _validator->GetMismatches();
+            mismatches.insert(mismatches.end(), objectMismatches.begin(), objectMismatches.end());
+        }
+
+        return mismatches;
+    }
+
+}
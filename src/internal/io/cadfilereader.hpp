@@ -0,0 +1,125 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADFILEREADER_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADFILEREADER_HPP
+
+#include "cadbitstreamreader.hpp"
+#include "cadfilelayout.hpp"
+#include "../objects/cadtableschemas.hpp"
+
+#include <memory>
+#include <string>
+
+namespace libopencad
+{
+
+    struct CADOpenOptions
+    {
+        CADOpenOptions()
+            : validateObjectCrcs(false),
+              threadsCount(0),
+              useSidecarIndex(false),
+              geometryCacheSize(0)
+        { }
+
+        // Check every object's CRC on worker threads while objects are being decoded
+        bool    validateObjectCrcs;
+
+        // Worker threads, 0 means one per core except the caller's
+        size_t  threadsCount;
+
+        // Drawings opened by path only: reuse the index next to the drawing while it
+        // matches the drawing, (re)write it otherwise. The index lives at the drawing
+        // path + ".idx" unless sidecarIndexPath is set.
+        bool        useSidecarIndex;
+        std::string sidecarIndexPath;
+
+        // CADFile only: bytes of decoded geometries kept for later accesses, 0 keeps none
+        size_t      geometryCacheSize;
+    };
+
+
+    /*
+     * Opened R2000 drawing: reads the file layout and the layer table up front and hands
+     * out bit streams of single objects. Throws std::runtime_error if the layout can not
+     * be read, CRC mismatches are only reported.
+     */
+    class CADFileReader
+    {
+    public:
+        explicit CADFileReader(const std::shared_ptr<ICADFileIO>& fileIO,
+                               const CADOpenOptions& options = CADOpenOptions());
+
+        // Maps the drawing at path
+        explicit CADFileReader(const std::string& path, const CADOpenOptions& options = CADOpenOptions());
+
+        const ICADFileIO& GetFileIO() const
+        { return *_fileIO; }
+
+        const CADFileLayout& GetLayout() const
+        { return _layout; }
+
+        size_t GetObjectsCount() const
+        { return _layout.objects.GetCount(); }
+
+        // Sorted by handle
+        const std::vector<CADLayerData>& GetLayers() const
+        { return _layers; }
+
+        // True if the layout and the layers came from the sidecar index
+        bool IsIndexLoaded() const
+        { return _indexLoaded; }
+
+        // Bit stream over the object's data (past the MS size, without the CRC)
+        CADBitStreamReader ReadObject(size_t objectIdx) const;
+
+        // File header and object map mismatches, plus the object ones when validation was
+        // requested: waits for the validating threads then.
+        std::vector<CADCrcMismatch> GetCrcMismatches();
+
+    private:
+        // Validating threads keep references to the layout, the reader stays in place
+        CADFileReader(const CADFileReader&) = delete;
+        CADFileReader& operator=(const CADFileReader&) = delete;
+
+        void Open(const std::string& path, const CADOpenOptions& options);
+        void ReadContents();
+        void ReadLayers();
+
+    private:
+        std::shared_ptr<ICADFileIO>             _fileIO;
+        CADFileLayout                           _layout;
+        std::vector<CADLayerData>               _layers;
+        bool                                    _indexLoaded;
+        std::unique_ptr<CADObjectCrcValidator>  _validator;
+    };
+
+}
+
+#endif
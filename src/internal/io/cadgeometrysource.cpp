@@ -0,0 +1,129 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadgeometrysource.hpp"
+#include "cadentitydecoder.hpp"
+
+namespace libopencad
+{
+
+    CADGeometrySource::CADGeometrySource(const std::string& path, const CADOpenOptions& options)
+        : _reader(path, options),
+          _capacity(options.geometryCacheSize),
+          _statistics()
+    { }
+
+
+    CADGeometrySource::CADGeometrySource(const std::shared_ptr<ICADFileIO>& fileIO, const CADOpenOptions& options)
+        : _reader(fileIO, options),
+          _capacity(options.geometryCacheSize),
+          _statistics()
+    { }
+
+
+    CADGeometryPtr CADGeometrySource::GetGeometry(size_t objectIdx)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            auto found = _index.find(objectIdx);
+            if (found != _index.end())
+            {
+                ++_statistics.hits;
+                _entries.splice(_entries.begin(), _entries, found->second);
+                return found->second->geometry;
+            }
+
+            ++_statistics.misses;
+        }
+
+        // Decode outside of the lock, other entities are decoded in parallel meanwhile
+        ByteArray scratch;
+        CADGeometryPtr geometry = DecodeCADGeometry(_reader, objectIdx, scratch);
+        if (!geometry || _capacity == 0)
+            return geometry;
+
+        size_t size = geometry->GetMemoryUsage();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Another thread may have decoded the same entity meanwhile
+        auto found = _index.find(objectIdx);
+        if (found != _index.end())
+            return found->second->geometry;
+
+        if (size > _capacity)
+            return geometry;
+
+        EvictUntilFits(size);
+
+        Entry entry = { objectIdx, geometry, size };
+        _entries.push_front(entry);
+        _index[objectIdx] = _entries.begin();
+        _statistics.bytesUsed += size;
+        ++_statistics.geometriesCount;
+
+        return geometry;
+    }
+
+
+    std::vector<CADGeometryPtr> CADGeometrySource::GetGeometries(const std::vector<uint32_t>& objects,
+                                                                 size_t threadsCount)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _statistics.misses += objects.size();
+        }
+
+        return DecodeCADGeometries(_reader, objects.data(), objects.size(), threadsCount);
+    }
+
+
+    CADGeometryCacheStatistics CADGeometrySource::GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+
+    void CADGeometrySource::EvictUntilFits(size_t bytesCount)
+    {
+        while (!_entries.empty() && _statistics.bytesUsed + bytesCount > _capacity)
+        {
+            const Entry& victim = _entries.back();
+
+            _statistics.bytesUsed -= victim.size;
+            --_statistics.geometriesCount;
+            ++_statistics.evictions;
+
+            _index.erase(victim.objectIdx);
+            _entries.pop_back();
+        }
+    }
+
+}
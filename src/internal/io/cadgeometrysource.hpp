@@ -0,0 +1,102 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADGEOMETRYSOURCE_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADGEOMETRYSOURCE_HPP
+
+#include "cadfilereader.hpp"
+#include "libopencad/cadgeometry.hpp"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace libopencad
+{
+
+    struct CADGeometryCacheStatistics
+    {
+        uint64_t    hits;
+        uint64_t    misses;         // every decoded geometry, also without a cache
+        uint64_t    evictions;
+        size_t      bytesUsed;
+        size_t      geometriesCount;
+    };
+
+
+    /*
+     * Decodes entities of an opened drawing into geometries on demand, keeping the most
+     * recently used ones within a byte budget. Shared by a CADFile and its layers.
+     * Thread-safe.
+     */
+    class CADGeometrySource
+    {
+    public:
+        CADGeometrySource(const std::string& path, const CADOpenOptions& options);
+        CADGeometrySource(const std::shared_ptr<ICADFileIO>& fileIO, const CADOpenOptions& options);
+
+        const CADFileReader& GetReader() const
+        { return _reader; }
+
+        // nullptr if the entity is damaged
+        CADGeometryPtr GetGeometry(size_t objectIdx);
+
+        // Decodes the entities on threadsCount threads (0 means one per core) without going
+        // through the cache, geometries come in the order of objects
+        std::vector<CADGeometryPtr> GetGeometries(const std::vector<uint32_t>& objects, size_t threadsCount = 0);
+
+        CADGeometryCacheStatistics GetStatistics() const;
+
+    private:
+        CADGeometrySource(const CADGeometrySource&) = delete;
+        CADGeometrySource& operator=(const CADGeometrySource&) = delete;
+
+        struct Entry
+        {
+            size_t          objectIdx;
+            CADGeometryPtr  geometry;
+            size_t          size;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        void EvictUntilFits(size_t bytesCount);
+
+    private:
+        CADFileReader               _reader;
+        const size_t                _capacity;
+
+        mutable std::mutex          _mutex;
+        EntryList                   _entries; // most recently used first
+        std::unordered_map<size_t, EntryList::iterator> _index;
+        CADGeometryCacheStatistics  _statistics;
+    };
+
+}
+
+#endif
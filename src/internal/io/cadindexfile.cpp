@@ -0,0 +1,81 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadindexfile.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libopencad
+{
+
+    uint64_t AppendCADIndexArray(ByteArray& buffer, const void* values, size_t bytesCount)
+    {
+        buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7));
+        uint64_t position = buffer.size();
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(values);
+        buffer.insert(buffer.end(), bytes, bytes + bytesCount);
+
+        return position;
+    }
+
+
+    bool IsCADIndexArrayValid(uint64_t indexSize, uint64_t offset, uint64_t count, size_t elementSize)
+    { return offset % 8 == 0 && offset <= indexSize && count <= (indexSize - offset) / elementSize; }
+
+
+    bool WriteCADIndexFile(const std::string& path, const ByteArray& buffer)
+    {
+        std::string temporaryPath = path + ".XXXXXX";
+        int fd = mkstemp(&temporaryPath[0]);
+        if (fd < 0)
+            return false;
+
+        // mkstemp creates the file for its owner only
+        bool written = fchmod(fd, 0644) == 0;
+        for (size_t offset = 0; written && offset < buffer.size();)
+        {
+            ssize_t count = write(fd, buffer.data() + offset, buffer.size() - offset);
+            written = count > 0;
+            offset += written ? static_cast<size_t>(count) : 0;
+        }
+
+        if (close(fd) != 0 || !written || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADINDEXFILE_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADINDEXFILE_HPP
+
+#include "cadfileio.hpp"
+
+#include <string>
+
+namespace libopencad
+{
+
+    /*
+     * Building blocks of the index files kept next to a drawing (sidecar and spatial
+     * index): a header followed by arrays at 8-byte aligned offsets, so that a mapped
+     * index can be read in place.
+     */
+
+    // Appends bytesCount bytes at an 8-byte aligned position of buffer, returns that position
+    uint64_t AppendCADIndexArray(ByteArray& buffer, const void* values, size_t bytesCount);
+
+    // True if count elements of elementSize at offset are aligned and fit into indexSize bytes
+    bool IsCADIndexArrayValid(uint64_t indexSize, uint64_t offset, uint64_t count, size_t elementSize);
+
+    /*
+     * Writes buffer to a uniquely named temporary file next to path and renames it over
+     * path, so that readers never see a partial file and concurrent writers do not mix
+     * theirs. False on I/O errors, the temporary file is removed then.
+     */
+    bool WriteCADIndexFile(const std::string& path, const ByteArray& buffer);
+
+}
+
+#endif
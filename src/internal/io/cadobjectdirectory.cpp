@@ -0,0 +1,299 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadobjectdirectory.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const uint16_t PROXY_ENTITY_TYPE = 498;
+        const uint16_t PROXY_OBJECT_TYPE = 499;
+        const uint16_t FIRST_CLASS_TYPE = 500;
+
+
+        template<typename T>
+        void Permute(std::vector<T>& values, const std::vector<uint32_t>& order)
+        {
+            std::vector<T> permuted;
+            permuted.reserve(values.size());
+            for (uint32_t idx : order)
+                permuted.push_back(values[idx]);
+
+            values.swap(permuted);
+        }
+
+
+        template<typename T>
+        void ShrinkToFit(std::vector<T>& values)
+        { std::vector<T>(values.begin(), values.end()).swap(values); }
+
+    }
+
+
+    const size_t CADObjectDirectory::NPOS;
+    const uint8_t CADObjectDirectory::PROXY_ENTITY_TYPE_CODE;
+    const uint8_t CADObjectDirectory::PROXY_OBJECT_TYPE_CODE;
+    const uint8_t CADObjectDirectory::CLASS_TYPE_CODE;
+    const uint8_t CADObjectDirectory::OTHER_CLASS_TYPE_CODE;
+    const uint8_t CADObjectDirectory::UNREADABLE_TYPE_CODE;
+    const size_t CADObjectDirectory::TYPE_CODES_COUNT;
+
+
+    CADObjectDirectory::CADObjectDirectory()
+        : _sorted(true),
+          _count(0),
+          _handles(nullptr),
+          _offsets(nullptr),
+          _sizes(nullptr),
+          _typeCodes(nullptr),
+          _typeStarts(nullptr),
+          _typeEntries(nullptr)
+    { }
+
+
+    CADObjectDirectory::CADObjectDirectory(const CADObjectDirectory& other)
+        : CADObjectDirectory()
+    { *this = other; }
+
+
+    CADObjectDirectory& CADObjectDirectory::operator=(const CADObjectDirectory& other)
+    {
+        if (this == &other)
+            return *this;
+
+        _ownedHandles = other._ownedHandles;
+        _ownedOffsets = other._ownedOffsets;
+        _ownedSizes = other._ownedSizes;
+        _ownedTypeCodes = other._ownedTypeCodes;
+        _ownedTypeStarts = other._ownedTypeStarts;
+        _ownedTypeEntries = other._ownedTypeEntries;
+        _sorted = other._sorted;
+        _storage = other._storage;
+
+        if (_storage)
+        {
+            _count = other._count;
+            _handles = other._handles;
+            _offsets = other._offsets;
+            _sizes = other._sizes;
+            _typeCodes = other._typeCodes;
+            _typeStarts = other._typeStarts;
+            _typeEntries = other._typeEntries;
+        }
+        else
+        {
+            UpdateViews();
+        }
+
+        return *this;
+    }
+
+
+    CADObjectDirectory CADObjectDirectory::View(size_t count, const uint64_t* handles, const uint32_t* offsets,
+                                                const uint32_t* sizes, const uint8_t* typeCodes,
+                                                const uint32_t* typeStarts, const uint32_t* typeEntries,
+                                                const std::shared_ptr<const void>& storage)
+    {
+        CADObjectDirectory directory;
+        directory._storage = storage;
+        directory._count = count;
+        directory._handles = handles;
+        directory._offsets = offsets;
+        directory._sizes = sizes;
+        directory._typeCodes = typeCodes;
+        if (typeStarts != nullptr && typeEntries != nullptr)
+        {
+            directory._typeStarts = typeStarts;
+            directory._typeEntries = typeEntries;
+        }
+
+        return directory;
+    }
+
+
+    void CADObjectDirectory::Reserve(size_t count)
+    {
+        _ownedHandles.reserve(count);
+        _ownedOffsets.reserve(count);
+        _ownedSizes.reserve(count);
+        _ownedTypeCodes.reserve(count);
+        UpdateViews();
+    }
+
+
+    void CADObjectDirectory::Add(uint64_t handle, size_t offset, size_t size, uint16_t type)
+    {
+        if (_storage)
+            throw std::runtime_error("CADObjectDirectory: views are read-only");
+
+        // R2000 file offsets are 32 bit, so are MS sizes
+        if (offset > std::numeric_limits<uint32_t>::max() || size > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("CADObjectDirectory: object is out of 32-bit range");
+
+        // Unknown types between the fixed and the class defined ones are still readable
+        uint8_t typeCode = UNREADABLE_TYPE_CODE;
+        if (type != 0 && type < PROXY_ENTITY_TYPE_CODE)
+            typeCode = static_cast<uint8_t>(type);
+        else if (type == PROXY_ENTITY_TYPE)
+            typeCode = PROXY_ENTITY_TYPE_CODE;
+        else if (type == PROXY_OBJECT_TYPE)
+            typeCode = PROXY_OBJECT_TYPE_CODE;
+        else if (type >= FIRST_CLASS_TYPE)
+            typeCode = static_cast<uint8_t>(std::min<size_t>(CLASS_TYPE_CODE + type - FIRST_CLASS_TYPE,
+                                                             OTHER_CLASS_TYPE_CODE));
+        else if (type != 0)
+            typeCode = OTHER_CLASS_TYPE_CODE;
+
+        if (!_ownedHandles.empty() && handle <= _ownedHandles.back())
+            _sorted = false;
+
+        _ownedHandles.push_back(handle);
+        _ownedOffsets.push_back(static_cast<uint32_t>(offset));
+        _ownedSizes.push_back(typeCode == UNREADABLE_TYPE_CODE ? 0 : static_cast<uint32_t>(size));
+        _ownedTypeCodes.push_back(typeCode);
+
+        // Type lists are out of date
+        _ownedTypeStarts.clear();
+        _ownedTypeEntries.clear();
+        UpdateViews();
+    }
+
+
+    void CADObjectDirectory::Sort()
+    {
+        // Object maps come sorted already
+        if (_sorted || _storage)
+            return;
+
+        std::vector<uint32_t> order(_ownedHandles.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [this](uint32_t first, uint32_t second) { return _ownedHandles[first] < _ownedHandles[second]; });
+
+        Permute(_ownedHandles, order);
+        Permute(_ownedOffsets, order);
+        Permute(_ownedSizes, order);
+        Permute(_ownedTypeCodes, order);
+        _ownedTypeStarts.clear();
+        _ownedTypeEntries.clear();
+        _sorted = true;
+        UpdateViews();
+    }
+
+
+    void CADObjectDirectory::Compact()
+    {
+        ShrinkToFit(_ownedHandles);
+        ShrinkToFit(_ownedOffsets);
+        ShrinkToFit(_ownedSizes);
+        ShrinkToFit(_ownedTypeCodes);
+        ShrinkToFit(_ownedTypeStarts);
+        ShrinkToFit(_ownedTypeEntries);
+        UpdateViews();
+    }
+
+
+    void CADObjectDirectory::BuildTypeLists()
+    {
+        if (_storage || !_ownedTypeStarts.empty())
+            return;
+
+        // Counting sort of the indices by type code
+        _ownedTypeStarts.assign(TYPE_CODES_COUNT + 1, 0);
+        for (size_t idx = 0; idx < _count; ++idx)
+            ++_ownedTypeStarts[_typeCodes[idx] + 1];
+
+        for (size_t typeCode = 0; typeCode < TYPE_CODES_COUNT; ++typeCode)
+            _ownedTypeStarts[typeCode + 1] += _ownedTypeStarts[typeCode];
+
+        std::vector<uint32_t> positions(_ownedTypeStarts.begin(), _ownedTypeStarts.end() - 1);
+        _ownedTypeEntries.resize(_count);
+        for (size_t idx = 0; idx < _count; ++idx)
+            _ownedTypeEntries[positions[_typeCodes[idx]]++] = static_cast<uint32_t>(idx);
+
+        UpdateViews();
+    }
+
+
+    uint16_t CADObjectDirectory::GetType(size_t idx) const
+    {
+        uint8_t typeCode = _typeCodes[idx];
+        if (typeCode >= OTHER_CLASS_TYPE_CODE)
+            return 0;
+
+        if (typeCode >= CLASS_TYPE_CODE)
+            return static_cast<uint16_t>(FIRST_CLASS_TYPE + typeCode - CLASS_TYPE_CODE);
+
+        if (typeCode == PROXY_ENTITY_TYPE_CODE)
+            return PROXY_ENTITY_TYPE;
+
+        if (typeCode == PROXY_OBJECT_TYPE_CODE)
+            return PROXY_OBJECT_TYPE;
+
+        return typeCode;
+    }
+
+
+    size_t CADObjectDirectory::Find(uint64_t handle) const
+    {
+        const uint64_t* found = std::lower_bound(_handles, _handles + _count, handle);
+        if (found == _handles + _count || *found != handle)
+            return NPOS;
+
+        return static_cast<size_t>(found - _handles);
+    }
+
+
+    size_t CADObjectDirectory::GetMemoryUsage() const
+    {
+        return _ownedHandles.capacity() * sizeof(uint64_t) + _ownedOffsets.capacity() * sizeof(uint32_t) +
+               _ownedSizes.capacity() * sizeof(uint32_t) + _ownedTypeCodes.capacity() * sizeof(uint8_t) +
+               (_ownedTypeStarts.capacity() + _ownedTypeEntries.capacity()) * sizeof(uint32_t);
+    }
+
+
+    void CADObjectDirectory::UpdateViews()
+    {
+        _count = _ownedHandles.size();
+        _handles = _ownedHandles.data();
+        _offsets = _ownedOffsets.data();
+        _sizes = _ownedSizes.data();
+        _typeCodes = _ownedTypeCodes.data();
+        _typeStarts = _ownedTypeStarts.empty() ? nullptr : _ownedTypeStarts.data();
+        _typeEntries = _ownedTypeStarts.empty() ? nullptr : _ownedTypeEntries.data();
+    }
+
+}
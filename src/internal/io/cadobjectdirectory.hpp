@@ -0,0 +1,181 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADOBJECTDIRECTORY_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADOBJECTDIRECTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace libopencad
+{
+
+    /*
+     * Every object of a file as parallel arrays sorted by handle: handle, file offset
+     * (of the MS size), data size and a type code, 17 bytes per object. Replaces
+     * per-object headers held through shared pointers in a node based map.
+     *
+     * Type codes below PROXY_ENTITY_TYPE_CODE are the fixed DWG types (CADObject::Type),
+     * the two codes below CLASS_TYPE_CODE stand for the proxy types 498 and 499. Codes
+     * from CLASS_TYPE_CODE on are class defined types (500 + code - CLASS_TYPE_CODE), up
+     * to OTHER_CLASS_TYPE_CODE standing for all the later ones and any other unknown
+     * type. Objects whose header can not be read have UNREADABLE_TYPE_CODE and a zero size.
+     *
+     * Per-type lists of object indices are built on request. A directory either owns
+     * its arrays or is a read-only view of arrays kept alive by someone else (a mapped
+     * sidecar index).
+     */
+    class CADObjectDirectory
+    {
+    public:
+        static const size_t     NPOS = static_cast<size_t>(-1);
+
+        static const uint8_t    PROXY_ENTITY_TYPE_CODE = 0x7E;
+        static const uint8_t    PROXY_OBJECT_TYPE_CODE = 0x7F;
+        static const uint8_t    CLASS_TYPE_CODE = 0x80;
+        static const uint8_t    OTHER_CLASS_TYPE_CODE = 0xFE;
+        static const uint8_t    UNREADABLE_TYPE_CODE = 0xFF;
+        static const size_t     TYPE_CODES_COUNT = 256;
+
+        CADObjectDirectory();
+        CADObjectDirectory(const CADObjectDirectory& other);
+        CADObjectDirectory& operator=(const CADObjectDirectory& other);
+
+        // Vectors keep their buffers when moved, so do the views
+        CADObjectDirectory(CADObjectDirectory&& other) = default;
+        CADObjectDirectory& operator=(CADObjectDirectory&& other) = default;
+
+        // typeStarts holds TYPE_CODES_COUNT + 1 positions into typeEntries, both may be nullptr
+        static CADObjectDirectory View(size_t count, const uint64_t* handles, const uint32_t* offsets,
+                                       const uint32_t* sizes, const uint8_t* typeCodes, const uint32_t* typeStarts,
+                                       const uint32_t* typeEntries, const std::shared_ptr<const void>& storage);
+
+        void Reserve(size_t count);
+
+        // Objects may come in any order, Sort() has to be called once all are added. Type 0
+        // (CADObject::UNUSED) marks an object whose header could not be read.
+        void Add(uint64_t handle, size_t offset, size_t size, uint16_t type);
+        void Sort();
+
+        // Releases spare capacity
+        void Compact();
+
+        // Groups object indices by type code, in handle order within a type
+        void BuildTypeLists();
+
+        bool HasTypeLists() const
+        { return _typeStarts != nullptr; }
+
+        // Indices of the objects of a type code as [begin, end), needs BuildTypeLists()
+        const uint32_t* GetTypeBegin(uint8_t typeCode) const
+        { return _typeEntries + _typeStarts[typeCode]; }
+
+        const uint32_t* GetTypeEnd(uint8_t typeCode) const
+        { return _typeEntries + _typeStarts[typeCode + 1]; }
+
+        bool IsView() const
+        { return _storage != nullptr; }
+
+        size_t GetCount() const
+        { return _count; }
+
+        uint64_t GetHandle(size_t idx) const
+        { return _handles[idx]; }
+
+        size_t GetOffset(size_t idx) const
+        { return _offsets[idx]; }
+
+        size_t GetSize(size_t idx) const
+        { return _sizes[idx]; }
+
+        uint8_t GetTypeCode(size_t idx) const
+        { return _typeCodes[idx]; }
+
+        // DWG object type, 0 for unreadable objects and OTHER_CLASS_TYPE_CODE ones
+        uint16_t GetType(size_t idx) const;
+
+        bool IsReadable(size_t idx) const
+        { return _typeCodes[idx] != UNREADABLE_TYPE_CODE; }
+
+        // Offset of the object's data: past the MS size, which is always written in the shortest form
+        size_t GetDataOffset(size_t idx) const
+        { return _offsets[idx] + (_sizes[idx] < 0x8000 ? 2 : 4); }
+
+        // Binary search, NPOS if there is no such handle
+        size_t Find(uint64_t handle) const;
+
+        // Heap bytes held by the owned arrays (capacity, not just the used part), 0 for views
+        size_t GetMemoryUsage() const;
+
+        // Raw arrays, for serialization
+        const uint64_t* GetHandles() const
+        { return _handles; }
+
+        const uint32_t* GetOffsets() const
+        { return _offsets; }
+
+        const uint32_t* GetSizes() const
+        { return _sizes; }
+
+        const uint8_t* GetTypeCodes() const
+        { return _typeCodes; }
+
+        const uint32_t* GetTypeStarts() const
+        { return _typeStarts; }
+
+        const uint32_t* GetTypeEntries() const
+        { return _typeEntries; }
+
+    private:
+        // Points the views at the owned vectors
+        void UpdateViews();
+
+    private:
+        std::vector<uint64_t>   _ownedHandles;
+        std::vector<uint32_t>   _ownedOffsets;
+        std::vector<uint32_t>   _ownedSizes;
+        std::vector<uint8_t>    _ownedTypeCodes;
+        std::vector<uint32_t>   _ownedTypeStarts;
+        std::vector<uint32_t>   _ownedTypeEntries;
+        bool                    _sorted;
+
+        std::shared_ptr<const void> _storage;
+        size_t                  _count;
+        const uint64_t*         _handles;
+        const uint32_t*         _offsets;
+        const uint32_t*         _sizes;
+        const uint8_t*          _typeCodes;
+        const uint32_t*         _typeStarts;
+        const uint32_t*         _typeEntries;
+    };
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadprefetcher.hpp"
+
+#include <algorithm>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        bool CompareByOffset(const CADByteRange& first, const CADByteRange& second)
+        { return first.offset < second.offset; }
+
+    }
+
+
+    CADPrefetcher::CADPrefetcher(const ICADFileIO& fileIO, const std::vector<CADByteRange>& ranges,
+                                 size_t buffersCount)
+        : _fileIO(fileIO),
+          _ranges(ranges),
+          _buffers(std::max<size_t>(buffersCount, 2)),
+          _loadedCount(0),
+          _consumedCount(0),
+          _stopped(false)
+    {
+        std::stable_sort(_ranges.begin(), _ranges.end(), CompareByOffset);
+        _worker = std::thread(&CADPrefetcher::Run, this);
+    }
+
+
+    CADPrefetcher::~CADPrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped = true;
+        }
+
+        _releasedCondition.notify_all();
+        _worker.join();
+    }
+
+
+    bool CADPrefetcher::Next(CADByteRange& range, const ByteArray*& data)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_consumedCount == _ranges.size())
+            return false;
+
+        _loadedCondition.wait(lock, [this]() { return _loadedCount > _consumedCount || _error; });
+        if (_loadedCount == _consumedCount)
+            std::rethrow_exception(_error);
+
+        range = _ranges[_consumedCount];
+        data = &_buffers[_consumedCount % _buffers.size()];
+        ++_consumedCount;
+
+        // The slot returned by the previous call is free from now on
+        lock.unlock();
+        _releasedCondition.notify_one();
+
+        return true;
+    }
+
+
+    void CADPrefetcher::Run()
+    {
+        for (size_t rangeIdx = 0; rangeIdx < _ranges.size(); ++rangeIdx)
+        {
+            {
+                // The consumer holds the most recently returned slot until its next call
+                std::unique_lock<std::mutex> lock(_mutex);
+                _releasedCondition.wait(lock, [this, rangeIdx]()
+                {
+                    return _stopped || rangeIdx < _consumedCount + _buffers.size() - 1;
+                });
+
+                if (_stopped)
+                    return;
+            }
+
+            // The worker stops at the first failed read, the consumer gets the error in its place
+            std::exception_ptr error;
+            try
+            {
+                const CADByteRange& range = _ranges[rangeIdx];
+                _fileIO.ReadAt(range.offset, _buffers[rangeIdx % _buffers.size()], range.size);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (error)
+                    _error = error;
+                else
+                    ++_loadedCount;
+            }
+            _loadedCondition.notify_one();
+
+            if (error)
+                return;
+        }
+    }
+
+}
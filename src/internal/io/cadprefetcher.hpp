@@ -0,0 +1,86 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADPREFETCHER_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADPREFETCHER_HPP
+
+#include "cadfileio.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace libopencad
+{
+
+    /*
+     * Read-ahead stage: a background thread fetches the given byte ranges in file
+     * offset order into a bounded ring of reusable buffers, so that decoding of one
+     * range overlaps reading of the next ones. Uses ICADFileIO::ReadAt only, the
+     * file's cursor is left alone.
+     */
+    class CADPrefetcher
+    {
+    public:
+        CADPrefetcher(const ICADFileIO& fileIO, const std::vector<CADByteRange>& ranges,
+                      size_t buffersCount = 8);
+        ~CADPrefetcher();
+
+        /*
+         * Waits for the next range (in offset order) and returns it with its bytes. The
+         * bytes stay valid until the following call. Returns false once all ranges
+         * were handed out. A short read (range past the end of file) yields fewer bytes.
+         * A failed read is rethrown here once the ranges fetched before it were handed out.
+         */
+        bool Next(CADByteRange& range, const ByteArray*& data);
+
+    private:
+        CADPrefetcher(const CADPrefetcher&) = delete;
+        CADPrefetcher& operator=(const CADPrefetcher&) = delete;
+
+        void Run();
+
+    private:
+        const ICADFileIO&           _fileIO;
+        std::vector<CADByteRange>   _ranges;
+        std::vector<ByteArray>      _buffers;
+
+        std::mutex                  _mutex;
+        std::condition_variable     _loadedCondition;
+        std::condition_variable     _releasedCondition;
+        size_t                      _loadedCount;   // ranges fetched by the worker
+        size_t                      _consumedCount; // ranges handed out by Next
+        std::exception_ptr          _error;         // of the range after the loaded ones
+        bool                        _stopped;
+
+        std::thread                 _worker;
+    };
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadrangeplanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        bool CompareByOffset(const CADByteRange& first, const CADByteRange& second)
+        { return first.offset < second.offset; }
+
+    }
+
+
+    CADRangePlanner::CADRangePlanner(size_t maxGap, size_t maxReadSize)
+        : _maxGap(maxGap),
+          _maxReadSize(maxReadSize)
+    { }
+
+
+    std::vector<CADByteRange> CADRangePlanner::Plan(const std::vector<CADByteRange>& ranges) const
+    {
+        std::vector<CADByteRange> sorted;
+        sorted.reserve(ranges.size());
+
+        for (size_t idx = 0; idx < ranges.size(); ++idx)
+            if (ranges[idx].size > 0)
+                sorted.push_back(ranges[idx]);
+
+        std::sort(sorted.begin(), sorted.end(), CompareByOffset);
+
+        std::vector<CADByteRange> result;
+
+        for (size_t idx = 0; idx < sorted.size(); ++idx)
+        {
+            const CADByteRange& range = sorted[idx];
+            size_t rangeEnd = range.offset + range.size;
+
+            if (!result.empty())
+            {
+                CADByteRange& current = result.back();
+                size_t currentEnd = current.offset + current.size;
+                size_t mergedEnd = std::max(currentEnd, rangeEnd);
+
+                if (range.offset <= currentEnd + _maxGap &&
+                    (_maxReadSize == 0 || mergedEnd - current.offset <= _maxReadSize))
+                {
+                    current.size = mergedEnd - current.offset;
+                    continue;
+                }
+
+                // Overlapping ranges which can not be joined: start after the current read
+                if (range.offset < currentEnd)
+                {
+                    if (rangeEnd <= currentEnd)
+                        continue;
+
+                    CADByteRange tail = { currentEnd, rangeEnd - currentEnd };
+                    result.push_back(tail);
+                    continue;
+                }
+            }
+
+            result.push_back(range);
+        }
+
+        return result;
+    }
+
+
+    CoalescingCADFileIO::CoalescingCADFileIO(const std::shared_ptr<ICADFileIO>& fileIO,
+                                             const std::vector<CADByteRange>& ranges,
+                                             const CADRangePlanner& planner)
+        : _fileIO(fileIO),
+          _plannedReads(planner.Plan(ranges)),
+          _fetchedReads(_plannedReads.size()),
+          _fetchedFlags(_plannedReads.size()),
+          _position(0)
+    { }
+
+
+    size_t CoalescingCADFileIO::FindPlannedRead(size_t offset) const
+    {
+        // first planned read ending after offset
+        size_t low = 0;
+        size_t high = _plannedReads.size();
+
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (_plannedReads[middle].offset + _plannedReads[middle].size <= offset)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        return low;
+    }
+
+
+    const ByteArray& CoalescingCADFileIO::FetchPlannedRead(size_t readIdx) const
+    {
+        std::call_once(_fetchedFlags[readIdx], [this, readIdx]()
+        {
+            const CADByteRange& range = _plannedReads[readIdx];
+            _fileIO->ReadAt(range.offset, _fetchedReads[readIdx], range.size);
+        });
+
+        return _fetchedReads[readIdx];
+    }
+
+
+    size_t CoalescingCADFileIO::ReadInto(void* buffer, size_t bytesCount)
+    { return ReadIntoAt(_position, buffer, bytesCount); }
+
+
+    const uint8_t* CoalescingCADFileIO::ReadView(size_t bytesCount)
+    { return ViewAtCursor(_position, bytesCount); }
+
+
+    size_t CoalescingCADFileIO::Write(const ByteArray&)
+    { return 0; }
+
+
+    size_t CoalescingCADFileIO::Seek(int64_t offset, SeekOrigin origin)
+    { return SeekCursor(_position, offset, origin); }
+
+
+    size_t CoalescingCADFileIO::ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        uint8_t* output = static_cast<uint8_t*>(buffer);
+        size_t readCount = 0;
+        size_t readIdx = FindPlannedRead(offset);
+
+        while (readCount < bytesCount)
+        {
+            size_t position = offset + readCount;
+            size_t remaining = bytesCount - readCount;
+
+            if (readIdx < _plannedReads.size() && _plannedReads[readIdx].offset <= position)
+            {
+                const ByteArray& fetched = FetchPlannedRead(readIdx);
+                size_t fetchedOffset = position - _plannedReads[readIdx].offset;
+                if (fetchedOffset >= fetched.size())
+                    break;
+
+                size_t copyCount = std::min(remaining, fetched.size() - fetchedOffset);
+                std::memcpy(output + readCount, fetched.data() + fetchedOffset, copyCount);
+                readCount += copyCount;
+                ++readIdx;
+                continue;
+            }
+
+            // Not planned: read directly, up to the next planned range
+            size_t directCount = remaining;
+            if (readIdx < _plannedReads.size())
+                directCount = std::min(directCount, _plannedReads[readIdx].offset - position);
+
+            size_t directRead = _fileIO->ReadAt(position, output + readCount, directCount);
+            readCount += directRead;
+            if (directRead < directCount)
+                break;
+        }
+
+        return readCount;
+    }
+
+
+    const uint8_t* CoalescingCADFileIO::ViewAt(size_t offset, size_t bytesCount) const
+    {
+        size_t readIdx = FindPlannedRead(offset);
+
+        if (readIdx < _plannedReads.size() && _plannedReads[readIdx].offset <= offset)
+        {
+            const ByteArray& fetched = FetchPlannedRead(readIdx);
+            size_t fetchedOffset = offset - _plannedReads[readIdx].offset;
+
+            if (fetchedOffset <= fetched.size() && bytesCount <= fetched.size() - fetchedOffset)
+                return fetched.data() + fetchedOffset;
+        }
+
+        return _fileIO->ViewAt(offset, bytesCount);
+    }
+
+}
@@ -0,0 +1,114 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADRANGEPLANNER_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADRANGEPLANNER_HPP
+
+#include "cadfileio.hpp"
+
+#include <memory>
+#include <mutex>
+
+namespace libopencad
+{
+
+    /*
+     * Merges the byte ranges a parser is going to read into few large reads: ranges
+     * closer than maxGap bytes are joined, as long as the joined read stays within
+     * maxReadSize (0 means unbounded).
+     */
+    class CADRangePlanner
+    {
+    public:
+        explicit CADRangePlanner(size_t maxGap, size_t maxReadSize = 0);
+
+        std::vector<CADByteRange> Plan(const std::vector<CADByteRange>& ranges) const;
+
+    private:
+        size_t  _maxGap;
+        size_t  _maxReadSize;
+    };
+
+
+    /*
+     * ICADFileIO decorator for high latency backends (range requests to an object
+     * store). Reads falling into a planned range are served from one large read of
+     * that range, fetched on first use and kept until destruction; other reads go
+     * to the wrapped file. Read-only.
+     */
+    class CoalescingCADFileIO : public ICADFileIO
+    {
+    public:
+        CoalescingCADFileIO(const std::shared_ptr<ICADFileIO>& fileIO, const std::vector<CADByteRange>& ranges,
+                            const CADRangePlanner& planner);
+
+        const std::vector<CADByteRange>& GetPlannedReads() const
+        { return _plannedReads; }
+
+        using ICADFileIO::ReadInto;
+        virtual size_t ReadInto(void* buffer, size_t bytesCount);
+        virtual const uint8_t* ReadView(size_t bytesCount);
+        virtual size_t Write(const ByteArray& data);
+        virtual size_t Seek(int64_t offset, SeekOrigin origin);
+
+        using ICADFileIO::ReadAt;
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const;
+        virtual const uint8_t* ViewAt(size_t offset, size_t bytesCount) const;
+
+        virtual size_t Tell() const
+        { return _position; }
+
+        virtual bool Eof() const
+        { return _position >= GetSize(); }
+
+        virtual bool IsOpened() const
+        { return _fileIO->IsOpened(); }
+
+        virtual size_t GetSize() const
+        { return _fileIO->GetSize(); }
+
+    private:
+        CoalescingCADFileIO(const CoalescingCADFileIO&) = delete;
+        CoalescingCADFileIO& operator=(const CoalescingCADFileIO&) = delete;
+
+        // Index of the planned read containing offset, or of the first one after it
+        size_t FindPlannedRead(size_t offset) const;
+        const ByteArray& FetchPlannedRead(size_t readIdx) const;
+
+    private:
+        std::shared_ptr<ICADFileIO>     _fileIO;
+        std::vector<CADByteRange>       _plannedReads;
+
+        mutable std::vector<ByteArray>      _fetchedReads;
+        mutable std::vector<std::once_flag> _fetchedFlags;
+
+        size_t                          _position;
+    };
+}
+
+#endif
@@ -0,0 +1,393 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadsidecarindex.hpp"
+#include "cadindexfile.hpp"
+#include "mappedcadfileio.hpp"
+
+#include <cstring>
+
+#include <sys/stat.h>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const char      INDEX_MAGIC[8] = { 'L', 'O', 'C', 'A', 'D', 'I', 'D', 'X' };
+        const uint32_t  INDEX_FORMAT_VERSION = 2;
+        const uint32_t  BYTE_ORDER_MARK = 0x01020304;
+
+
+        struct IndexHeader
+        {
+            char        magic[8];
+            uint32_t    formatVersion;
+            uint32_t    byteOrderMark;
+
+            uint64_t    fileSize;
+            int64_t     modificationTime;
+            uint64_t    contentHash;
+            char        version[8];
+
+            uint64_t    sectionsCount;
+            uint64_t    sectionsOffset;
+            uint64_t    mismatchesCount;
+            uint64_t    mismatchesOffset;
+
+            uint64_t    objectsCount;
+            uint64_t    handlesOffset;
+            uint64_t    offsetsOffset;
+            uint64_t    sizesOffset;
+            uint64_t    typeCodesOffset;
+            uint64_t    typeStartsOffset;
+            uint64_t    typeEntriesOffset;
+
+            uint64_t    layersCount;
+            uint64_t    layersOffset;
+            uint64_t    namesOffset;
+            uint64_t    namesSize;
+
+            uint64_t    indexSize;
+        };
+
+
+        struct IndexSection
+        {
+            uint64_t    number;
+            uint64_t    offset;
+            uint64_t    size;
+        };
+
+
+        struct IndexMismatch
+        {
+            uint64_t    offset;
+            uint64_t    size;
+            uint16_t    stored;
+            uint16_t    computed;
+            uint32_t    reserved;
+        };
+
+
+        struct IndexLayer
+        {
+            uint64_t    handle;
+            int32_t     reactorsCount;
+            int16_t     xrefIndex;
+            int16_t     flags;
+            int16_t     color;
+            uint8_t     flag64;
+            uint8_t     xrefDependent;
+            uint32_t    nameOffset;
+            uint32_t    nameSize;
+            uint32_t    reserved;
+        };
+
+
+        uint64_t HashBytes(uint64_t hash, const uint8_t* data, size_t size)
+        {
+            // FNV-1a
+            for (size_t idx = 0; idx < size; ++idx)
+                hash = (hash ^ data[idx]) * 0x100000001B3ULL;
+
+            return hash;
+        }
+
+
+        bool HashRange(const ICADFileIO& fileIO, size_t offset, size_t size, uint64_t& hash)
+        {
+            const uint8_t* view = fileIO.ViewAt(offset, size);
+            if (view != nullptr)
+            {
+                hash = HashBytes(hash, view, size);
+                return true;
+            }
+
+            ByteArray buffer;
+            if (fileIO.ReadAt(offset, buffer, size) != size)
+                return false;
+
+            hash = HashBytes(hash, buffer.data(), size);
+            return true;
+        }
+
+
+        // Type lists hold every object once under its own type code, handles are strictly
+        // ascending and objects lie within the drawing, so that lookups stay in bounds
+        bool IsDirectoryValid(size_t count, const uint64_t* handles, const uint32_t* offsets, const uint32_t* sizes,
+                              const uint8_t* typeCodes, const uint32_t* typeStarts, const uint32_t* typeEntries,
+                              uint64_t fileSize)
+        {
+            for (size_t idx = 0; idx < count; ++idx)
+            {
+                if (idx > 0 && handles[idx] <= handles[idx - 1])
+                    return false;
+
+                // MS size in front of the data, CRC behind it
+                uint64_t objectSize = (sizes[idx] < 0x8000 ? 2 : 4) + static_cast<uint64_t>(sizes[idx]) + 2;
+                if (typeCodes[idx] != CADObjectDirectory::UNREADABLE_TYPE_CODE && offsets[idx] + objectSize > fileSize)
+                    return false;
+            }
+
+            std::vector<bool> listed(count, false);
+            for (size_t typeCode = 0; typeCode < CADObjectDirectory::TYPE_CODES_COUNT; ++typeCode)
+            {
+                for (uint32_t entryIdx = typeStarts[typeCode]; entryIdx < typeStarts[typeCode + 1]; ++entryIdx)
+                {
+                    uint32_t objectIdx = typeEntries[entryIdx];
+                    if (objectIdx >= count || listed[objectIdx] || typeCodes[objectIdx] != typeCode)
+                        return false;
+
+                    listed[objectIdx] = true;
+                }
+            }
+
+            return true;
+        }
+
+    }
+
+
+    bool GetCADFileStamp(const std::string& path, const ICADFileIO& fileIO, CADFileStamp& stamp)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+            return false;
+
+        // The file header with its section locators, then the object map they point to
+        uint8_t header[0x19];
+        if (fileIO.ReadAt(0, header, sizeof(header)) != sizeof(header))
+            return false;
+
+        size_t locatorsCount = header[0x15] | (header[0x16] << 8) | (header[0x17] << 16) |
+                               (static_cast<size_t>(header[0x18]) << 24);
+        if (locatorsCount > 16)
+            return false;
+
+        ByteArray locators;
+        if (fileIO.ReadAt(sizeof(header), locators, locatorsCount * 9 + 2) != locatorsCount * 9 + 2)
+            return false;
+
+        uint64_t hash = HashBytes(0xCBF29CE484222325ULL, header, sizeof(header));
+        hash = HashBytes(hash, locators.data(), locators.size());
+        for (size_t locatorIdx = 0; locatorIdx < locatorsCount; ++locatorIdx)
+        {
+            const uint8_t* record = locators.data() + locatorIdx * 9;
+            if (record[0] != static_cast<uint8_t>(CADSectionNumber::OBJECT_MAP))
+                continue;
+
+            size_t offset = record[1] | (record[2] << 8) | (record[3] << 16) | (static_cast<size_t>(record[4]) << 24);
+            size_t size = record[5] | (record[6] << 8) | (record[7] << 16) | (static_cast<size_t>(record[8]) << 24);
+            if (!HashRange(fileIO, offset, size, hash))
+                return false;
+        }
+
+        stamp.size = static_cast<uint64_t>(status.st_size);
+        stamp.modificationTime = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+        stamp.contentHash = hash;
+        return true;
+    }
+
+
+    bool WriteCADSidecarIndex(const std::string& indexPath, const CADFileStamp& stamp, const CADFileLayout& layout,
+                              const std::vector<CADLayerData>& layers)
+    {
+        const CADObjectDirectory& objects = layout.objects;
+        if (!objects.HasTypeLists())
+            return false;
+
+        IndexHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.formatVersion = INDEX_FORMAT_VERSION;
+        header.byteOrderMark = BYTE_ORDER_MARK;
+        header.fileSize = stamp.size;
+        header.modificationTime = stamp.modificationTime;
+        header.contentHash = stamp.contentHash;
+        std::memcpy(header.version, layout.version.data(), std::min(layout.version.size(), sizeof(header.version)));
+
+        ByteArray buffer(sizeof(header));
+
+        std::vector<IndexSection> sections;
+        for (const CADSectionLocator& locator : layout.sections)
+            sections.push_back(IndexSection { locator.number, locator.offset, locator.size });
+
+        header.sectionsCount = sections.size();
+        header.sectionsOffset = AppendCADIndexArray(buffer, sections.data(),
+                                                    sections.size() * sizeof(IndexSection));
+
+        std::vector<IndexMismatch> mismatches;
+        for (const CADCrcMismatch& mismatch : layout.crcMismatches)
+        {
+            mismatches.push_back(IndexMismatch { mismatch.range.offset, mismatch.range.size, mismatch.stored,
+                                                 mismatch.computed, 0 });
+        }
+
+        header.mismatchesCount = mismatches.size();
+        header.mismatchesOffset = AppendCADIndexArray(buffer, mismatches.data(),
+                                                      mismatches.size() * sizeof(IndexMismatch));
+
+        size_t count = objects.GetCount();
+        header.objectsCount = count;
+        header.handlesOffset = AppendCADIndexArray(buffer, objects.GetHandles(), count * sizeof(uint64_t));
+        header.offsetsOffset = AppendCADIndexArray(buffer, objects.GetOffsets(), count * sizeof(uint32_t));
+        header.sizesOffset = AppendCADIndexArray(buffer, objects.GetSizes(), count * sizeof(uint32_t));
+        header.typeCodesOffset = AppendCADIndexArray(buffer, objects.GetTypeCodes(), count * sizeof(uint8_t));
+        header.typeStartsOffset = AppendCADIndexArray(buffer, objects.GetTypeStarts(),
+                                                      (CADObjectDirectory::TYPE_CODES_COUNT + 1) * sizeof(uint32_t));
+        header.typeEntriesOffset = AppendCADIndexArray(buffer, objects.GetTypeEntries(), count * sizeof(uint32_t));
+
+        std::string names;
+        std::vector<IndexLayer> indexLayers;
+        for (const CADLayerData& layer : layers)
+        {
+            indexLayers.push_back(IndexLayer { layer.handle, layer.reactorsCount, layer.xrefIndex, layer.flags,
+                                               layer.color, layer.flag64, layer.xrefDependent,
+                                               static_cast<uint32_t>(names.size()),
+                                               static_cast<uint32_t>(layer.name.size()), 0 });
+            names += layer.name;
+        }
+
+        header.layersCount = indexLayers.size();
+        header.layersOffset = AppendCADIndexArray(buffer, indexLayers.data(),
+                                                  indexLayers.size() * sizeof(IndexLayer));
+        header.namesSize = names.size();
+        header.namesOffset = AppendCADIndexArray(buffer, names.data(), names.size());
+
+        header.indexSize = buffer.size();
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        return WriteCADIndexFile(indexPath, buffer);
+    }
+
+
+    bool LoadCADSidecarIndex(const std::string& indexPath, const CADFileStamp& stamp, CADFileLayout& layout,
+                             std::vector<CADLayerData>& layers)
+    {
+        std::shared_ptr<MappedCADFileIO> mapping = std::make_shared<MappedCADFileIO>(indexPath,
+                                                                                    MappedCADFileIO::AccessPattern::RANDOM);
+        if (!mapping->IsOpened() || mapping->GetSize() < sizeof(IndexHeader))
+            return false;
+
+        const uint8_t* data = mapping->GetData();
+        IndexHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        CADFileStamp indexStamp = { header.fileSize, header.modificationTime, header.contentHash };
+        if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+            header.formatVersion != INDEX_FORMAT_VERSION || header.byteOrderMark != BYTE_ORDER_MARK ||
+            header.indexSize != mapping->GetSize() || !(indexStamp == stamp))
+            return false;
+
+        // Offsets and counts first, then the contents of the arrays
+        const size_t typeStartsCount = CADObjectDirectory::TYPE_CODES_COUNT + 1;
+        size_t count = static_cast<size_t>(header.objectsCount);
+        uint64_t indexSize = header.indexSize;
+        if (!IsCADIndexArrayValid(indexSize, header.sectionsOffset, header.sectionsCount, sizeof(IndexSection)) ||
+            !IsCADIndexArrayValid(indexSize, header.mismatchesOffset, header.mismatchesCount, sizeof(IndexMismatch)) ||
+            !IsCADIndexArrayValid(indexSize, header.handlesOffset, count, sizeof(uint64_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.offsetsOffset, count, sizeof(uint32_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.sizesOffset, count, sizeof(uint32_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.typeCodesOffset, count, sizeof(uint8_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.typeStartsOffset, typeStartsCount, sizeof(uint32_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.typeEntriesOffset, count, sizeof(uint32_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.layersOffset, header.layersCount, sizeof(IndexLayer)) ||
+            !IsCADIndexArrayValid(indexSize, header.namesOffset, header.namesSize, sizeof(char)))
+            return false;
+
+        const uint32_t* typeStarts = reinterpret_cast<const uint32_t*>(data + header.typeStartsOffset);
+        for (size_t typeCode = 0; typeCode < typeStartsCount; ++typeCode)
+        {
+            uint32_t previous = typeCode == 0 ? 0 : typeStarts[typeCode - 1];
+            if (typeStarts[typeCode] < previous || typeStarts[typeCode] > count)
+                return false;
+        }
+
+        if (typeStarts[typeStartsCount - 1] != count)
+            return false;
+
+        const uint64_t* handles = reinterpret_cast<const uint64_t*>(data + header.handlesOffset);
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data + header.offsetsOffset);
+        const uint32_t* sizes = reinterpret_cast<const uint32_t*>(data + header.sizesOffset);
+        const uint8_t* typeCodes = data + header.typeCodesOffset;
+        const uint32_t* typeEntries = reinterpret_cast<const uint32_t*>(data + header.typeEntriesOffset);
+        if (!IsDirectoryValid(count, handles, offsets, sizes, typeCodes, typeStarts, typeEntries, header.fileSize))
+            return false;
+
+        const IndexLayer* indexLayers = reinterpret_cast<const IndexLayer*>(data + header.layersOffset);
+        const char* names = reinterpret_cast<const char*>(data + header.namesOffset);
+        std::vector<CADLayerData> loadedLayers;
+        for (size_t layerIdx = 0; layerIdx < header.layersCount; ++layerIdx)
+        {
+            const IndexLayer& indexLayer = indexLayers[layerIdx];
+            if (indexLayer.nameOffset > header.namesSize || indexLayer.nameSize > header.namesSize - indexLayer.nameOffset)
+                return false;
+
+            CADLayerData layer;
+            layer.handle = indexLayer.handle;
+            layer.reactorsCount = indexLayer.reactorsCount;
+            layer.name.assign(names + indexLayer.nameOffset, indexLayer.nameSize);
+            layer.flag64 = indexLayer.flag64 != 0;
+            layer.xrefIndex = indexLayer.xrefIndex;
+            layer.xrefDependent = indexLayer.xrefDependent != 0;
+            layer.flags = indexLayer.flags;
+            layer.color = indexLayer.color;
+            loadedLayers.push_back(layer);
+        }
+
+        CADFileLayout loadedLayout;
+        loadedLayout.version.assign(header.version, strnlen(header.version, sizeof(header.version)));
+
+        const IndexSection* sections = reinterpret_cast<const IndexSection*>(data + header.sectionsOffset);
+        for (size_t sectionIdx = 0; sectionIdx < header.sectionsCount; ++sectionIdx)
+        {
+            loadedLayout.sections.push_back(CADSectionLocator { static_cast<uint8_t>(sections[sectionIdx].number),
+                                                                static_cast<size_t>(sections[sectionIdx].offset),
+                                                                static_cast<size_t>(sections[sectionIdx].size) });
+        }
+
+        const IndexMismatch* mismatches = reinterpret_cast<const IndexMismatch*>(data + header.mismatchesOffset);
+        for (size_t mismatchIdx = 0; mismatchIdx < header.mismatchesCount; ++mismatchIdx)
+        {
+            const IndexMismatch& mismatch = mismatches[mismatchIdx];
+            loadedLayout.crcMismatches.push_back(CADCrcMismatch { { static_cast<size_t>(mismatch.offset),
+                                                                    static_cast<size_t>(mismatch.size) },
+                                                                  mismatch.stored, mismatch.computed });
+        }
+
+        loadedLayout.objects = CADObjectDirectory::View(count, handles, offsets, sizes, typeCodes, typeStarts,
+                                                        typeEntries, mapping);
+
+        layout = std::move(loadedLayout);
+        layers.swap(loadedLayers);
+        return true;
+    }
+
+}
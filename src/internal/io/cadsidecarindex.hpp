@@ -0,0 +1,79 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADSIDECARINDEX_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADSIDECARINDEX_HPP
+
+#include "cadfilelayout.hpp"
+#include "../objects/cadtableschemas.hpp"
+
+#include <string>
+
+namespace libopencad
+{
+
+    // Identity of a drawing file's contents, an index is only used for the same stamp
+    struct CADFileStamp
+    {
+        uint64_t    size;
+        int64_t     modificationTime;   // nanoseconds
+        uint64_t    contentHash;        // of the file header and the object map bytes
+
+        bool operator==(const CADFileStamp& other) const
+        {
+            return size == other.size && modificationTime == other.modificationTime &&
+                   contentHash == other.contentHash;
+        }
+    };
+
+    // Size and time from the file system, the hash from fileIO. False if either fails.
+    bool GetCADFileStamp(const std::string& path, const ICADFileIO& fileIO, CADFileStamp& stamp);
+
+    /*
+     * Sidecar index: the file layout (object directory with its type lists included)
+     * and the layer table of a drawing, stored in the layout they have in memory so
+     * that loading the directory is a memory mapping. Written to a uniquely named
+     * temporary file and renamed over indexPath, so readers never see a partial index
+     * and concurrent writers do not mix theirs. False on I/O errors, the directory has
+     * to have its type lists built.
+     */
+    bool WriteCADSidecarIndex(const std::string& indexPath, const CADFileStamp& stamp, const CADFileLayout& layout,
+                              const std::vector<CADLayerData>& layers);
+
+    /*
+     * Maps the index at indexPath, layout.objects becomes a view of the mapping. False
+     * (outputs untouched) if the index is missing, malformed, written on a machine of
+     * another byte order or made for another stamp. The directory arrays are checked
+     * in full: handles sorted, objects within the drawing, type lists consistent.
+     */
+    bool LoadCADSidecarIndex(const std::string& indexPath, const CADFileStamp& stamp, CADFileLayout& layout,
+                             std::vector<CADLayerData>& layers);
+
+}
+
+#endif
@@ -0,0 +1,515 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "cadspatialindex.hpp"
+#include "cadentitydecoder.hpp"
+#include "cadindexfile.hpp"
+#include "mappedcadfileio.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        const double    HALF_PI = 1.5707963267948966;
+        const double    TWO_PI = 6.2831853071795865;
+
+        const char      INDEX_MAGIC[8] = { 'L', 'O', 'C', 'A', 'D', 'R', 'T', 'R' };
+        const uint32_t  INDEX_FORMAT_VERSION = 1;
+        const uint32_t  BYTE_ORDER_MARK = 0x01020304;
+
+
+        struct IndexHeader
+        {
+            char        magic[8];
+            uint32_t    formatVersion;
+            uint32_t    byteOrderMark;
+
+            uint64_t    fileSize;
+            int64_t     modificationTime;
+            uint64_t    contentHash;
+
+            uint64_t    entriesCount;
+            uint64_t    handlesOffset;
+            uint64_t    boxesCount;
+            uint64_t    boxesOffset;
+            uint64_t    nodesCount;
+            uint64_t    nodesOffset;
+
+            uint64_t    indexSize;
+        };
+
+
+        // Arcs run counterclockwise from startAngle to endAngle
+        void ExtendArc(CADBoundingBox& box, const CADPoint3D& center, double radius, double startAngle,
+                       double endAngle)
+        {
+            double sweep = std::fmod(endAngle - startAngle, TWO_PI);
+            if (sweep <= 0.0)
+                sweep += TWO_PI;
+
+            box.Extend(center.x + radius * std::cos(startAngle), center.y + radius * std::sin(startAngle));
+            box.Extend(center.x + radius * std::cos(startAngle + sweep), center.y + radius * std::sin(startAngle + sweep));
+
+            // Extremes on the axes the arc passes through
+            static const double AXES[4][2] = { { 1.0, 0.0 }, { 0.0, 1.0 }, { -1.0, 0.0 }, { 0.0, -1.0 } };
+            for (size_t quadrant = 0; quadrant < 4; ++quadrant)
+            {
+                double delta = std::fmod(quadrant * HALF_PI - startAngle, TWO_PI);
+                if (delta < 0.0)
+                    delta += TWO_PI;
+
+                if (delta <= sweep)
+                    box.Extend(center.x + radius * AXES[quadrant][0], center.y + radius * AXES[quadrant][1]);
+            }
+        }
+
+
+        CADBoundingBox ReadLWPolylineExtent(CADStickyBitStreamReader& stream)
+        {
+            typedef CADLWPolylineSchema Schema;
+            CADLWPolylineData data;
+            Schema::Project<CADFieldSet<Schema::CONST_WIDTH, Schema::POINTS, Schema::BULGES, Schema::WIDTHS>>(
+                stream, data);
+
+            CADBoundingBox box;
+            for (const CADPoint2D& point : data.points)
+                box.Extend(point.x, point.y);
+
+            // A bulged segment stays within its chord's box grown by the sagitta, |bulge| * chord / 2.
+            // The last bulge belongs to the closing segment.
+            if (data.bulges.size() == data.points.size())
+            {
+                for (size_t idx = 0; idx < data.points.size(); ++idx)
+                {
+                    const CADPoint2D& start = data.points[idx];
+                    const CADPoint2D& end = data.points[(idx + 1) % data.points.size()];
+                    double sagitta = std::fabs(data.bulges[idx]) * std::hypot(end.x - start.x, end.y - start.y) / 2.0;
+                    if (sagitta == 0.0)
+                        continue;
+
+                    CADBoundingBox chord;
+                    chord.Extend(start.x, start.y);
+                    chord.Extend(end.x, end.y);
+                    chord.Inflate(sagitta);
+                    box.Extend(chord);
+                }
+            }
+
+            double width = data.constWidth;
+            for (const CADLWPolylineWidth& vertexWidth : data.widths)
+                width = std::max(width, std::max(vertexWidth.start, vertexWidth.end));
+
+            if (!box.IsEmpty())
+                box.Inflate(std::fabs(width) / 2.0);
+
+            return box;
+        }
+
+
+        CADBoundingBox ReadTextExtent(CADStickyBitStreamReader& stream)
+        {
+            typedef CADTextSchema Schema;
+            CADTextData data;
+            Schema::Project<CADFieldSet<Schema::INSERTION, Schema::ALIGNMENT_X, Schema::ALIGNMENT_Y, Schema::HEIGHT,
+                                        Schema::WIDTH_FACTOR, Schema::VALUE>>(stream, data);
+
+            if (data.dataFlags & 0x02)
+                data.alignment = data.insertion;
+
+            // Glyphs are taken to be no wider than high, the text reaches its length
+            // times that from either of its points whatever the alignment and rotation
+            CADBoundingBox box;
+            box.Extend(data.insertion.x, data.insertion.y);
+            box.Extend(data.alignment.x, data.alignment.y);
+            box.Inflate(std::fabs(data.height) * (data.value.size() * std::max(1.0, std::fabs(data.widthFactor)) + 1.0));
+
+            return box;
+        }
+
+
+        // Sort key of a box, ties are broken by position so the order does not depend on the sort
+        struct CADSortKey
+        {
+            double      center;
+            uint32_t    idx;
+
+            bool operator<(const CADSortKey& other) const
+            { return center < other.center || (center == other.center && idx < other.idx); }
+        };
+
+
+        // STR order of boxes: slices of sqrt(nodes) nodes by center X, each by center Y
+        std::vector<uint32_t> SortTileRecursive(const std::vector<CADBoundingBox>& boxes)
+        {
+            std::vector<CADSortKey> keys(boxes.size());
+            for (size_t idx = 0; idx < boxes.size(); ++idx)
+                keys[idx] = CADSortKey { boxes[idx].minX + boxes[idx].maxX, static_cast<uint32_t>(idx) };
+            std::sort(keys.begin(), keys.end());
+
+            size_t nodesCount = (boxes.size() + CADSpatialIndex::NODE_SIZE - 1) / CADSpatialIndex::NODE_SIZE;
+            size_t slicesCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodesCount))));
+            size_t sliceSize = std::max<size_t>(1, slicesCount) * CADSpatialIndex::NODE_SIZE;
+
+            for (size_t sliceStart = 0; sliceStart < keys.size(); sliceStart += sliceSize)
+            {
+                size_t sliceEnd = std::min(sliceStart + sliceSize, keys.size());
+                for (size_t keyIdx = sliceStart; keyIdx < sliceEnd; ++keyIdx)
+                {
+                    const CADBoundingBox& box = boxes[keys[keyIdx].idx];
+                    keys[keyIdx].center = box.minY + box.maxY;
+                }
+                std::sort(keys.begin() + sliceStart, keys.begin() + sliceEnd);
+            }
+
+            std::vector<uint32_t> order(keys.size());
+            for (size_t keyIdx = 0; keyIdx < keys.size(); ++keyIdx)
+                order[keyIdx] = keys[keyIdx].idx;
+
+            return order;
+        }
+
+
+        template<typename T>
+        std::vector<T> CopyArray(const uint8_t* data, uint64_t offset, uint64_t count)
+        {
+            const T* values = reinterpret_cast<const T*>(data + offset);
+            return std::vector<T>(values, values + count);
+        }
+
+    }
+
+
+    CADBoundingBox ReadCADEntityExtent(CADStickyBitStreamReader& stream, int16_t type)
+    {
+        CADBoundingBox box;
+        switch (type)
+        {
+            case CADObject::LINE:
+            {
+                typedef CADLineSchema Schema;
+                CADLineData data;
+                Schema::Project<CADFieldSet<Schema::START_X, Schema::END_X, Schema::START_Y, Schema::END_Y>>(
+                    stream, data);
+                box.Extend(data.start.x, data.start.y);
+                box.Extend(data.end.x, data.end.y);
+                break;
+            }
+            case CADObject::CIRCLE:
+            {
+                typedef CADCircleSchema Schema;
+                CADCircleData data;
+                Schema::Project<CADFieldSet<Schema::CENTER, Schema::RADIUS>>(stream, data);
+                box.Extend(data.center.x, data.center.y);
+                box.Inflate(std::fabs(data.radius));
+                break;
+            }
+            case CADObject::ARC:
+            {
+                typedef CADArcSchema Schema;
+                CADArcData data;
+                Schema::Project<CADFieldSet<Schema::CENTER, Schema::RADIUS, Schema::START_ANGLE,
+                                            Schema::END_ANGLE>>(stream, data);
+                ExtendArc(box, data.center, std::fabs(data.radius), data.startAngle, data.endAngle);
+                break;
+            }
+            case CADObject::LWPOLYLINE:
+                box = ReadLWPolylineExtent(stream);
+                break;
+            case CADObject::TEXT:
+                box = ReadTextExtent(stream);
+                break;
+            case CADObject::INSERT:
+            {
+                typedef CADInsertSchema Schema;
+                CADInsertData data;
+                Schema::Project<CADFieldSet<Schema::INSERTION>>(stream, data);
+                box.Extend(data.insertion.x, data.insertion.y);
+                break;
+            }
+            default:
+                break;
+        }
+
+        return box;
+    }
+
+
+    CADBoundingBox DecodeCADBoundingBox(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch)
+    {
+        size_t dataSize = 0;
+        const uint8_t* bytes = ReadCADObjectData(reader, objectIdx, scratch, dataSize);
+        if (bytes == nullptr)
+            return CADBoundingBox();
+
+        CADStickyBitStreamReader stream(bytes, dataSize);
+        int16_t type = stream.ReadBitShort();
+
+        CADObjectHeader objectHeader;
+        ReadCADObjectHeader(stream, objectHeader);
+
+        CADEntityHeader entityHeader;
+        ReadCADEntityHeader(stream, entityHeader);
+
+        if (stream.GetError() != CADReadError::NONE || entityHeader.ownerMode != 2)
+            return CADBoundingBox();
+
+        CADBoundingBox box = ReadCADEntityExtent(stream, type);
+        if (stream.GetError() != CADReadError::NONE)
+            return CADBoundingBox();
+
+        // Corrupted values (a NaN radius, an infinite point) would give boxes that can not
+        // be ordered by their centers
+        if (!std::isfinite(box.minX) || !std::isfinite(box.minY) || !std::isfinite(box.maxX) ||
+            !std::isfinite(box.maxY))
+            return CADBoundingBox();
+
+        return box;
+    }
+
+
+    CADSpatialIndex::CADSpatialIndex()
+    { }
+
+
+    CADSpatialIndex::CADSpatialIndex(std::vector<uint64_t>&& handles, std::vector<CADBoundingBox>&& boxes,
+                                     std::vector<CADSpatialNode>&& nodes)
+        : _handles(std::move(handles)),
+          _boxes(std::move(boxes)),
+          _nodes(std::move(nodes))
+    {
+        // Children come before their node, so every walk from the root ends
+        if (_boxes.size() != _handles.size() + _nodes.size() || _boxes.size() > UINT32_MAX ||
+            (_handles.empty() && !_nodes.empty()))
+            throw std::runtime_error("CADSpatialIndex: arrays do not match");
+
+        for (size_t nodeIdx = 0; nodeIdx < _nodes.size(); ++nodeIdx)
+        {
+            const CADSpatialNode& node = _nodes[nodeIdx];
+            if (node.childrenCount == 0 || node.firstChild > _handles.size() + nodeIdx ||
+                node.childrenCount > _handles.size() + nodeIdx - node.firstChild)
+                throw std::runtime_error("CADSpatialIndex: node children are out of range");
+        }
+    }
+
+
+    CADSpatialIndex CADSpatialIndex::Pack(std::vector<uint64_t>&& handles, std::vector<CADBoundingBox>&& boxes)
+    {
+        if (handles.size() != boxes.size() || boxes.size() > UINT32_MAX / 2)
+            throw std::runtime_error("CADSpatialIndex: can not pack the entries");
+
+        CADSpatialIndex index;
+
+        std::vector<uint32_t> order = SortTileRecursive(boxes);
+        index._handles.reserve(handles.size());
+        index._boxes.reserve(boxes.size() + boxes.size() / (NODE_SIZE - 1) + 1);
+        for (uint32_t entryIdx : order)
+        {
+            index._handles.push_back(handles[entryIdx]);
+            index._boxes.push_back(boxes[entryIdx]);
+        }
+
+        // Consecutive items of a level make a node, the nodes are ordered for the next level
+        size_t levelBegin = 0;
+        size_t levelEnd = index._boxes.size();
+        while (levelEnd - levelBegin > 1)
+        {
+            std::vector<CADBoundingBox> parentBoxes;
+            std::vector<CADSpatialNode> parents;
+            for (size_t firstChild = levelBegin; firstChild < levelEnd; firstChild += NODE_SIZE)
+            {
+                size_t lastChild = std::min(firstChild + NODE_SIZE, levelEnd);
+
+                CADBoundingBox box;
+                for (size_t childIdx = firstChild; childIdx < lastChild; ++childIdx)
+                    box.Extend(index._boxes[childIdx]);
+
+                parentBoxes.push_back(box);
+                parents.push_back(CADSpatialNode { static_cast<uint32_t>(firstChild),
+                                                   static_cast<uint32_t>(lastChild - firstChild) });
+            }
+
+            for (uint32_t parentIdx : SortTileRecursive(parentBoxes))
+            {
+                index._boxes.push_back(parentBoxes[parentIdx]);
+                index._nodes.push_back(parents[parentIdx]);
+            }
+
+            levelBegin = levelEnd;
+            levelEnd = index._boxes.size();
+        }
+
+        return index;
+    }
+
+
+    CADBoundingBox CADSpatialIndex::GetBounds() const
+    { return _boxes.empty() ? CADBoundingBox() : _boxes.back(); }
+
+
+    std::vector<uint64_t> CADSpatialIndex::Query(const CADBoundingBox& window) const
+    {
+        std::vector<uint64_t> handles;
+        if (_boxes.empty())
+            return handles;
+
+        std::vector<uint32_t> pending(1, static_cast<uint32_t>(_boxes.size() - 1));
+        while (!pending.empty())
+        {
+            uint32_t boxIdx = pending.back();
+            pending.pop_back();
+
+            if (!_boxes[boxIdx].Intersects(window))
+                continue;
+
+            if (boxIdx < _handles.size())
+            {
+                handles.push_back(_handles[boxIdx]);
+                continue;
+            }
+
+            const CADSpatialNode& node = _nodes[boxIdx - _handles.size()];
+            for (uint32_t childIdx = node.firstChild; childIdx < node.firstChild + node.childrenCount; ++childIdx)
+                pending.push_back(childIdx);
+        }
+
+        std::sort(handles.begin(), handles.end());
+        return handles;
+    }
+
+
+    CADSpatialIndex BuildCADSpatialIndex(const CADFileReader& reader, size_t threadsCount)
+    {
+        const CADObjectDirectory& objects = reader.GetLayout().objects;
+
+        std::vector<uint32_t> entities;
+        for (int16_t type = CADObject::TEXT; type <= CADObject::HATCH; ++type)
+        {
+            if (IsCADLayerEntityType(type))
+                entities.insert(entities.end(), objects.GetTypeBegin(static_cast<uint8_t>(type)),
+                                objects.GetTypeEnd(static_cast<uint8_t>(type)));
+        }
+        std::sort(entities.begin(), entities.end());
+
+        std::vector<CADBoundingBox> boxes(entities.size());
+        RunCADDecodeTasks(entities.size(), threadsCount, [&](size_t firstIdx, size_t lastIdx, ByteArray& scratch)
+        {
+            for (size_t idx = firstIdx; idx < lastIdx; ++idx)
+                boxes[idx] = DecodeCADBoundingBox(reader, entities[idx], scratch);
+        });
+
+        // Entities without an extent are left out, the others keep handle order
+        std::vector<uint64_t> handles;
+        size_t entriesCount = 0;
+        for (size_t idx = 0; idx < entities.size(); ++idx)
+        {
+            if (boxes[idx].IsEmpty())
+                continue;
+
+            handles.push_back(objects.GetHandle(entities[idx]));
+            boxes[entriesCount++] = boxes[idx];
+        }
+        boxes.resize(entriesCount);
+
+        return CADSpatialIndex::Pack(std::move(handles), std::move(boxes));
+    }
+
+
+    bool WriteCADSpatialIndex(const std::string& indexPath, const CADFileStamp& stamp, const CADSpatialIndex& index)
+    {
+        IndexHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.formatVersion = INDEX_FORMAT_VERSION;
+        header.byteOrderMark = BYTE_ORDER_MARK;
+        header.fileSize = stamp.size;
+        header.modificationTime = stamp.modificationTime;
+        header.contentHash = stamp.contentHash;
+
+        ByteArray buffer(sizeof(header));
+
+        const std::vector<uint64_t>& handles = index.GetHandles();
+        const std::vector<CADBoundingBox>& boxes = index.GetBoxes();
+        const std::vector<CADSpatialNode>& nodes = index.GetNodes();
+
+        header.entriesCount = handles.size();
+        header.handlesOffset = AppendCADIndexArray(buffer, handles.data(), handles.size() * sizeof(uint64_t));
+        header.boxesCount = boxes.size();
+        header.boxesOffset = AppendCADIndexArray(buffer, boxes.data(), boxes.size() * sizeof(CADBoundingBox));
+        header.nodesCount = nodes.size();
+        header.nodesOffset = AppendCADIndexArray(buffer, nodes.data(), nodes.size() * sizeof(CADSpatialNode));
+
+        header.indexSize = buffer.size();
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        return WriteCADIndexFile(indexPath, buffer);
+    }
+
+
+    bool LoadCADSpatialIndex(const std::string& indexPath, const CADFileStamp& stamp, CADSpatialIndex& index)
+    {
+        MappedCADFileIO mapping(indexPath, MappedCADFileIO::AccessPattern::SEQUENTIAL);
+        if (!mapping.IsOpened() || mapping.GetSize() < sizeof(IndexHeader))
+            return false;
+
+        const uint8_t* data = mapping.GetData();
+        IndexHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        CADFileStamp indexStamp = { header.fileSize, header.modificationTime, header.contentHash };
+        if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+            header.formatVersion != INDEX_FORMAT_VERSION || header.byteOrderMark != BYTE_ORDER_MARK ||
+            header.indexSize != mapping.GetSize() || !(indexStamp == stamp))
+            return false;
+
+        uint64_t indexSize = header.indexSize;
+        if (!IsCADIndexArrayValid(indexSize, header.handlesOffset, header.entriesCount, sizeof(uint64_t)) ||
+            !IsCADIndexArrayValid(indexSize, header.boxesOffset, header.boxesCount, sizeof(CADBoundingBox)) ||
+            !IsCADIndexArrayValid(indexSize, header.nodesOffset, header.nodesCount, sizeof(CADSpatialNode)))
+            return false;
+
+        try
+        {
+            index = CADSpatialIndex(CopyArray<uint64_t>(data, header.handlesOffset, header.entriesCount),
+                                    CopyArray<CADBoundingBox>(data, header.boxesOffset, header.boxesCount),
+                                    CopyArray<CADSpatialNode>(data, header.nodesOffset, header.nodesCount));
+        }
+        catch (const std::runtime_error&)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+}
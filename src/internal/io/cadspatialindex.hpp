@@ -0,0 +1,174 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_CADSPATIALINDEX_HPP
+#define LIBOPENCAD_INTERNAL_IO_CADSPATIALINDEX_HPP
+
+#include "cadfilereader.hpp"
+#include "cadsidecarindex.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace libopencad
+{
+
+    // Axis aligned box in the XY plane, empty until something is added to it
+    struct CADBoundingBox
+    {
+        double minX = std::numeric_limits<double>::infinity();
+        double minY = std::numeric_limits<double>::infinity();
+        double maxX = -std::numeric_limits<double>::infinity();
+        double maxY = -std::numeric_limits<double>::infinity();
+
+        bool IsEmpty() const
+        { return minX > maxX || minY > maxY; }
+
+        void Extend(double x, double y)
+        {
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+        }
+
+        void Extend(const CADBoundingBox& other)
+        {
+            minX = std::min(minX, other.minX);
+            minY = std::min(minY, other.minY);
+            maxX = std::max(maxX, other.maxX);
+            maxY = std::max(maxY, other.maxY);
+        }
+
+        // Moves every side outwards by margin
+        void Inflate(double margin)
+        {
+            minX -= margin;
+            minY -= margin;
+            maxX += margin;
+            maxY += margin;
+        }
+
+        // Boxes touching on a side intersect, an empty box intersects nothing
+        bool Intersects(const CADBoundingBox& other) const
+        { return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY; }
+    };
+
+
+    /*
+     * Extent in the XY plane of an entity of the given type, read from its type specific
+     * data (the stream stands past the common entity data). Only the fields the type needs
+     * are decoded (points, centers and radii, vertices), the rest is stepped over. Arcs and
+     * bulged polyline segments are bounded conservatively, texts by their height times
+     * their length around the insertion and alignment points, inserts by their insertion
+     * point (the block is not resolved). Coordinates are taken as world ones, the
+     * extrusion is not applied. Empty for types without an extent.
+     */
+    CADBoundingBox ReadCADEntityExtent(CADStickyBitStreamReader& stream, int16_t type);
+
+    // Extent of the model space entity at objectIdx, empty for entities of other spaces,
+    // damaged ones and ones with a side that is not finite
+    CADBoundingBox DecodeCADBoundingBox(const CADFileReader& reader, size_t objectIdx, ByteArray& scratch);
+
+
+    // Inner node of a CADSpatialIndex: its children are the boxes [firstChild, firstChild + childrenCount)
+    struct CADSpatialNode
+    {
+        uint32_t    firstChild;
+        uint32_t    childrenCount;
+    };
+
+
+    /*
+     * R-tree over entity bounding boxes, bulk loaded with STR (sort tile recursive)
+     * packing: every level is cut in vertical slices by box center X, each slice is
+     * sorted by center Y and packed NODE_SIZE items per node. Stored as flat arrays,
+     * the entries first, then the nodes level by level, the root last. Immutable, so
+     * queries may run from any number of threads.
+     */
+    class CADSpatialIndex
+    {
+    public:
+        static const size_t NODE_SIZE = 16;
+
+        CADSpatialIndex();
+
+        // Packed arrays as returned by the getters. Throws std::runtime_error if nodes do
+        // not form a tree over the entries.
+        CADSpatialIndex(std::vector<uint64_t>&& handles, std::vector<CADBoundingBox>&& boxes,
+                        std::vector<CADSpatialNode>&& nodes);
+
+        // Packs entries given in any order, handles and boxes are parallel arrays. The
+        // boxes have to be finite, NaN centers can not be sorted.
+        static CADSpatialIndex Pack(std::vector<uint64_t>&& handles, std::vector<CADBoundingBox>&& boxes);
+
+        size_t GetEntriesCount() const
+        { return _handles.size(); }
+
+        // Box of all the entries
+        CADBoundingBox GetBounds() const;
+
+        // Handles of the entries whose box intersects window, sorted. Candidates only:
+        // boxes are conservative, the geometries have to be decoded for an exact test.
+        std::vector<uint64_t> Query(const CADBoundingBox& window) const;
+
+        // Raw arrays, for serialization
+        const std::vector<uint64_t>& GetHandles() const
+        { return _handles; }
+
+        const std::vector<CADBoundingBox>& GetBoxes() const
+        { return _boxes; }
+
+        const std::vector<CADSpatialNode>& GetNodes() const
+        { return _nodes; }
+
+    private:
+        std::vector<uint64_t>           _handles;   // of the entries
+        std::vector<CADBoundingBox>     _boxes;     // entries then nodes
+        std::vector<CADSpatialNode>     _nodes;     // node idx has box GetEntriesCount() + idx
+    };
+
+
+    // Bounding boxes of the model space entities decoded on threadsCount threads (0 means
+    // one per core), then packed
+    CADSpatialIndex BuildCADSpatialIndex(const CADFileReader& reader, size_t threadsCount = 0);
+
+    /*
+     * Spatial index file next to a drawing, tied to the drawing's stamp like the sidecar
+     * index, and written the same way through WriteCADIndexFile. False on I/O errors.
+     */
+    bool WriteCADSpatialIndex(const std::string& indexPath, const CADFileStamp& stamp, const CADSpatialIndex& index);
+
+    // False (index untouched) if the file is missing, malformed or made for another stamp
+    bool LoadCADSpatialIndex(const std::string& indexPath, const CADFileStamp& stamp, CADSpatialIndex& index);
+
+}
+
+#endif
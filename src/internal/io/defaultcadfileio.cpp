@@ -0,0 +1,93 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "defaultcadfileio.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libopencad
+{
+
+    DefaultCADFileIO::DefaultCADFileIO(const std::string& path)
+        : _fd(-1),
+          _size(0),
+          _position(0)
+    {
+        _fd = open(path.c_str(), O_RDONLY);
+        if (_fd < 0)
+            return;
+
+        struct stat fileStat;
+        if (fstat(_fd, &fileStat) == 0)
+            _size = static_cast<size_t>(fileStat.st_size);
+    }
+
+
+    DefaultCADFileIO::~DefaultCADFileIO()
+    {
+        if (_fd >= 0)
+            close(_fd);
+    }
+
+
+    size_t DefaultCADFileIO::ReadInto(void* buffer, size_t bytesCount)
+    { return ReadIntoAt(_position, buffer, bytesCount); }
+
+
+    size_t DefaultCADFileIO::ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        size_t readCount = 0;
+
+        while (readCount < bytesCount)
+        {
+            ssize_t result = pread(_fd, static_cast<char*>(buffer) + readCount, bytesCount - readCount,
+                                   static_cast<off_t>(offset + readCount));
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0)
+                break;
+
+            readCount += static_cast<size_t>(result);
+        }
+
+        return readCount;
+    }
+
+
+    size_t DefaultCADFileIO::Write(const ByteArray&)
+    { return 0; }
+
+
+    size_t DefaultCADFileIO::Seek(int64_t offset, SeekOrigin origin)
+    { return SeekCursor(_position, offset, origin); }
+
+}
@@ -31,30 +31,50 @@
 
 #include "cadfileio.hpp"
 
-#include <fstream>
+#include <string>
 
 namespace libopencad
 {
 
+    /*
+     * File backend over a POSIX descriptor. The cursor is kept in the object and
+     * all reads are positional (pread), so ReadAt never races with Seek/ReadInto on
+     * the same file. The file is opened read-only, Write() writes nothing.
+     */
     class DefaultCADFileIO : public ICADFileIO
     {
     public:
         DefaultCADFileIO(const std::string& path);
+        virtual ~DefaultCADFileIO();
 
-        virtual ByteArray Read(size_t bytesCount);
+        using ICADFileIO::ReadInto;
+        virtual size_t ReadInto(void* buffer, size_t bytesCount);
         virtual size_t Write(const ByteArray& data);
         virtual size_t Seek(int64_t offset, SeekOrigin origin);
 
+        using ICADFileIO::ReadAt;
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const;
+
         virtual size_t Tell() const
-        { return _fileStream.tellg(); }
+        { return _position; }
 
         virtual bool Eof() const
-        { return _fileStream.eof(); }
+        { return _position >= _size; }
 
         virtual bool IsOpened() const
-        { return _fileStream.is_open(); }
+        { return _fd >= 0; }
+
+        virtual size_t GetSize() const
+        { return _size; }
+
+    private:
+        DefaultCADFileIO(const DefaultCADFileIO&) = delete;
+        DefaultCADFileIO& operator=(const DefaultCADFileIO&) = delete;
+
     private:
-        std::fstream        _fileStream;
+        int                 _fd;
+        size_t              _size;
+        size_t              _position;
     };
 }
 
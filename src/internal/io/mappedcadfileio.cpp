@@ -0,0 +1,180 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "mappedcadfileio.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libopencad
+{
+
+    namespace
+    {
+
+        int ToAdvice(MappedCADFileIO::AccessPattern pattern)
+        {
+            switch (pattern)
+            {
+            case MappedCADFileIO::AccessPattern::SEQUENTIAL:
+                return MADV_SEQUENTIAL;
+
+            case MappedCADFileIO::AccessPattern::RANDOM:
+                return MADV_RANDOM;
+
+            case MappedCADFileIO::AccessPattern::NORMAL:
+                break;
+            }
+
+            return MADV_NORMAL;
+        }
+
+
+        size_t PageSize()
+        {
+            static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return pageSize;
+        }
+
+    }
+
+
+    MappedCADFileIO::MappedCADFileIO(const std::string& path, AccessPattern pattern)
+        : _data(nullptr),
+          _size(0),
+          _position(0),
+          _opened(false)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0)
+        {
+            _size = static_cast<size_t>(fileStat.st_size);
+            _opened = true;
+
+            if (_size > 0)
+            {
+                void* mapping = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+                if (mapping != MAP_FAILED)
+                {
+                    _data = static_cast<const uint8_t*>(mapping);
+                    Advise(pattern);
+                }
+                else
+                {
+                    _size = 0;
+                    _opened = false;
+                }
+            }
+        }
+
+        // The mapping keeps its own reference to the file
+        close(fd);
+    }
+
+
+    MappedCADFileIO::~MappedCADFileIO()
+    {
+        if (_data)
+            munmap(const_cast<uint8_t*>(_data), _size);
+    }
+
+
+    size_t MappedCADFileIO::ReadInto(void* buffer, size_t bytesCount)
+    { return ReadIntoAt(_position, buffer, bytesCount); }
+
+
+    const uint8_t* MappedCADFileIO::ReadView(size_t bytesCount)
+    { return ViewAtCursor(_position, bytesCount); }
+
+
+    size_t MappedCADFileIO::ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        bytesCount = std::min(bytesCount, _size - std::min(offset, _size));
+
+        if (bytesCount > 0)
+            std::memcpy(buffer, _data + offset, bytesCount);
+
+        return bytesCount;
+    }
+
+
+    const uint8_t* MappedCADFileIO::ViewAt(size_t offset, size_t bytesCount) const
+    {
+        if (offset > _size || bytesCount > _size - offset || !_data)
+            return nullptr;
+
+        return _data + offset;
+    }
+
+
+    size_t MappedCADFileIO::Write(const ByteArray&)
+    { return 0; }
+
+
+    size_t MappedCADFileIO::Seek(int64_t offset, SeekOrigin origin)
+    { return SeekCursor(_position, offset, origin); }
+
+
+    void MappedCADFileIO::Advise(AccessPattern pattern)
+    { Advise(0, _size, pattern); }
+
+
+    void MappedCADFileIO::Advise(size_t offset, size_t size, AccessPattern pattern)
+    {
+        if (!_data || offset >= _size)
+            return;
+
+        // madvise wants a page aligned start address
+        size_t alignedOffset = offset - offset % PageSize();
+        size_t alignedSize = std::min(size, _size - offset) + (offset - alignedOffset);
+
+        madvise(const_cast<uint8_t*>(_data) + alignedOffset, alignedSize, ToAdvice(pattern));
+    }
+
+
+    void MappedCADFileIO::Prefetch(size_t offset, size_t size)
+    {
+        if (!_data || offset >= _size)
+            return;
+
+        size_t alignedOffset = offset - offset % PageSize();
+        size_t alignedSize = std::min(size, _size - offset) + (offset - alignedOffset);
+
+        madvise(const_cast<uint8_t*>(_data) + alignedOffset, alignedSize, MADV_WILLNEED);
+    }
+
+}
@@ -0,0 +1,103 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_MAPPEDCADFILEIO_HPP
+#define LIBOPENCAD_INTERNAL_IO_MAPPEDCADFILEIO_HPP
+
+#include "cadfileio.hpp"
+
+#include <string>
+
+namespace libopencad
+{
+
+    /*
+     * Read-only ICADFileIO over a shared memory mapping of the whole file.
+     * Opening does not touch file data, pages are faulted in on access and
+     * shared with every other process mapping the same file.
+     */
+    class MappedCADFileIO : public ICADFileIO
+    {
+    public:
+        enum class AccessPattern
+        {
+            NORMAL,
+            SEQUENTIAL, // section scans: aggressive read-ahead, early page reuse
+            RANDOM      // object map lookups: no read-ahead
+        };
+
+    public:
+        explicit MappedCADFileIO(const std::string& path, AccessPattern pattern = AccessPattern::NORMAL);
+        virtual ~MappedCADFileIO();
+
+        using ICADFileIO::ReadInto;
+        virtual size_t ReadInto(void* buffer, size_t bytesCount);
+        virtual const uint8_t* ReadView(size_t bytesCount);
+
+        using ICADFileIO::ReadAt;
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const;
+        virtual const uint8_t* ViewAt(size_t offset, size_t bytesCount) const;
+        virtual size_t Write(const ByteArray& data);
+        virtual size_t Seek(int64_t offset, SeekOrigin origin);
+
+        virtual size_t Tell() const
+        { return _position; }
+
+        virtual bool Eof() const
+        { return _position >= _size; }
+
+        virtual bool IsOpened() const
+        { return _opened; }
+
+        // Access pattern hint for the whole mapping or for [offset, offset + size)
+        void Advise(AccessPattern pattern);
+        void Advise(size_t offset, size_t size, AccessPattern pattern);
+
+        // Asks the kernel to start reading [offset, offset + size) in the background
+        void Prefetch(size_t offset, size_t size);
+
+        // Pointer to the first byte of the file, valid until the object is destroyed
+        const uint8_t* GetData() const
+        { return _data; }
+
+        virtual size_t GetSize() const
+        { return _size; }
+
+    private:
+        MappedCADFileIO(const MappedCADFileIO&) = delete;
+        MappedCADFileIO& operator=(const MappedCADFileIO&) = delete;
+
+    private:
+        const uint8_t*  _data;
+        size_t          _size;
+        size_t          _position;
+        bool            _opened;
+    };
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#include "memorycadfileio.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace libopencad
+{
+
+    MemoryCADFileIO::MemoryCADFileIO(const uint8_t* data, size_t size)
+        : _size(0),
+          _position(0)
+    { AddChunk(data, size); }
+
+
+    MemoryCADFileIO::MemoryCADFileIO(const std::vector<Chunk>& chunks)
+        : _size(0),
+          _position(0)
+    {
+        for (size_t idx = 0; idx < chunks.size(); ++idx)
+            AddChunk(chunks[idx].data, chunks[idx].size);
+    }
+
+
+    MemoryCADFileIO::MemoryCADFileIO(ByteArray&& buffer)
+        : _size(0),
+          _position(0)
+    {
+        _storage.push_back(std::move(buffer));
+        AddChunk(_storage.back().data(), _storage.back().size());
+    }
+
+
+    MemoryCADFileIO::MemoryCADFileIO(std::vector<ByteArray>&& chunks)
+        : _storage(std::move(chunks)),
+          _size(0),
+          _position(0)
+    {
+        for (size_t idx = 0; idx < _storage.size(); ++idx)
+            AddChunk(_storage[idx].data(), _storage[idx].size());
+    }
+
+
+    void MemoryCADFileIO::AddChunk(const uint8_t* data, size_t size)
+    {
+        if (size == 0)
+            return;
+
+        Chunk chunk = { data, size };
+        _chunks.push_back(chunk);
+        _chunkOffsets.push_back(_size);
+        _size += size;
+    }
+
+
+    size_t MemoryCADFileIO::FindChunk(size_t offset) const
+    {
+        // index of the last chunk starting at or before offset
+        return std::upper_bound(_chunkOffsets.begin(), _chunkOffsets.end(), offset) - _chunkOffsets.begin() - 1;
+    }
+
+
+    size_t MemoryCADFileIO::ReadInto(void* buffer, size_t bytesCount)
+    { return ReadIntoAt(_position, buffer, bytesCount); }
+
+
+    const uint8_t* MemoryCADFileIO::ReadView(size_t bytesCount)
+    { return ViewAtCursor(_position, bytesCount); }
+
+
+    size_t MemoryCADFileIO::Write(const ByteArray&)
+    { return 0; }
+
+
+    size_t MemoryCADFileIO::Seek(int64_t offset, SeekOrigin origin)
+    { return SeekCursor(_position, offset, origin); }
+
+
+    size_t MemoryCADFileIO::ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        if (offset >= _size)
+            return 0;
+
+        bytesCount = std::min(bytesCount, _size - offset);
+
+        uint8_t* output = static_cast<uint8_t*>(buffer);
+        size_t readCount = 0;
+
+        for (size_t chunkIdx = FindChunk(offset); readCount < bytesCount; ++chunkIdx)
+        {
+            const Chunk& chunk = _chunks[chunkIdx];
+            size_t chunkOffset = offset + readCount - _chunkOffsets[chunkIdx];
+            size_t copyCount = std::min(bytesCount - readCount, chunk.size - chunkOffset);
+
+            std::memcpy(output + readCount, chunk.data + chunkOffset, copyCount);
+            readCount += copyCount;
+        }
+
+        return readCount;
+    }
+
+
+    const uint8_t* MemoryCADFileIO::ViewAt(size_t offset, size_t bytesCount) const
+    {
+        if (offset >= _size || bytesCount > _size - offset)
+            return nullptr;
+
+        // Only ranges that do not cross a chunk boundary can be lent
+        size_t chunkIdx = FindChunk(offset);
+        size_t chunkOffset = offset - _chunkOffsets[chunkIdx];
+        if (bytesCount > _chunks[chunkIdx].size - chunkOffset)
+            return nullptr;
+
+        return _chunks[chunkIdx].data + chunkOffset;
+    }
+
+}
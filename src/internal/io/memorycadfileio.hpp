@@ -0,0 +1,98 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_IO_MEMORYCADFILEIO_HPP
+#define LIBOPENCAD_INTERNAL_IO_MEMORYCADFILEIO_HPP
+
+#include "cadfileio.hpp"
+
+namespace libopencad
+{
+
+    /*
+     * Read-only ICADFileIO over bytes that are already in memory, e.g. a payload
+     * received from another service. The bytes may be borrowed or owned, and may be
+     * split in several chunks which are never concatenated.
+     */
+    class MemoryCADFileIO : public ICADFileIO
+    {
+    public:
+        struct Chunk
+        {
+            const uint8_t*  data;
+            size_t          size;
+        };
+
+    public:
+        // Borrowed memory, the caller keeps it alive while the object is in use
+        MemoryCADFileIO(const uint8_t* data, size_t size);
+        explicit MemoryCADFileIO(const std::vector<Chunk>& chunks);
+
+        // Owned memory, taken over without a copy
+        explicit MemoryCADFileIO(ByteArray&& buffer);
+        explicit MemoryCADFileIO(std::vector<ByteArray>&& chunks);
+
+        using ICADFileIO::ReadInto;
+        virtual size_t ReadInto(void* buffer, size_t bytesCount);
+        virtual const uint8_t* ReadView(size_t bytesCount);
+        virtual size_t Write(const ByteArray& data);
+        virtual size_t Seek(int64_t offset, SeekOrigin origin);
+
+        using ICADFileIO::ReadAt;
+        virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const;
+        virtual const uint8_t* ViewAt(size_t offset, size_t bytesCount) const;
+
+        virtual size_t Tell() const
+        { return _position; }
+
+        virtual bool Eof() const
+        { return _position >= _size; }
+
+        virtual bool IsOpened() const
+        { return true; }
+
+        virtual size_t GetSize() const
+        { return _size; }
+
+    private:
+        MemoryCADFileIO(const MemoryCADFileIO&) = delete;
+        MemoryCADFileIO& operator=(const MemoryCADFileIO&) = delete;
+
+        void AddChunk(const uint8_t* data, size_t size);
+        size_t FindChunk(size_t offset) const;
+
+    private:
+        std::vector<ByteArray>  _storage;
+        std::vector<Chunk>      _chunks;
+        std::vector<size_t>     _chunkOffsets;
+        size_t                  _size;
+        size_t                  _position;
+    };
+}
+
+#endif
@@ -0,0 +1,372 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_OBJECTS_CADENTITYSCHEMAS_HPP
+#define LIBOPENCAD_INTERNAL_OBJECTS_CADENTITYSCHEMAS_HPP
+
+#include "cadobjectschema.hpp"
+#include "../cadobjects.hpp"
+
+/*
+ * R2000 schemas of the entity specific data, the part of an entity following the
+ * common entity data. Handle references are stored after it and are not covered.
+ * Every schema enumerates its leaf fields in declaration order, those are the
+ * indices to build projections from.
+ */
+
+namespace libopencad
+{
+
+    struct CADLineData
+    {
+        bool        zIsZero = true;
+        CADPoint3D  start;
+        CADPoint3D  end;
+        double      thickness = 0.0;
+        CADPoint3D  extrusion;
+    };
+
+
+    struct CADCircleData
+    {
+        CADPoint3D  center;
+        double      radius = 0.0;
+        double      thickness = 0.0;
+        CADPoint3D  extrusion;
+    };
+
+
+    struct CADArcData
+    {
+        CADPoint3D  center;
+        double      radius = 0.0;
+        double      thickness = 0.0;
+        CADPoint3D  extrusion;
+        double      startAngle = 0.0;
+        double      endAngle = 0.0;
+    };
+
+
+    struct CADLWPolylineWidth
+    {
+        double start = 0.0;
+        double end = 0.0;
+    };
+
+
+    struct CADLWPolylineData
+    {
+        int16_t     flags = 0;
+        double      constWidth = 0.0;
+        double      elevation = 0.0;
+        double      thickness = 0.0;
+        CADPoint3D  normal;
+        int32_t     pointsCount = 0;
+        int32_t     bulgesCount = 0;
+        int32_t     widthsCount = 0;
+
+        std::vector<CADPoint2D>         points;
+        std::vector<double>             bulges;
+        std::vector<CADLWPolylineWidth> widths;
+    };
+
+
+    struct CADTextData
+    {
+        uint8_t     dataFlags = 0;
+        double      elevation = 0.0;
+        CADPoint2D  insertion;
+        CADPoint2D  alignment;
+        CADPoint3D  extrusion;
+        double      thickness = 0.0;
+        double      obliqueAngle = 0.0;
+        double      rotationAngle = 0.0;
+        double      height = 0.0;
+        double      widthFactor = 1.0;
+        std::string value;
+        int16_t     generation = 0;
+        int16_t     horizontalAlignment = 0;
+        int16_t     verticalAlignment = 0;
+    };
+
+
+    struct CADInsertData
+    {
+        CADPoint3D  insertion;
+        CADPoint3D  scale;
+        double      rotation = 0.0;
+        CADPoint3D  extrusion;
+        bool        hasAttributes = false;
+    };
+
+
+    // R2000+ INSERT scale: BB flags, then x as RD (or 1.0) and y, z as DD relative to x (or x)
+    struct CADInsertScaleCodec
+    {
+        typedef CADPoint3D ValueType;
+
+        template<typename Reader>
+        static void Read(Reader& reader, CADPoint3D& value)
+        {
+            uint8_t flags = reader.Read2Bits();
+
+            value.x = (flags & binary(01)) ? 1.0 : reader.ReadRawDouble();
+
+            if (flags & binary(10))
+            {
+                value.y = value.x;
+                value.z = value.x;
+                return;
+            }
+
+            value.y = reader.ReadBitDoubleWd(value.x);
+            value.z = reader.ReadBitDoubleWd(value.x);
+        }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        {
+            uint8_t flags = reader.Read2Bits();
+
+            if (!(flags & binary(01)))
+                reader.SeekBits(64);
+
+            if (!(flags & binary(10)))
+                reader.SeekFields({ CADFieldKind::BITDOUBLEWD, CADFieldKind::BITDOUBLEWD });
+        }
+    };
+
+
+    namespace fields
+    {
+        DECLARE_SCHEMA_ACCESSOR(LineZIsZero,             CADLineData,       zIsZero)
+        DECLARE_SCHEMA_ACCESSOR(LineStartX,              CADLineData,       start.x)
+        DECLARE_SCHEMA_ACCESSOR(LineStartY,              CADLineData,       start.y)
+        DECLARE_SCHEMA_ACCESSOR(LineStartZ,              CADLineData,       start.z)
+        DECLARE_SCHEMA_ACCESSOR(LineEndX,                CADLineData,       end.x)
+        DECLARE_SCHEMA_ACCESSOR(LineEndY,                CADLineData,       end.y)
+        DECLARE_SCHEMA_ACCESSOR(LineEndZ,                CADLineData,       end.z)
+        DECLARE_SCHEMA_ACCESSOR(LineThickness,           CADLineData,       thickness)
+        DECLARE_SCHEMA_ACCESSOR(LineExtrusion,           CADLineData,       extrusion)
+
+        DECLARE_SCHEMA_ACCESSOR(CircleCenter,            CADCircleData,     center)
+        DECLARE_SCHEMA_ACCESSOR(CircleRadius,            CADCircleData,     radius)
+        DECLARE_SCHEMA_ACCESSOR(CircleThickness,         CADCircleData,     thickness)
+        DECLARE_SCHEMA_ACCESSOR(CircleExtrusion,         CADCircleData,     extrusion)
+
+        DECLARE_SCHEMA_ACCESSOR(ArcCenter,               CADArcData,        center)
+        DECLARE_SCHEMA_ACCESSOR(ArcRadius,               CADArcData,        radius)
+        DECLARE_SCHEMA_ACCESSOR(ArcThickness,            CADArcData,        thickness)
+        DECLARE_SCHEMA_ACCESSOR(ArcExtrusion,            CADArcData,        extrusion)
+        DECLARE_SCHEMA_ACCESSOR(ArcStartAngle,           CADArcData,        startAngle)
+        DECLARE_SCHEMA_ACCESSOR(ArcEndAngle,             CADArcData,        endAngle)
+
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineFlags,         CADLWPolylineData, flags)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineConstWidth,    CADLWPolylineData, constWidth)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineElevation,     CADLWPolylineData, elevation)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineThickness,     CADLWPolylineData, thickness)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineNormal,        CADLWPolylineData, normal)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylinePointsCount,   CADLWPolylineData, pointsCount)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineBulgesCount,   CADLWPolylineData, bulgesCount)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineWidthsCount,   CADLWPolylineData, widthsCount)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylinePoints,        CADLWPolylineData, points)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineBulges,        CADLWPolylineData, bulges)
+        DECLARE_SCHEMA_ACCESSOR(LWPolylineWidths,        CADLWPolylineData, widths)
+
+        DECLARE_SCHEMA_ACCESSOR(TextDataFlags,           CADTextData,       dataFlags)
+        DECLARE_SCHEMA_ACCESSOR(TextElevation,           CADTextData,       elevation)
+        DECLARE_SCHEMA_ACCESSOR(TextInsertion,           CADTextData,       insertion)
+        DECLARE_SCHEMA_ACCESSOR(TextInsertionX,          CADTextData,       insertion.x)
+        DECLARE_SCHEMA_ACCESSOR(TextInsertionY,          CADTextData,       insertion.y)
+        DECLARE_SCHEMA_ACCESSOR(TextAlignmentX,          CADTextData,       alignment.x)
+        DECLARE_SCHEMA_ACCESSOR(TextAlignmentY,          CADTextData,       alignment.y)
+        DECLARE_SCHEMA_ACCESSOR(TextExtrusion,           CADTextData,       extrusion)
+        DECLARE_SCHEMA_ACCESSOR(TextThickness,           CADTextData,       thickness)
+        DECLARE_SCHEMA_ACCESSOR(TextObliqueAngle,        CADTextData,       obliqueAngle)
+        DECLARE_SCHEMA_ACCESSOR(TextRotationAngle,       CADTextData,       rotationAngle)
+        DECLARE_SCHEMA_ACCESSOR(TextHeight,              CADTextData,       height)
+        DECLARE_SCHEMA_ACCESSOR(TextWidthFactor,         CADTextData,       widthFactor)
+        DECLARE_SCHEMA_ACCESSOR(TextValue,               CADTextData,       value)
+        DECLARE_SCHEMA_ACCESSOR(TextGeneration,          CADTextData,       generation)
+        DECLARE_SCHEMA_ACCESSOR(TextHorizontalAlignment, CADTextData,       horizontalAlignment)
+        DECLARE_SCHEMA_ACCESSOR(TextVerticalAlignment,   CADTextData,       verticalAlignment)
+
+        DECLARE_SCHEMA_ACCESSOR(InsertInsertion,         CADInsertData,     insertion)
+        DECLARE_SCHEMA_ACCESSOR(InsertScale,             CADInsertData,     scale)
+        DECLARE_SCHEMA_ACCESSOR(InsertRotation,          CADInsertData,     rotation)
+        DECLARE_SCHEMA_ACCESSOR(InsertExtrusion,         CADInsertData,     extrusion)
+        DECLARE_SCHEMA_ACCESSOR(InsertHasAttributes,     CADInsertData,     hasAttributes)
+    }
+
+
+    struct CADLineSchema : CADObjectSchema<CADLineData,
+        CADFlagField<CADFieldKind::BIT, fields::LineZIsZero>,
+        CADField<CADFieldKind::RAWDOUBLE, fields::LineStartX>,
+        CADDefaultedField<fields::LineEndX, fields::LineStartX>,
+        CADField<CADFieldKind::RAWDOUBLE, fields::LineStartY>,
+        CADDefaultedField<fields::LineEndY, fields::LineStartY>,
+        CADFieldsIf<CADIfFlagsClear<fields::LineZIsZero, 1>,
+            CADField<CADFieldKind::RAWDOUBLE, fields::LineStartZ>,
+            CADDefaultedField<fields::LineEndZ, fields::LineStartZ>>,
+        CADField<CADFieldKind::THICKNESS, fields::LineThickness>,
+        CADField<CADFieldKind::EXTRUSION, fields::LineExtrusion>>
+    {
+        static const CADObject::Type TYPE = CADObject::LINE;
+
+        enum Fields
+        {
+            Z_IS_ZERO, START_X, END_X, START_Y, END_Y, START_Z, END_Z, THICKNESS, EXTRUSION, FIELDS_END
+        };
+    };
+
+
+    struct CADCircleSchema : CADObjectSchema<CADCircleData,
+        CADField<CADFieldKind::VECTOR, fields::CircleCenter>,
+        CADField<CADFieldKind::BITDOUBLE, fields::CircleRadius>,
+        CADField<CADFieldKind::THICKNESS, fields::CircleThickness>,
+        CADField<CADFieldKind::EXTRUSION, fields::CircleExtrusion>>
+    {
+        static const CADObject::Type TYPE = CADObject::CIRCLE;
+
+        enum Fields
+        {
+            CENTER, RADIUS, THICKNESS, EXTRUSION, FIELDS_END
+        };
+    };
+
+
+    struct CADArcSchema : CADObjectSchema<CADArcData,
+        CADField<CADFieldKind::VECTOR, fields::ArcCenter>,
+        CADField<CADFieldKind::BITDOUBLE, fields::ArcRadius>,
+        CADField<CADFieldKind::THICKNESS, fields::ArcThickness>,
+        CADField<CADFieldKind::EXTRUSION, fields::ArcExtrusion>,
+        CADField<CADFieldKind::BITDOUBLE, fields::ArcStartAngle>,
+        CADField<CADFieldKind::BITDOUBLE, fields::ArcEndAngle>>
+    {
+        static const CADObject::Type TYPE = CADObject::ARC;
+
+        enum Fields
+        {
+            CENTER, RADIUS, THICKNESS, EXTRUSION, START_ANGLE, END_ANGLE, FIELDS_END
+        };
+    };
+
+
+    struct CADLWPolylineSchema : CADObjectSchema<CADLWPolylineData,
+        CADFlagField<CADFieldKind::BITSHORT, fields::LWPolylineFlags>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x04>,
+            CADField<CADFieldKind::BITDOUBLE, fields::LWPolylineConstWidth>>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x08>,
+            CADField<CADFieldKind::BITDOUBLE, fields::LWPolylineElevation>>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x02>,
+            CADField<CADFieldKind::BITDOUBLE, fields::LWPolylineThickness>>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x01>,
+            CADField<CADFieldKind::VECTOR, fields::LWPolylineNormal>>,
+        CADFlagField<CADFieldKind::BITLONG, fields::LWPolylinePointsCount>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x10>,
+            CADFlagField<CADFieldKind::BITLONG, fields::LWPolylineBulgesCount>>,
+        CADFieldsIf<CADIfFlagsSet<fields::LWPolylineFlags, 0x20>,
+            CADFlagField<CADFieldKind::BITLONG, fields::LWPolylineWidthsCount>>,
+        CADArrayField<CADVertexChainCodec, fields::LWPolylinePoints, fields::LWPolylinePointsCount>,
+        CADArrayField<CADBitDoubleArrayCodec<double>, fields::LWPolylineBulges, fields::LWPolylineBulgesCount>,
+        CADArrayField<CADBitDoubleArrayCodec<CADLWPolylineWidth>, fields::LWPolylineWidths,
+                      fields::LWPolylineWidthsCount>>
+    {
+        static const CADObject::Type TYPE = CADObject::LWPOLYLINE;
+
+        enum Fields
+        {
+            FLAGS, CONST_WIDTH, ELEVATION, THICKNESS, NORMAL, POINTS_COUNT, BULGES_COUNT, WIDTHS_COUNT,
+            POINTS, BULGES, WIDTHS, FIELDS_END
+        };
+    };
+
+
+    struct CADTextSchema : CADObjectSchema<CADTextData,
+        CADFlagField<CADFieldKind::RAWCHAR, fields::TextDataFlags>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x01>,
+            CADField<CADFieldKind::RAWDOUBLE, fields::TextElevation>>,
+        CADField<CADFieldKind::RAWVECTOR, fields::TextInsertion>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x02>,
+            CADDefaultedField<fields::TextAlignmentX, fields::TextInsertionX>,
+            CADDefaultedField<fields::TextAlignmentY, fields::TextInsertionY>>,
+        CADField<CADFieldKind::EXTRUSION, fields::TextExtrusion>,
+        CADField<CADFieldKind::THICKNESS, fields::TextThickness>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x04>,
+            CADField<CADFieldKind::RAWDOUBLE, fields::TextObliqueAngle>>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x08>,
+            CADField<CADFieldKind::RAWDOUBLE, fields::TextRotationAngle>>,
+        CADField<CADFieldKind::RAWDOUBLE, fields::TextHeight>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x10>,
+            CADField<CADFieldKind::RAWDOUBLE, fields::TextWidthFactor>>,
+        CADField<CADFieldKind::TEXT, fields::TextValue>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x20>,
+            CADField<CADFieldKind::BITSHORT, fields::TextGeneration>>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x40>,
+            CADField<CADFieldKind::BITSHORT, fields::TextHorizontalAlignment>>,
+        CADFieldsIf<CADIfFlagsClear<fields::TextDataFlags, 0x80>,
+            CADField<CADFieldKind::BITSHORT, fields::TextVerticalAlignment>>>
+    {
+        static const CADObject::Type TYPE = CADObject::TEXT;
+
+        enum Fields
+        {
+            DATA_FLAGS, ELEVATION, INSERTION, ALIGNMENT_X, ALIGNMENT_Y, EXTRUSION, THICKNESS, OBLIQUE_ANGLE,
+            ROTATION_ANGLE, HEIGHT, WIDTH_FACTOR, VALUE, GENERATION, HORIZONTAL_ALIGNMENT, VERTICAL_ALIGNMENT,
+            FIELDS_END
+        };
+    };
+
+
+    struct CADInsertSchema : CADObjectSchema<CADInsertData,
+        CADField<CADFieldKind::VECTOR, fields::InsertInsertion>,
+        CADCodecField<CADInsertScaleCodec, fields::InsertScale>,
+        CADField<CADFieldKind::BITDOUBLE, fields::InsertRotation>,
+        CADField<CADFieldKind::VECTOR, fields::InsertExtrusion>,
+        CADField<CADFieldKind::BIT, fields::InsertHasAttributes>>
+    {
+        static const CADObject::Type TYPE = CADObject::INSERT;
+
+        enum Fields
+        {
+            INSERTION, SCALE, ROTATION, EXTRUSION, HAS_ATTRIBUTES, FIELDS_END
+        };
+    };
+
+
+    static_assert(CADLineSchema::FIELDS_COUNT == CADLineSchema::FIELDS_END, "LINE field indices are out of date");
+    static_assert(CADCircleSchema::FIELDS_COUNT == CADCircleSchema::FIELDS_END, "CIRCLE field indices are out of date");
+    static_assert(CADArcSchema::FIELDS_COUNT == CADArcSchema::FIELDS_END, "ARC field indices are out of date");
+    static_assert(CADLWPolylineSchema::FIELDS_COUNT == CADLWPolylineSchema::FIELDS_END,
+                  "LWPOLYLINE field indices are out of date");
+    static_assert(CADTextSchema::FIELDS_COUNT == CADTextSchema::FIELDS_END, "TEXT field indices are out of date");
+    static_assert(CADInsertSchema::FIELDS_COUNT == CADInsertSchema::FIELDS_END, "INSERT field indices are out of date");
+
+}
+
+#endif
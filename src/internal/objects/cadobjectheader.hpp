@@ -0,0 +1,142 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_OBJECTS_CADOBJECTHEADER_HPP
+#define LIBOPENCAD_INTERNAL_OBJECTS_CADOBJECTHEADER_HPP
+
+#include "../io/cadbitstreamreader.hpp"
+#include "../cadobjects.hpp"
+
+namespace libopencad
+{
+
+    // R2000 common data following the type of every object
+    struct CADObjectHeader
+    {
+        uint32_t    bitSize = 0;    // object data before the handle stream, counted from the type
+        uint64_t    handle = 0;
+    };
+
+
+    // Reads the common data up to the extended data included, which is skipped
+    template<typename Reader>
+    void ReadCADObjectHeader(Reader& reader, CADObjectHeader& header)
+    {
+        header.bitSize = static_cast<uint32_t>(reader.ReadRawLong());
+        header.handle = reader.ReadHandleReference().value;
+
+        // EED: runs of an application handle and its bytes, until a zero size
+        for (int16_t size = reader.ReadBitShort(); size > 0 && !reader.IsOverrun(); size = reader.ReadBitShort())
+        {
+            reader.SeekHandle();
+            reader.SeekBits(static_cast<size_t>(size) * 8);
+        }
+    }
+
+
+    // Types of the fixed numbered entities, custom class ones are not covered
+    inline bool IsCADEntityType(int16_t type)
+    {
+        return (type >= CADObject::TEXT && type <= CADObject::MLINE && type != CADObject::DICTIONARY) ||
+               type == CADObject::OLE2FRAME || type == CADObject::LWPOLYLINE || type == CADObject::HATCH;
+    }
+
+
+    // Entities drawn on a layer: block definition markers are left out
+    inline bool IsCADLayerEntityType(int16_t type)
+    {
+        return IsCADEntityType(type) && type != CADObject::BLOCK && type != CADObject::ENDBLK &&
+               type != CADObject::SEQEND;
+    }
+
+
+    // R2000 common entity data following the object header
+    struct CADEntityHeader
+    {
+        uint8_t     ownerMode = 0;          // 0 owned by a block (its handle is stored), 1 paper space, 2 model space
+        int32_t     reactorsCount = 0;
+        bool        noLinks = false;        // previous and next entity handles are not stored
+        int16_t     color = 0;              // 0 BYBLOCK, 256 BYLAYER
+        double      linetypeScale = 0.0;
+        uint8_t     linetypeFlags = 0;      // 3 when the linetype handle is stored
+        uint8_t     plotStyleFlags = 0;     // 3 when the plot style handle is stored
+        int16_t     invisibility = 0;
+        uint8_t     lineWeight = 0;
+    };
+
+
+    // Reads the common entity data following the object header, the preview graphics is
+    // skipped. The reader is left at the entity specific data.
+    template<typename Reader>
+    void ReadCADEntityHeader(Reader& reader, CADEntityHeader& header)
+    {
+        if (reader.ReadBit())
+            reader.SeekBits(static_cast<size_t>(static_cast<uint32_t>(reader.ReadRawLong())) * 8);
+
+        header.ownerMode = reader.Read2Bits();
+        header.reactorsCount = reader.ReadBitLong();
+        header.noLinks = reader.ReadBit();
+        header.color = reader.ReadBitShort();
+        header.linetypeScale = reader.ReadBitDouble();
+        header.linetypeFlags = reader.Read2Bits();
+        header.plotStyleFlags = reader.Read2Bits();
+        header.invisibility = reader.ReadBitShort();
+        header.lineWeight = reader.ReadChar();
+    }
+
+
+    /*
+     * Layer handle of an entity. Moves the reader to the handle stream and steps over the
+     * owner, reactors, extension dictionary and linked entities stored before the layer.
+     */
+    template<typename Reader>
+    uint64_t ReadCADEntityLayer(Reader& reader, const CADObjectHeader& objectHeader,
+                                const CADEntityHeader& entityHeader)
+    {
+        reader.SetOffset(objectHeader.bitSize);
+
+        // Every handle takes at least a byte, which bounds the count of reactors
+        size_t bitsCount = reader.GetSize() * 8;
+        size_t bitsLeft = reader.IsOverrun() || reader.GetOffset() > bitsCount ? 0 : bitsCount - reader.GetOffset();
+        if (entityHeader.reactorsCount < 0 || static_cast<size_t>(entityHeader.reactorsCount) > bitsLeft / 8)
+        {
+            reader.Fail(CADReadError::CORRUPTED_DATA);
+            return 0;
+        }
+
+        size_t handlesCount = (entityHeader.ownerMode == 0 ? 1 : 0) +
+                              static_cast<size_t>(entityHeader.reactorsCount) + 1 + (entityHeader.noLinks ? 0 : 2);
+        for (size_t handleIdx = 0; handleIdx < handlesCount; ++handleIdx)
+            reader.SeekHandle();
+
+        return reader.ReadHandleReference().Resolve(objectHeader.handle);
+    }
+
+}
+
+#endif
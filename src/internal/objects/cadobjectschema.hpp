@@ -0,0 +1,593 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_OBJECTS_CADOBJECTSCHEMA_HPP
+#define LIBOPENCAD_INTERNAL_OBJECTS_CADOBJECTSCHEMA_HPP
+
+#include "../io/cadbitstreamreader.hpp"
+#include "../io/cadfileio.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Declares an accessor type for a (possibly nested) member of an object, schema
+ * fields use accessors instead of member pointers so that point coordinates can be
+ * addressed one by one.
+ */
+#define DECLARE_SCHEMA_ACCESSOR(AccessorName, ObjectName, member) \
+    struct AccessorName \
+    { \
+        typedef ObjectName ObjectType; \
+        static auto Get(ObjectName& object) -> decltype((object.member)) { return object.member; } \
+    };
+
+namespace libopencad
+{
+
+    struct CADPoint2D
+    {
+        double x = 0.0;
+        double y = 0.0;
+    };
+
+
+    struct CADPoint3D
+    {
+        double x = 0.0;
+        double y = 0.0;
+        double z = 0.0;
+    };
+
+
+    /*
+     * Codecs, one per field kind: the value type a field of this kind decodes to, how
+     * to decode it and how to step over it without decoding.
+     */
+    template<CADFieldKind Kind>
+    struct CADFieldCodec;
+
+
+#define DECLARE_FIELD_CODEC(Kind, Value, ReadExpression, SkipStatement) \
+    template<> \
+    struct CADFieldCodec<CADFieldKind::Kind> \
+    { \
+        typedef Value ValueType; \
+        template<typename Reader> \
+        static void Read(Reader& reader, Value& value) { value = ReadExpression; } \
+        template<typename Reader> \
+        static void Skip(Reader& reader) { SkipStatement; } \
+    };
+
+    DECLARE_FIELD_CODEC(BIT,          bool,        reader.ReadBit(),        reader.SeekBit())
+    DECLARE_FIELD_CODEC(BITS2,        uint8_t,     reader.Read2Bits(),      reader.SeekBits(2))
+    DECLARE_FIELD_CODEC(BITS3,        uint8_t,     reader.Read3Bits(),      reader.SeekBits(3))
+    DECLARE_FIELD_CODEC(BITSHORT,     int16_t,     reader.ReadBitShort(),   reader.SeekBitShort())
+    DECLARE_FIELD_CODEC(BITLONG,      int32_t,     reader.ReadBitLong(),    reader.SeekBitLong())
+    DECLARE_FIELD_CODEC(BITDOUBLE,    double,      reader.ReadBitDouble(),  reader.SeekBitDouble())
+    DECLARE_FIELD_CODEC(RAWCHAR,      uint8_t,     reader.ReadChar(),       reader.SeekBits(8))
+    DECLARE_FIELD_CODEC(RAWSHORT,     int16_t,     reader.ReadRawShort(),   reader.SeekBits(16))
+    DECLARE_FIELD_CODEC(RAWLONG,      int32_t,     reader.ReadRawLong(),    reader.SeekBits(32))
+    DECLARE_FIELD_CODEC(RAWDOUBLE,    double,      reader.ReadRawDouble(),  reader.SeekBits(64))
+    DECLARE_FIELD_CODEC(MODULARCHAR,  int32_t,     reader.ReadMChar(),      reader.SeekMChar())
+    DECLARE_FIELD_CODEC(MODULARSHORT, uint32_t,    reader.ReadMShort(),     reader.SeekMShort())
+    DECLARE_FIELD_CODEC(TEXT,         std::string, reader.ReadTv(),         reader.SeekTv())
+    DECLARE_FIELD_CODEC(HANDLE,       CADHandle,   reader.ReadHandle(),     reader.SeekHandle())
+
+#undef DECLARE_FIELD_CODEC
+
+    static_assert(sizeof(CADPoint2D) == 2 * sizeof(double), "CADPoint2D has to be two packed doubles");
+    static_assert(sizeof(CADPoint3D) == 3 * sizeof(double), "CADPoint3D has to be three packed doubles");
+
+
+    template<>
+    struct CADFieldCodec<CADFieldKind::VECTOR>
+    {
+        typedef CADPoint3D ValueType;
+
+        template<typename Reader>
+        static void Read(Reader& reader, CADPoint3D& value)
+        { reader.ReadBitDoubles(&value.x, 3); }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        { reader.SeekFields({ CADFieldKind::BITDOUBLE, CADFieldKind::BITDOUBLE, CADFieldKind::BITDOUBLE }); }
+    };
+
+
+    template<>
+    struct CADFieldCodec<CADFieldKind::RAWVECTOR>
+    {
+        typedef CADPoint2D ValueType;
+
+        template<typename Reader>
+        static void Read(Reader& reader, CADPoint2D& value)
+        { reader.ReadRawDoubles(&value.x, 2); }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        { reader.SeekBits(128); }
+    };
+
+
+    // R2000+ thickness: a set bit stands for zero
+    template<>
+    struct CADFieldCodec<CADFieldKind::THICKNESS>
+    {
+        typedef double ValueType;
+
+        template<typename Reader>
+        static void Read(Reader& reader, double& value)
+        { value = reader.ReadBit() ? 0.0 : reader.ReadBitDouble(); }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        { reader.SeekThickness(); }
+    };
+
+
+    // R2000+ extrusion: a set bit stands for (0, 0, 1)
+    template<>
+    struct CADFieldCodec<CADFieldKind::EXTRUSION>
+    {
+        typedef CADPoint3D ValueType;
+
+        template<typename Reader>
+        static void Read(Reader& reader, CADPoint3D& value)
+        {
+            if (reader.ReadBit())
+            {
+                value.x = 0.0;
+                value.y = 0.0;
+                value.z = 1.0;
+                return;
+            }
+
+            reader.ReadBitDoubles(&value.x, 3);
+        }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        { reader.SeekExtrusion(); }
+    };
+
+
+    // R2000 strings keep their terminating zero, TEXT fields come with it. Cuts value at
+    // the first zero.
+    inline void TrimCADStringTerminator(std::string& value)
+    { value.erase(std::find(value.begin(), value.end(), '\0'), value.end()); }
+
+
+    // Array codecs, count elements of the array are decoded in one call
+    template<typename Element>
+    struct CADBitDoubleArrayCodec
+    {
+        static_assert(sizeof(Element) % sizeof(double) == 0, "Element has to be made of doubles");
+        static const size_t DOUBLES_PER_ELEMENT = sizeof(Element) / sizeof(double);
+        static const size_t MIN_ELEMENT_BITS = DOUBLES_PER_ELEMENT * 2;
+
+        template<typename Reader>
+        static void Read(Reader& reader, Element* values, size_t count)
+        { reader.ReadBitDoubles(reinterpret_cast<double*>(values), count * DOUBLES_PER_ELEMENT); }
+
+        template<typename Reader>
+        static void Skip(Reader& reader, size_t count)
+        {
+            for (size_t idx = 0; idx < count * DOUBLES_PER_ELEMENT; ++idx)
+                reader.SeekBitDouble();
+        }
+    };
+
+
+    // R2000+ polyline vertices: the first one is 2RD, every next one 2DD relative to the previous
+    struct CADVertexChainCodec
+    {
+        static const size_t MIN_ELEMENT_BITS = 4;
+
+        template<typename Reader>
+        static void Read(Reader& reader, CADPoint2D* values, size_t count)
+        {
+            if (count == 0)
+                return;
+
+            reader.ReadRawDoubles(&values[0].x, 2);
+            reader.ReadBitDoublesWd(&values[0].x, &values[1].x, (count - 1) * 2);
+        }
+
+        template<typename Reader>
+        static void Skip(Reader& reader, size_t count)
+        {
+            if (count == 0)
+                return;
+
+            reader.SeekBits(128);
+            for (size_t idx = 0; idx < (count - 1) * 2; ++idx)
+                reader.SeekBitDoubleWd();
+        }
+    };
+
+
+    /*
+     * Field lists. A schema is a sequence of nodes, every node provides:
+     *   FIELDS_COUNT                   - number of leaf fields it contains
+     *   Read(reader, object)           - decodes all of its fields
+     *   Skip(reader, object)           - steps over its fields, decoding only flag fields
+     *   Project<Index, Set>(reader, o) - decodes the leaves whose index (counted from
+     *                                    Index in declaration order) is in Set, skips others
+     * Everything is resolved at compile time, a schema decoder is a straight sequence of
+     * reader calls.
+     */
+
+    // Set of leaf field indices for projections
+    template<size_t... Indices>
+    struct CADFieldSet;
+
+    template<>
+    struct CADFieldSet<>
+    {
+        template<size_t Index>
+        struct Contains : std::false_type {};
+
+        // one past the last selected index, a projection stops there
+        static const size_t END = 0;
+    };
+
+    template<size_t Head, size_t... Tail>
+    struct CADFieldSet<Head, Tail...>
+    {
+        template<size_t Index>
+        struct Contains : std::integral_constant<bool, Index == Head ||
+                                                       CADFieldSet<Tail...>::template Contains<Index>::value> {};
+
+        static const size_t END = Head + 1 > CADFieldSet<Tail...>::END ? Head + 1 : CADFieldSet<Tail...>::END;
+    };
+
+
+    // Leaf field decoded by Codec into Accessor's member
+    template<typename Codec, typename Accessor>
+    struct CADCodecField
+    {
+        static const size_t FIELDS_COUNT = 1;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader& reader, Object& object)
+        {
+            static_assert(std::is_same<decltype(Accessor::Get(object)), typename Codec::ValueType&>::value,
+                          "Accessor type does not match the field codec");
+            Codec::Read(reader, Accessor::Get(object));
+        }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object&)
+        { Codec::Skip(reader); }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        {
+            if (Set::template Contains<Index>::value)
+                Read(reader, object);
+            else
+                Skip(reader, object);
+        }
+    };
+
+
+    template<CADFieldKind Kind, typename Accessor>
+    using CADField = CADCodecField<CADFieldCodec<Kind>, Accessor>;
+
+
+    // Field the layout of the following fields depends on (flags, counts), always decoded
+    template<CADFieldKind Kind, typename Accessor>
+    struct CADFlagField : CADField<Kind, Accessor>
+    {
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object& object)
+        { CADField<Kind, Accessor>::Read(reader, object); }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        { CADField<Kind, Accessor>::Read(reader, object); }
+    };
+
+
+    /*
+     * DD field patched over the value of DefaultAccessor. The default is taken from the
+     * object, so a projection selecting this field has to select its default source too.
+     */
+    template<typename Accessor, typename DefaultAccessor>
+    struct CADDefaultedField
+    {
+        static const size_t FIELDS_COUNT = 1;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader& reader, Object& object)
+        { Accessor::Get(object) = reader.ReadBitDoubleWd(DefaultAccessor::Get(object)); }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object&)
+        { reader.SeekBitDoubleWd(); }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        {
+            if (Set::template Contains<Index>::value)
+                Read(reader, object);
+            else
+                Skip(reader, object);
+        }
+    };
+
+
+    // Vector field with CountAccessor elements, the count has to be decoded before
+    template<typename Codec, typename Accessor, typename CountAccessor>
+    struct CADArrayField
+    {
+        static const size_t FIELDS_COUNT = 1;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader& reader, Object& object)
+        {
+            size_t count = ValidCount(reader, object);
+
+            auto& values = Accessor::Get(object);
+            values.resize(count);
+            Codec::Read(reader, values.data(), count);
+        }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object& object)
+        { Codec::Skip(reader, ValidCount(reader, object)); }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        {
+            if (Set::template Contains<Index>::value)
+                Read(reader, object);
+            else
+                Skip(reader, object);
+        }
+
+    private:
+        // Rejects counts which cannot fit into the rest of the stream before allocating
+        template<typename Reader, typename Object>
+        static size_t ValidCount(Reader& reader, Object& object)
+        {
+            auto count = CountAccessor::Get(object);
+            size_t bitsLeft = reader.IsOverrun() ? 0 : reader.GetSize() * 8 - reader.GetOffset();
+
+            if (count < 0 || static_cast<size_t>(count) > bitsLeft / Codec::MIN_ELEMENT_BITS)
+            {
+                reader.Fail(CADReadError::CORRUPTED_DATA);
+                return 0;
+            }
+
+            return static_cast<size_t>(count);
+        }
+    };
+
+
+    template<typename... Fields>
+    struct CADFieldSequence;
+
+    template<>
+    struct CADFieldSequence<>
+    {
+        static const size_t FIELDS_COUNT = 0;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader&, Object&)
+        { }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader&, Object&)
+        { }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader&, Object&)
+        { }
+    };
+
+    template<typename Field, typename... Fields>
+    struct CADFieldSequence<Field, Fields...>
+    {
+        typedef CADFieldSequence<Fields...> Tail;
+        static const size_t FIELDS_COUNT = Field::FIELDS_COUNT + Tail::FIELDS_COUNT;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader& reader, Object& object)
+        {
+            Field::Read(reader, object);
+            Tail::Read(reader, object);
+        }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object& object)
+        {
+            Field::Skip(reader, object);
+            Tail::Skip(reader, object);
+        }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        { ProjectImpl<Index, Set>(reader, object, std::integral_constant<bool, (Index < Set::END)>()); }
+
+    private:
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void ProjectImpl(Reader& reader, Object& object, std::true_type)
+        {
+            Field::template Project<Index, Set>(reader, object);
+            Tail::template Project<Index + Field::FIELDS_COUNT, Set>(reader, object);
+        }
+
+        // nothing selected from here on
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void ProjectImpl(Reader&, Object&, std::false_type)
+        { }
+    };
+
+
+    // Fields present only when Condition::Test(object) holds
+    template<typename Condition, typename... Fields>
+    struct CADFieldsIf
+    {
+        typedef CADFieldSequence<Fields...> Sequence;
+        static const size_t FIELDS_COUNT = Sequence::FIELDS_COUNT;
+
+        template<typename Reader, typename Object>
+        static void Read(Reader& reader, Object& object)
+        {
+            if (Condition::Test(object))
+                Sequence::Read(reader, object);
+        }
+
+        template<typename Reader, typename Object>
+        static void Skip(Reader& reader, Object& object)
+        {
+            if (Condition::Test(object))
+                Sequence::Skip(reader, object);
+        }
+
+        template<size_t Index, typename Set, typename Reader, typename Object>
+        static void Project(Reader& reader, Object& object)
+        {
+            if (Condition::Test(object))
+                Sequence::template Project<Index, Set>(reader, object);
+        }
+    };
+
+
+    // Conditions over flag fields
+    template<typename Accessor, uint32_t Mask>
+    struct CADIfFlagsSet
+    {
+        template<typename Object>
+        static bool Test(Object& object)
+        { return (static_cast<uint32_t>(Accessor::Get(object)) & Mask) != 0; }
+    };
+
+
+    template<typename Accessor, uint32_t Mask>
+    struct CADIfFlagsClear
+    {
+        template<typename Object>
+        static bool Test(Object& object)
+        { return (static_cast<uint32_t>(Accessor::Get(object)) & Mask) == 0; }
+    };
+
+
+    /*
+     * Object schema: Read decodes every field, Project<CADFieldSet<...>> only the
+     * selected ones (stopping after the last of them) and Skip steps over the object.
+     * Fields absent from the stream keep their values, so Read expects a fresh object.
+     * Decoders are generated for any reader bounds policy, with an unchecked reader the
+     * caller tests IsOverrun() once the object is decoded.
+     */
+    template<typename Object, typename... Fields>
+    struct CADObjectSchema
+    {
+        typedef Object ObjectType;
+        typedef CADFieldSequence<Fields...> Sequence;
+        static const size_t FIELDS_COUNT = Sequence::FIELDS_COUNT;
+
+        template<typename Reader>
+        static void Read(Reader& reader, Object& object)
+        { Sequence::Read(reader, object); }
+
+        template<typename Reader>
+        static Object Decode(Reader& reader)
+        {
+            Object object;
+            Read(reader, object);
+            return object;
+        }
+
+        template<typename Set, typename Reader>
+        static void Project(Reader& reader, Object& object)
+        { Sequence::template Project<0, Set>(reader, object); }
+
+        template<typename Reader>
+        static void Skip(Reader& reader)
+        {
+            Object flags;
+            Sequence::Skip(reader, flags);
+        }
+    };
+
+
+    // Outcome of decoding one object, errorOffset is the bit offset of the failed read
+    struct CADObjectStatus
+    {
+        CADReadError error = CADReadError::NONE;
+        size_t       errorOffset = 0;
+
+        bool IsOk() const
+        { return error == CADReadError::NONE; }
+    };
+
+
+    template<typename Object>
+    struct CADObjectResult
+    {
+        Object          object;
+        CADObjectStatus status;
+    };
+
+
+    /*
+     * Decodes the objects stored at the given byte ranges of source with Schema. Every
+     * object gets its own sticky error reader, so damaged or truncated objects are
+     * reported in their result and never throw.
+     */
+    template<typename Schema, typename Reader>
+    std::vector<CADObjectResult<typename Schema::ObjectType>> DecodeCADObjects(const Reader& source,
+                                                                              const std::vector<CADByteRange>& ranges)
+    {
+        std::vector<CADObjectResult<typename Schema::ObjectType>> results(ranges.size());
+
+        // source outlives the call, a non-owning view is enough
+        CADStickyBitStreamReader view(source.GetData(), source.GetSize());
+
+        for (size_t idx = 0; idx < ranges.size(); ++idx)
+        {
+            CADStickyBitStreamReader reader =
+                view.SubReader<CADStickyErrorBounds>(ranges[idx].offset, ranges[idx].size);
+
+            Schema::Read(reader, results[idx].object);
+            results[idx].status.error = reader.GetError();
+            results[idx].status.errorOffset = reader.GetErrorOffset();
+        }
+
+        return results;
+    }
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ *  Project: libopencad
+ *  Purpose: OpenSource CAD formats support library
+ *  Author: Alexandr Borzykh, mush3d at gmail.com
+ *  Language: C++
+ *******************************************************************************
+ *  The MIT License (MIT)
+ *
+ *  Copyright (c) 2017 Alexandr Borzykh
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *******************************************************************************/
+#ifndef LIBOPENCAD_INTERNAL_OBJECTS_CADTABLESCHEMAS_HPP
+#define LIBOPENCAD_INTERNAL_OBJECTS_CADTABLESCHEMAS_HPP
+
+#include "cadobjectheader.hpp"
+#include "cadobjectschema.hpp"
+#include "../cadobjects.hpp"
+
+/*
+ * R2000 schemas of table entries, the part of the object following the common object
+ * data (CADObjectHeader). Handle references are not covered.
+ */
+
+namespace libopencad
+{
+
+    struct CADLayerData
+    {
+        uint64_t    handle = 0;         // from the object header, not a schema field
+        int32_t     reactorsCount = 0;
+        std::string name;
+        bool        flag64 = false;
+        int16_t     xrefIndex = 0;
+        bool        xrefDependent = false;
+        int16_t     flags = 0;          // frozen 0x01, frozen in new viewports 0x04, locked 0x08, plotted 0x10
+        int16_t     color = 0;          // negative when the layer is off
+    };
+
+
+    namespace fields
+    {
+        DECLARE_SCHEMA_ACCESSOR(LayerReactorsCount,      CADLayerData,      reactorsCount)
+        DECLARE_SCHEMA_ACCESSOR(LayerName,               CADLayerData,      name)
+        DECLARE_SCHEMA_ACCESSOR(LayerFlag64,             CADLayerData,      flag64)
+        DECLARE_SCHEMA_ACCESSOR(LayerXrefIndex,          CADLayerData,      xrefIndex)
+        DECLARE_SCHEMA_ACCESSOR(LayerXrefDependent,      CADLayerData,      xrefDependent)
+        DECLARE_SCHEMA_ACCESSOR(LayerFlags,              CADLayerData,      flags)
+        DECLARE_SCHEMA_ACCESSOR(LayerColor,              CADLayerData,      color)
+    }
+
+
+    struct CADLayerSchema : CADObjectSchema<CADLayerData,
+        CADField<CADFieldKind::BITLONG, fields::LayerReactorsCount>,
+        CADField<CADFieldKind::TEXT, fields::LayerName>,
+        CADField<CADFieldKind::BIT, fields::LayerFlag64>,
+        CADField<CADFieldKind::BITSHORT, fields::LayerXrefIndex>,
+        CADField<CADFieldKind::BIT, fields::LayerXrefDependent>,
+        CADField<CADFieldKind::BITSHORT, fields::LayerFlags>,
+        CADField<CADFieldKind::BITSHORT, fields::LayerColor>>
+    {
+        static const CADObject::Type TYPE = CADObject::LAYER;
+
+        enum Fields
+        {
+            REACTORS_COUNT, NAME, FLAG64, XREF_INDEX, XREF_DEPENDENT, FLAGS, COLOR, FIELDS_END
+        };
+    };
+
+
+    static_assert(CADLayerSchema::FIELDS_COUNT == CADLayerSchema::FIELDS_END, "LAYER field indices are out of date");
+
+
+    // Decodes a whole LAYER object from its type on, false if the object is no layer or
+    // the reader failed. The name comes without the terminating zero R2000 strings keep.
+    template<typename Reader>
+    bool ReadCADLayerObject(Reader& reader, CADLayerData& layer)
+    {
+        if (reader.ReadBitShort() != CADLayerSchema::TYPE)
+            return false;
+
+        CADObjectHeader header;
+        ReadCADObjectHeader(reader, header);
+        CADLayerSchema::Read(reader, layer);
+        if (reader.GetError() != CADReadError::NONE)
+            return false;
+
+        TrimCADStringTerminator(layer.name);
+        layer.handle = header.handle;
+        return true;
+    }
+
+}
+
+#endif
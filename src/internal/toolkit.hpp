@@ -53,6 +53,6 @@ struct bin< 0 >
 #define binary( n ) bin<0##n>::value
 
 #define DECLARE_PTR(ClassName) \
-    using std::shared_ptr<ClassName> = ClassName##Ptr;
+    using ClassName##Ptr = std::shared_ptr<ClassName>;
 
 #endif
@@ -0,0 +1,1416 @@
+#include "gtest/gtest.h"
+#include "libopencad/cadfile.hpp"
+#include "internal/cadobjects.hpp"
+#include "internal/io/cadblockcache.hpp"
+#include "internal/io/cadcrc.hpp"
+#include "internal/io/cadfilemetadata.hpp"
+#include "internal/io/cadfilereader.hpp"
+#include "internal/io/cadprefetcher.hpp"
+#include "internal/io/cadrangeplanner.hpp"
+#include "internal/io/cadsidecarindex.hpp"
+#include "internal/io/defaultcadfileio.hpp"
+#include "internal/io/mappedcadfileio.hpp"
+#include "internal/io/memorycadfileio.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <thread>
+
+#define TEST_FILE "data/r2000/triple_circles.dwg"
+
+static ByteArray ReadWholeFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return ByteArray(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+
+TEST(mappedfileio, read)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+    ASSERT_FALSE(expected.empty());
+
+    libopencad::MappedCADFileIO fileIO(TEST_FILE, libopencad::MappedCADFileIO::AccessPattern::SEQUENTIAL);
+    ASSERT_TRUE(fileIO.IsOpened());
+    ASSERT_EQ(expected.size(), fileIO.GetSize());
+
+    ByteArray version = fileIO.Read(6);
+    ASSERT_EQ("AC1015", std::string(version.begin(), version.end()));
+    ASSERT_EQ(6, fileIO.Tell());
+
+    ASSERT_EQ(expected.size() - 16, fileIO.Seek(-16, libopencad::ICADFileIO::SeekOrigin::END));
+    ByteArray tail = fileIO.Read(32);
+    ASSERT_EQ(ByteArray(expected.end() - 16, expected.end()), tail);
+    ASSERT_TRUE(fileIO.Eof());
+
+    fileIO.Advise(0x15, 1024, libopencad::MappedCADFileIO::AccessPattern::RANDOM);
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), fileIO.GetData()));
+}
+
+
+TEST(mappedfileio, missingfile)
+{
+    libopencad::MappedCADFileIO fileIO("data/r2000/does_not_exist.dwg");
+    ASSERT_FALSE(fileIO.IsOpened());
+    ASSERT_TRUE(fileIO.Read(16).empty());
+}
+
+
+TEST(mappedfileio, readinto)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    libopencad::MappedCADFileIO fileIO(TEST_FILE);
+    ByteArray scratch;
+    scratch.reserve(256);
+    const uint8_t* capacityData = scratch.data();
+
+    ASSERT_EQ(128, fileIO.ReadInto(scratch, 128));
+    ASSERT_EQ(capacityData, scratch.data());
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin()));
+
+    uint8_t buffer[64];
+    ASSERT_EQ(64, fileIO.ReadInto(buffer, sizeof(buffer)));
+    ASSERT_TRUE(std::equal(buffer, buffer + sizeof(buffer), expected.begin() + 128));
+
+    const uint8_t* view = fileIO.ReadView(32);
+    ASSERT_EQ(fileIO.GetData() + 192, view);
+    ASSERT_EQ(224, fileIO.Tell());
+
+    fileIO.Seek(-8, libopencad::ICADFileIO::SeekOrigin::END);
+    ASSERT_EQ(nullptr, fileIO.ReadView(16));
+    ASSERT_EQ(expected.size() - 8, fileIO.Tell());
+    ASSERT_EQ(8, fileIO.ReadInto(scratch, 16));
+}
+
+
+TEST(defaultfileio, readinto)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    libopencad::DefaultCADFileIO fileIO(TEST_FILE);
+    ASSERT_TRUE(fileIO.IsOpened());
+    ASSERT_EQ(nullptr, fileIO.ReadView(16));
+
+    ByteArray scratch;
+    ASSERT_EQ(16, fileIO.ReadInto(scratch, 16));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin()));
+
+    fileIO.Seek(-4, libopencad::ICADFileIO::SeekOrigin::END);
+    ByteArray tail = fileIO.Read(16);
+    ASSERT_EQ(ByteArray(expected.end() - 4, expected.end()), tail);
+
+    // opened read-only
+    ASSERT_EQ(0, fileIO.Write(ByteArray(4, 0)));
+    ASSERT_EQ(expected, ReadWholeFile(TEST_FILE));
+}
+
+
+TEST(defaultfileio, concurrentreadat)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    libopencad::DefaultCADFileIO fileIO(TEST_FILE);
+    ASSERT_EQ(expected.size(), fileIO.GetSize());
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> mismatches(4, 0);
+
+    for (size_t threadIdx = 0; threadIdx < mismatches.size(); ++threadIdx)
+    {
+        threads.push_back(std::thread([&, threadIdx]()
+        {
+            ByteArray scratch;
+            for (size_t idx = 0; idx < 1000; ++idx)
+            {
+                size_t offset = (idx * 7919 + threadIdx * 104729) % expected.size();
+                fileIO.ReadAt(offset, scratch, 512);
+
+                if (!std::equal(scratch.begin(), scratch.end(), expected.begin() + offset) ||
+                    scratch.size() != std::min<size_t>(512, expected.size() - offset))
+                    ++mismatches[threadIdx];
+            }
+        }));
+    }
+
+    // cursor reads are not affected by positional ones
+    ByteArray head = fileIO.Read(6);
+    for (size_t threadIdx = 0; threadIdx < threads.size(); ++threadIdx)
+        threads[threadIdx].join();
+
+    ASSERT_EQ("AC1015", std::string(head.begin(), head.end()));
+    ASSERT_EQ(6, fileIO.Tell());
+    for (size_t threadIdx = 0; threadIdx < mismatches.size(); ++threadIdx)
+        ASSERT_EQ(0, mismatches[threadIdx]);
+}
+
+
+TEST(memoryfileio, owned)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+    ByteArray payload = expected;
+    const uint8_t* payloadData = payload.data();
+
+    libopencad::MemoryCADFileIO fileIO(std::move(payload));
+    ASSERT_EQ(expected.size(), fileIO.GetSize());
+
+    const uint8_t* view = fileIO.ReadView(6);
+    ASSERT_EQ(payloadData, view);
+    ASSERT_EQ("AC1015", std::string(view, view + 6));
+
+    ByteArray scratch;
+    ASSERT_EQ(100, fileIO.ReadAt(expected.size() - 100, scratch, 200));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.end() - 100));
+}
+
+
+TEST(memoryfileio, chunked)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    std::vector<libopencad::MemoryCADFileIO::Chunk> chunks;
+    for (size_t offset = 0; offset < expected.size(); offset += 1000)
+    {
+        libopencad::MemoryCADFileIO::Chunk chunk = { expected.data() + offset,
+                                                     std::min<size_t>(1000, expected.size() - offset) };
+        chunks.push_back(chunk);
+    }
+
+    libopencad::MemoryCADFileIO fileIO(chunks);
+    ASSERT_EQ(expected.size(), fileIO.GetSize());
+
+    ASSERT_EQ(expected.data() + 1200, fileIO.ViewAt(1200, 800));
+    ASSERT_EQ(nullptr, fileIO.ViewAt(1200, 801));
+
+    ByteArray scratch;
+    fileIO.Seek(900, libopencad::ICADFileIO::SeekOrigin::BEG);
+    ASSERT_EQ(2500, fileIO.ReadInto(scratch, 2500));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin() + 900));
+    ASSERT_EQ(3400, fileIO.Tell());
+
+    fileIO.Seek(-10, libopencad::ICADFileIO::SeekOrigin::END);
+    ASSERT_EQ(10, fileIO.ReadInto(scratch, 2500));
+    ASSERT_TRUE(fileIO.Eof());
+}
+
+
+TEST(blockcache, sharedbudget)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    // four 1 KiB blocks shared by two files
+    libopencad::CADBlockCachePtr cache = std::make_shared<libopencad::CADBlockCache>(4096, 1024);
+    libopencad::CachedCADFileIO first(std::make_shared<libopencad::DefaultCADFileIO>(TEST_FILE), cache);
+    libopencad::CachedCADFileIO second(std::make_shared<libopencad::MappedCADFileIO>(TEST_FILE), cache);
+
+    ByteArray scratch;
+    ASSERT_EQ(1500, first.ReadAt(1000, scratch, 1500));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin() + 1000));
+
+    libopencad::CADBlockCache::Statistics statistics = cache->GetStatistics();
+    ASSERT_EQ(0, statistics.hits);
+    ASSERT_EQ(3, statistics.misses);
+    ASSERT_EQ(3 * 1024, statistics.bytesUsed);
+
+    ASSERT_EQ(100, first.ReadAt(1024, scratch, 100));
+    ASSERT_EQ(1, cache->GetStatistics().hits);
+
+    // same offsets of another file are separate blocks, budget forces evictions
+    ASSERT_EQ(2048, second.ReadAt(0, scratch, 2048));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin()));
+
+    statistics = cache->GetStatistics();
+    ASSERT_EQ(5, statistics.misses);
+    ASSERT_EQ(1, statistics.evictions);
+    ASSERT_EQ(4, statistics.blocksCount);
+    ASSERT_EQ(4096, statistics.bytesUsed);
+
+    first.Seek(-10, libopencad::ICADFileIO::SeekOrigin::END);
+    ASSERT_EQ(10, first.ReadInto(scratch, 100));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.end() - 10));
+
+    // reads past the end keep no empty block
+    statistics = cache->GetStatistics();
+    ASSERT_EQ(0, first.ReadAt(expected.size() + 4096, scratch, 16));
+    ASSERT_EQ(0, first.ReadAt(expected.size() + 4096, scratch, 16));
+    ASSERT_EQ(statistics.misses + 2, cache->GetStatistics().misses);
+    ASSERT_EQ(statistics.blocksCount, cache->GetStatistics().blocksCount);
+
+    // a closed file takes its blocks along, the others stay
+    {
+        libopencad::CachedCADFileIO third(std::make_shared<libopencad::MappedCADFileIO>(TEST_FILE), cache);
+        ASSERT_EQ(100, third.ReadAt(0, scratch, 100));
+        statistics = cache->GetStatistics();
+    }
+    ASSERT_EQ(statistics.blocksCount - 1, cache->GetStatistics().blocksCount);
+    ASSERT_EQ(statistics.bytesUsed - 1024, cache->GetStatistics().bytesUsed);
+
+    uint64_t hits = cache->GetStatistics().hits;
+    ASSERT_EQ(10, first.ReadAt(expected.size() - 10, scratch, 10));
+    ASSERT_EQ(hits + 1, cache->GetStatistics().hits);
+}
+
+
+TEST(fileio, seekbounds)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+    std::shared_ptr<libopencad::ICADFileIO> mapped = std::make_shared<libopencad::MappedCADFileIO>(TEST_FILE);
+
+    std::vector<std::shared_ptr<libopencad::ICADFileIO>> backends;
+    backends.push_back(std::make_shared<libopencad::DefaultCADFileIO>(TEST_FILE));
+    backends.push_back(mapped);
+    backends.push_back(std::make_shared<libopencad::MemoryCADFileIO>(expected.data(), expected.size()));
+    backends.push_back(std::make_shared<libopencad::CachedCADFileIO>(
+        mapped, std::make_shared<libopencad::CADBlockCache>(4096, 1024)));
+    backends.push_back(std::make_shared<libopencad::CoalescingCADFileIO>(
+        mapped, std::vector<libopencad::CADByteRange>(), libopencad::CADRangePlanner(256, 1024)));
+
+    // every backend keeps its cursor within [0, size]
+    for (size_t backendIdx = 0; backendIdx < backends.size(); ++backendIdx)
+    {
+        libopencad::ICADFileIO& fileIO = *backends[backendIdx];
+        ASSERT_EQ(expected.size(), fileIO.Seek(100, libopencad::ICADFileIO::SeekOrigin::END)) << backendIdx;
+        ASSERT_EQ(expected.size(), fileIO.Tell()) << backendIdx;
+        ASSERT_TRUE(fileIO.Eof()) << backendIdx;
+
+        ASSERT_EQ(expected.size(), fileIO.Seek(expected.size() + 1, libopencad::ICADFileIO::SeekOrigin::BEG));
+        ASSERT_EQ(0, fileIO.Seek(-1, libopencad::ICADFileIO::SeekOrigin::BEG)) << backendIdx;
+
+        ByteArray scratch;
+        ASSERT_EQ(16, fileIO.Seek(16, libopencad::ICADFileIO::SeekOrigin::CUR)) << backendIdx;
+        ASSERT_EQ(8, fileIO.ReadInto(scratch, 8)) << backendIdx;
+        ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin() + 16)) << backendIdx;
+        ASSERT_EQ(24, fileIO.Tell()) << backendIdx;
+    }
+}
+
+
+TEST(prefetcher, fileorder)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+    libopencad::MappedCADFileIO fileIO(TEST_FILE);
+
+    std::vector<libopencad::CADByteRange> ranges;
+    for (size_t idx = 0; idx < 200; ++idx)
+    {
+        libopencad::CADByteRange range = { (idx * 7919) % expected.size(), 1 + idx % 300 };
+        ranges.push_back(range);
+    }
+
+    libopencad::CADPrefetcher prefetcher(fileIO, ranges, 4);
+
+    libopencad::CADByteRange range;
+    const ByteArray* data = nullptr;
+    size_t count = 0;
+    size_t previousOffset = 0;
+
+    while (prefetcher.Next(range, data))
+    {
+        ASSERT_LE(previousOffset, range.offset);
+        ASSERT_EQ(std::min(range.size, expected.size() - range.offset), data->size());
+        ASSERT_TRUE(std::equal(data->begin(), data->end(), expected.begin() + range.offset));
+
+        previousOffset = range.offset;
+        ++count;
+    }
+
+    ASSERT_EQ(ranges.size(), count);
+    ASSERT_FALSE(prefetcher.Next(range, data));
+}
+
+
+TEST(prefetcher, earlystop)
+{
+    libopencad::MappedCADFileIO fileIO(TEST_FILE);
+
+    std::vector<libopencad::CADByteRange> ranges(100);
+    for (size_t idx = 0; idx < ranges.size(); ++idx)
+    {
+        ranges[idx].offset = idx * 16;
+        ranges[idx].size = 16;
+    }
+
+    libopencad::CADPrefetcher prefetcher(fileIO, ranges, 2);
+
+    libopencad::CADByteRange range;
+    const ByteArray* data = nullptr;
+    ASSERT_TRUE(prefetcher.Next(range, data));
+    ASSERT_EQ(0, range.offset);
+}
+
+
+// Stand-in for a range-GET gateway: counts requests and adds latency to each one
+class FakeRemoteFileIO : public libopencad::MemoryCADFileIO
+{
+public:
+    FakeRemoteFileIO(ByteArray&& buffer, std::chrono::microseconds latency)
+        : libopencad::MemoryCADFileIO(std::move(buffer)),
+          _latency(latency),
+          _requestsCount(0)
+    { }
+
+    using libopencad::MemoryCADFileIO::ReadAt;
+    virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        ++_requestsCount;
+        std::this_thread::sleep_for(_latency);
+        return libopencad::MemoryCADFileIO::ReadAt(offset, buffer, bytesCount);
+    }
+
+    virtual const uint8_t* ViewAt(size_t, size_t) const
+    { return nullptr; }
+
+    size_t GetRequestsCount() const
+    { return _requestsCount; }
+
+private:
+    std::chrono::microseconds   _latency;
+    mutable std::atomic<size_t> _requestsCount;
+};
+
+
+TEST(rangeplanner, plan)
+{
+    std::vector<libopencad::CADByteRange> ranges;
+    libopencad::CADByteRange range;
+
+    range.offset = 500; range.size = 10; ranges.push_back(range);
+    range.offset = 0; range.size = 100; ranges.push_back(range);
+    range.offset = 150; range.size = 100; ranges.push_back(range);
+    range.offset = 120; range.size = 0; ranges.push_back(range);
+    range.offset = 200; range.size = 20; ranges.push_back(range);
+
+    std::vector<libopencad::CADByteRange> planned = libopencad::CADRangePlanner(64).Plan(ranges);
+    ASSERT_EQ(2, planned.size());
+    ASSERT_EQ(0, planned[0].offset);
+    ASSERT_EQ(250, planned[0].size);
+    ASSERT_EQ(500, planned[1].offset);
+    ASSERT_EQ(10, planned[1].size);
+
+    planned = libopencad::CADRangePlanner(64, 200).Plan(ranges);
+    ASSERT_EQ(3, planned.size());
+    ASSERT_EQ(150, planned[1].offset);
+    ASSERT_EQ(100, planned[1].size);
+}
+
+
+TEST(rangeplanner, coalescedreads)
+{
+    ByteArray expected = ReadWholeFile(TEST_FILE);
+
+    std::shared_ptr<FakeRemoteFileIO> remote =
+            std::make_shared<FakeRemoteFileIO>(ByteArray(expected), std::chrono::microseconds(200));
+
+    // objects of 40..100 bytes with small gaps, as found in an object section
+    std::vector<libopencad::CADByteRange> ranges;
+    for (size_t offset = 1000; offset + 100 < 60000; offset += 110)
+    {
+        libopencad::CADByteRange range = { offset, 40 + offset % 61 };
+        ranges.push_back(range);
+    }
+
+    libopencad::CoalescingCADFileIO fileIO(remote, ranges, libopencad::CADRangePlanner(256, 16 * 1024));
+    size_t plannedCount = fileIO.GetPlannedReads().size();
+    ASSERT_EQ(4, plannedCount);
+
+    ByteArray scratch;
+    for (size_t idx = 0; idx < ranges.size(); ++idx)
+    {
+        fileIO.Seek(ranges[idx].offset, libopencad::ICADFileIO::SeekOrigin::BEG);
+        fileIO.ReadInto(scratch, ranges[idx].size);
+        ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin() + ranges[idx].offset));
+    }
+    ASSERT_EQ(plannedCount, remote->GetRequestsCount());
+
+    const uint8_t* view = fileIO.ViewAt(ranges[3].offset, ranges[3].size);
+    ASSERT_NE(nullptr, view);
+    ASSERT_TRUE(std::equal(view, view + ranges[3].size, expected.begin() + ranges[3].offset));
+
+    // a read outside and across the planned ranges
+    ASSERT_EQ(2000, fileIO.ReadAt(59000, scratch, 2000));
+    ASSERT_TRUE(std::equal(scratch.begin(), scratch.end(), expected.begin() + 59000));
+    ASSERT_EQ(plannedCount + 1, remote->GetRequestsCount());
+}
+
+
+static uint16_t ReferenceCrc(const uint8_t* data, size_t size, uint16_t seed)
+{
+    uint16_t crc = seed;
+    for (size_t idx = 0; idx < size; ++idx)
+    {
+        crc ^= data[idx];
+        for (int bitIdx = 0; bitIdx < 8; ++bitIdx)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+
+    return crc;
+}
+
+
+TEST(crc, calculate)
+{
+    std::mt19937 random(17);
+    ByteArray data(3 * 1024 * 1024);
+    for (size_t idx = 0; idx < data.size(); ++idx)
+        data[idx] = static_cast<uint8_t>(random());
+
+    for (size_t idx = 0; idx < 500; ++idx)
+    {
+        size_t offset = random() % 1000;
+        size_t size = random() % 3000;
+        uint16_t seed = static_cast<uint16_t>(random());
+        uint16_t expected = ReferenceCrc(data.data() + offset, size, seed);
+        ASSERT_EQ(expected, libopencad::CalculateCADCrc(data.data() + offset, size, seed));
+
+        size_t firstSize = random() % (size + 1);
+        uint16_t firstCrc = libopencad::CalculateCADCrc(data.data() + offset, firstSize, seed);
+        uint16_t secondCrc = libopencad::CalculateCADCrc(data.data() + offset + firstSize, size - firstSize, 0);
+        ASSERT_EQ(expected, libopencad::CombineCADCrc(firstCrc, secondCrc, size - firstSize));
+    }
+
+    uint16_t expected = ReferenceCrc(data.data(), data.size() - 5, 0xC0C1);
+    ASSERT_EQ(expected, libopencad::CalculateCADCrcParallel(data.data(), data.size() - 5, 0xC0C1, 5));
+    ASSERT_EQ(expected, libopencad::CalculateCADCrcParallel(data.data(), data.size() - 5, 0xC0C1));
+}
+
+
+TEST(filelayout, read)
+{
+    const char* files[] = { "data/r2000/1arc.dwg", "data/r2000/24127_circles_128_lines.dwg",
+                            "data/r2000/256_lwpolylines_7vertexes.dwg", "data/r2000/4solids.dwg",
+                            "data/r2000/5rays_3xlines.dwg", "data/r2000/six_3dpolylines.dwg",
+                            "data/r2000/triple_circles.dwg" };
+
+    for (const char* file : files)
+    {
+        libopencad::CADOpenOptions options;
+        options.validateObjectCrcs = true;
+        options.threadsCount = 2;
+        libopencad::CADFileReader reader(std::make_shared<libopencad::MappedCADFileIO>(file), options);
+
+        const libopencad::CADFileLayout& layout = reader.GetLayout();
+        ASSERT_EQ("AC1015", layout.version);
+        ASSERT_EQ(6, layout.sections.size());
+        ASSERT_NE(nullptr, layout.FindSection(libopencad::CADSectionNumber::CLASSES));
+        ASSERT_GT(layout.objects.GetCount(), 0);
+        for (size_t idx = 1; idx < layout.objects.GetCount(); ++idx)
+            ASSERT_LT(layout.objects.GetHandle(idx - 1), layout.objects.GetHandle(idx));
+
+        // decoding goes on while the CRCs are checked
+        for (size_t idx = 0; idx < reader.GetObjectsCount(); ++idx)
+            ASSERT_GT(reader.ReadObject(idx).GetSize(), 2);
+
+        ASSERT_TRUE(reader.GetCrcMismatches().empty()) << file;
+    }
+
+    libopencad::CADFileReader reader(std::make_shared<libopencad::DefaultCADFileIO>(
+                                         "data/r2000/24127_circles_128_lines.dwg"));
+    ASSERT_EQ(24608, reader.GetObjectsCount());
+    ASSERT_EQ(50822, reader.GetLayout().objects.GetHandle(reader.GetObjectsCount() - 1));
+}
+
+
+TEST(filelayout, crcmismatches)
+{
+    ByteArray data = ReadWholeFile(TEST_FILE);
+    libopencad::CADFileLayout layout = libopencad::ReadCADFileLayout(libopencad::MemoryCADFileIO(data.data(), data.size()));
+
+    // damage two objects, the object map and the file header
+    size_t firstObject = layout.objects.GetOffset(10);
+    size_t secondObject = layout.objects.GetOffset(20);
+    data[firstObject + 5] ^= 0x10;
+    data[secondObject + 2] ^= 0x01;
+    size_t objectMap = layout.FindSection(libopencad::CADSectionNumber::OBJECT_MAP)->offset;
+    data[objectMap + ((data[objectMap] << 8) | data[objectMap + 1])] ^= 0x04;
+    data[0x0D] ^= 0x80;
+
+    libopencad::CADOpenOptions options;
+    options.validateObjectCrcs = true;
+    libopencad::CADFileReader reader(std::make_shared<libopencad::MemoryCADFileIO>(data.data(), data.size()), options);
+
+    std::vector<libopencad::CADCrcMismatch> mismatches = reader.GetCrcMismatches();
+    ASSERT_EQ(4, mismatches.size());
+    ASSERT_EQ(0, mismatches[0].range.offset);
+    ASSERT_EQ(objectMap, mismatches[1].range.offset);
+    ASSERT_EQ(std::min(firstObject, secondObject), mismatches[2].range.offset);
+    ASSERT_EQ(std::max(firstObject, secondObject), mismatches[3].range.offset);
+    ASSERT_NE(mismatches[2].stored, mismatches[2].computed);
+}
+
+
+TEST(objectdirectory, find)
+{
+    libopencad::CADObjectDirectory directory;
+    directory.Add(0x30, 4000, 100, libopencad::CADObject::LINE);
+    directory.Add(0x10, 1000, 40000, libopencad::CADObject::LAYER);
+    directory.Add(0x20, 2000, 10, 500 + 3);
+    directory.Add(0x25, 3000, 10, 500 + 1000);
+    directory.Add(0x40, 5000, 10, 0);
+    directory.Add(0x60, 6000, 20, 498);
+    directory.Add(0x70, 7000, 30, 499);
+    directory.Add(0x80, 8000, 40, 300);
+    directory.Sort();
+
+    ASSERT_EQ(8, directory.GetCount());
+    ASSERT_EQ(0, directory.Find(0x10));
+    ASSERT_EQ(3, directory.Find(0x30));
+    ASSERT_EQ(libopencad::CADObjectDirectory::NPOS, directory.Find(0x11));
+    ASSERT_EQ(libopencad::CADObjectDirectory::NPOS, directory.Find(0x50));
+
+    ASSERT_EQ(libopencad::CADObject::LAYER, directory.GetType(0));
+    ASSERT_EQ(1004, directory.GetDataOffset(0));
+    ASSERT_EQ(503, directory.GetType(1));
+    ASSERT_EQ(libopencad::CADObjectDirectory::OTHER_CLASS_TYPE_CODE, directory.GetTypeCode(2));
+    ASSERT_TRUE(directory.IsReadable(2));
+    ASSERT_EQ(4000, directory.GetOffset(3));
+    ASSERT_EQ(4002, directory.GetDataOffset(3));
+    ASSERT_EQ(100, directory.GetSize(3));
+    ASSERT_FALSE(directory.IsReadable(4));
+    ASSERT_EQ(0, directory.GetSize(4));
+
+    // proxies and unknown types keep their size
+    ASSERT_EQ(498, directory.GetType(5));
+    ASSERT_EQ(20, directory.GetSize(5));
+    ASSERT_EQ(499, directory.GetType(6));
+    ASSERT_EQ(30, directory.GetSize(6));
+    ASSERT_TRUE(directory.IsReadable(7));
+    ASSERT_EQ(0, directory.GetType(7));
+    ASSERT_EQ(40, directory.GetSize(7));
+
+    // the 24127 circles file: 24608 objects in 17 bytes each
+    libopencad::CADFileLayout layout = libopencad::ReadCADFileLayout(
+        libopencad::MappedCADFileIO("data/r2000/24127_circles_128_lines.dwg"));
+    ASSERT_EQ(24608, layout.objects.GetCount());
+    ASSERT_EQ(17 * 24608, layout.objects.GetMemoryUsage());
+
+    size_t circlesCount = 0;
+    for (size_t idx = 0; idx < layout.objects.GetCount(); ++idx)
+    {
+        ASSERT_TRUE(layout.objects.IsReadable(idx));
+        ASSERT_EQ(idx, layout.objects.Find(layout.objects.GetHandle(idx)));
+        circlesCount += layout.objects.GetType(idx) == libopencad::CADObject::CIRCLE;
+    }
+    ASSERT_EQ(24127, circlesCount);
+}
+
+
+static void CopyFile(const char* from, const char* to)
+{
+    ByteArray data = ReadWholeFile(from);
+    std::ofstream file(to, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+
+TEST(sidecarindex, reopen)
+{
+    const char* drawingPath = "sidecar_test.dwg";
+    CopyFile("data/r2000/256_lwpolylines_7vertexes.dwg", drawingPath);
+    std::remove("sidecar_test.dwg.idx");
+
+    libopencad::CADOpenOptions options;
+    options.useSidecarIndex = true;
+
+    libopencad::CADFileReader plain(std::make_shared<libopencad::MappedCADFileIO>(drawingPath));
+    const libopencad::CADObjectDirectory& expected = plain.GetLayout().objects;
+    ASSERT_FALSE(plain.GetLayers().empty());
+    ASSERT_EQ("0", plain.GetLayers()[0].name);
+
+    libopencad::CADFileReader first(drawingPath, options);
+    ASSERT_FALSE(first.IsIndexLoaded());
+
+    // later opens map the index
+    libopencad::CADFileReader second(drawingPath, options);
+    ASSERT_TRUE(second.IsIndexLoaded());
+
+    const libopencad::CADObjectDirectory& objects = second.GetLayout().objects;
+    ASSERT_TRUE(objects.IsView());
+    ASSERT_EQ(plain.GetLayout().version, second.GetLayout().version);
+    ASSERT_EQ(plain.GetLayout().sections.size(), second.GetLayout().sections.size());
+    ASSERT_EQ(expected.GetCount(), objects.GetCount());
+    for (size_t idx = 0; idx < objects.GetCount(); ++idx)
+    {
+        ASSERT_EQ(expected.GetHandle(idx), objects.GetHandle(idx));
+        ASSERT_EQ(expected.GetOffset(idx), objects.GetOffset(idx));
+        ASSERT_EQ(expected.GetSize(idx), objects.GetSize(idx));
+        ASSERT_EQ(expected.GetTypeCode(idx), objects.GetTypeCode(idx));
+    }
+
+    uint8_t lwpolyline = libopencad::CADObject::LWPOLYLINE;
+    ASSERT_EQ(322, objects.GetTypeEnd(lwpolyline) - objects.GetTypeBegin(lwpolyline));
+    ASSERT_TRUE(std::equal(objects.GetTypeBegin(lwpolyline), objects.GetTypeEnd(lwpolyline),
+                           expected.GetTypeBegin(lwpolyline)));
+    ASSERT_EQ(objects.Find(objects.GetHandle(100)), 100);
+    ASSERT_EQ(plain.ReadObject(100).GetSize(), second.ReadObject(100).GetSize());
+
+    ASSERT_EQ(plain.GetLayers().size(), second.GetLayers().size());
+    for (size_t idx = 0; idx < plain.GetLayers().size(); ++idx)
+    {
+        ASSERT_EQ(plain.GetLayers()[idx].handle, second.GetLayers()[idx].handle);
+        ASSERT_EQ(plain.GetLayers()[idx].name, second.GetLayers()[idx].name);
+        ASSERT_EQ(plain.GetLayers()[idx].flags, second.GetLayers()[idx].flags);
+        ASSERT_EQ(plain.GetLayers()[idx].color, second.GetLayers()[idx].color);
+    }
+
+    // a changed drawing makes the index stale, it is rebuilt
+    ByteArray data = ReadWholeFile(drawingPath);
+    size_t objectMap = second.GetLayout().FindSection(libopencad::CADSectionNumber::OBJECT_MAP)->offset;
+    data[objectMap + 2] ^= 0x01;
+    {
+        std::ofstream file(drawingPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    libopencad::CADFileReader changed(drawingPath, options);
+    ASSERT_FALSE(changed.IsIndexLoaded());
+    ASSERT_TRUE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+
+    // so is a damaged index
+    ByteArray index = ReadWholeFile("sidecar_test.dwg.idx");
+    {
+        std::ofstream file("sidecar_test.dwg.idx", std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(index.data()), index.size() / 2);
+    }
+    ASSERT_FALSE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+    ASSERT_TRUE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+
+    // and one whose arrays are intact in size but not in contents
+    index = ReadWholeFile("sidecar_test.dwg.idx");
+    libopencad::CADFileReader indexed(drawingPath, options);
+    const uint8_t* handles = reinterpret_cast<const uint8_t*>(indexed.GetLayout().objects.GetHandles());
+    const uint8_t* typeEntries = reinterpret_cast<const uint8_t*>(indexed.GetLayout().objects.GetTypeEntries());
+    size_t handlesOffset = std::search(index.begin(), index.end(), handles, handles + 4 * sizeof(uint64_t)) -
+                           index.begin();
+    size_t typeEntriesOffset = std::search(index.begin(), index.end(), typeEntries,
+                                           typeEntries + 8 * sizeof(uint32_t)) - index.begin();
+    ASSERT_LT(handlesOffset, index.size());
+    ASSERT_LT(typeEntriesOffset, index.size());
+
+    for (size_t corruptedOffset : { handlesOffset, typeEntriesOffset })
+    {
+        ByteArray corrupted = index;
+        if (corruptedOffset == handlesOffset)
+            std::swap_ranges(corrupted.begin() + handlesOffset, corrupted.begin() + handlesOffset + 8,
+                             corrupted.begin() + handlesOffset + 8);
+        else
+            std::fill(corrupted.begin() + typeEntriesOffset, corrupted.begin() + typeEntriesOffset + 4, 0xFF);
+
+        {
+            std::ofstream file("sidecar_test.dwg.idx", std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(corrupted.data()), corrupted.size());
+        }
+        ASSERT_FALSE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+        ASSERT_TRUE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+    }
+
+    // concurrent writers of the same index never mix their files
+    libopencad::MappedCADFileIO drawing(drawingPath);
+    libopencad::CADFileStamp stamp;
+    ASSERT_TRUE(libopencad::GetCADFileStamp(drawingPath, drawing, stamp));
+    libopencad::CADFileLayout layout = libopencad::CADFileReader(drawingPath, options).GetLayout();
+    std::atomic<size_t> failedCount(0);
+    std::vector<std::thread> writers;
+    for (size_t threadIdx = 0; threadIdx < 4; ++threadIdx)
+    {
+        writers.push_back(std::thread([&]()
+        {
+            for (size_t writeIdx = 0; writeIdx < 20; ++writeIdx)
+                failedCount += !libopencad::WriteCADSidecarIndex("sidecar_test.dwg.idx", stamp, layout,
+                                                                 plain.GetLayers());
+        }));
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+
+    ASSERT_EQ(0, failedCount);
+    ASSERT_TRUE(libopencad::CADFileReader(drawingPath, options).IsIndexLoaded());
+
+    std::remove("sidecar_test.dwg.idx");
+    std::remove(drawingPath);
+}
+
+
+// Keeps the byte ranges read through it
+class RecordingFileIO : public libopencad::MemoryCADFileIO
+{
+public:
+    explicit RecordingFileIO(ByteArray&& buffer)
+        : libopencad::MemoryCADFileIO(std::move(buffer))
+    { }
+
+    using libopencad::MemoryCADFileIO::ReadAt;
+    virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        _ranges.push_back(libopencad::CADByteRange { offset, bytesCount });
+        return libopencad::MemoryCADFileIO::ReadAt(offset, buffer, bytesCount);
+    }
+
+    virtual const uint8_t* ViewAt(size_t, size_t) const
+    { return nullptr; }
+
+    const std::vector<libopencad::CADByteRange>& GetRanges() const
+    { return _ranges; }
+
+private:
+    mutable std::vector<libopencad::CADByteRange> _ranges;
+};
+
+
+TEST(filelayout, mergedreads)
+{
+    // object headers come from few large reads, not one read per object
+    RecordingFileIO fileIO(ReadWholeFile("data/r2000/24127_circles_128_lines.dwg"));
+    libopencad::CADFileLayout layout = libopencad::ReadCADFileLayout(fileIO);
+    libopencad::CADFileLayout expected = libopencad::ReadCADFileLayout(
+        libopencad::MappedCADFileIO("data/r2000/24127_circles_128_lines.dwg"));
+
+    ASSERT_EQ(24608, layout.objects.GetCount());
+    ASSERT_LT(fileIO.GetRanges().size(), 300);
+    for (size_t idx = 0; idx < layout.objects.GetCount(); ++idx)
+    {
+        ASSERT_EQ(expected.objects.GetHandle(idx), layout.objects.GetHandle(idx));
+        ASSERT_EQ(expected.objects.GetOffset(idx), layout.objects.GetOffset(idx));
+        ASSERT_EQ(expected.objects.GetSize(idx), layout.objects.GetSize(idx));
+        ASSERT_EQ(expected.objects.GetTypeCode(idx), layout.objects.GetTypeCode(idx));
+    }
+}
+
+
+TEST(filemetadata, read)
+{
+    const char* files[] = { "data/r2000/1arc.dwg", "data/r2000/24127_circles_128_lines.dwg",
+                            "data/r2000/256_lwpolylines_7vertexes.dwg", "data/r2000/4solids.dwg",
+                            "data/r2000/5rays_3xlines.dwg", "data/r2000/six_3dpolylines.dwg",
+                            "data/r2000/triple_circles.dwg" };
+
+    for (const char* file : files)
+    {
+        RecordingFileIO fileIO(ReadWholeFile(file));
+        libopencad::CADFileMetadata metadata = libopencad::ReadCADFileMetadata(fileIO);
+        libopencad::CADFileReader reader(std::make_shared<libopencad::MappedCADFileIO>(file));
+
+        ASSERT_EQ("AC1015", metadata.version);
+        ASSERT_TRUE(metadata.crcMismatches.empty()) << file;
+        ASSERT_FALSE(metadata.classes.empty());
+        ASSERT_EQ(500, metadata.classes[0].number);
+        ASSERT_EQ("AcDbDictionaryWithDefault", metadata.classes[0].cppClassName);
+        ASSERT_EQ(reader.GetLayers().size(), metadata.layers.size());
+        for (size_t idx = 0; idx < metadata.layers.size(); ++idx)
+        {
+            ASSERT_EQ(reader.GetLayers()[idx].handle, metadata.layers[idx].handle);
+            ASSERT_EQ(reader.GetLayers()[idx].name, metadata.layers[idx].name);
+        }
+        ASSERT_EQ(reader.GetLayout().objects.GetHandle(reader.GetObjectsCount() - 1) + 1,
+                  metadata.header.handleSeed);
+
+        // no object other than the layer table ones is read
+        const libopencad::CADObjectDirectory& objects = reader.GetLayout().objects;
+        for (const libopencad::CADByteRange& range : fileIO.GetRanges())
+        {
+            for (size_t idx = 0; idx < objects.GetCount(); ++idx)
+            {
+                if (objects.GetType(idx) == libopencad::CADObject::LAYER_CONTROL_OBJ ||
+                    objects.GetType(idx) == libopencad::CADObject::LAYER)
+                    continue;
+
+                size_t objectEnd = objects.GetDataOffset(idx) + objects.GetSize(idx) + 2;
+                ASSERT_TRUE(range.offset + range.size <= objects.GetOffset(idx) || range.offset >= objectEnd)
+                    << file << " reads object " << idx;
+            }
+        }
+    }
+
+    libopencad::CADFileMetadata metadata = libopencad::ReadCADFileMetadata(
+        libopencad::MappedCADFileIO("data/r2000/24127_circles_128_lines.dwg"));
+    ASSERT_EQ(29, metadata.codepage);
+    ASSERT_EQ(20, metadata.classes.size());
+    ASSERT_EQ(1, metadata.header.insertionUnits);
+    ASSERT_EQ(2, metadata.header.linearUnits);
+    ASSERT_NEAR(-133.4857569620483, metadata.header.extentsMin.x, 1e-9);
+    ASSERT_NEAR(1790.6567150622518, metadata.header.extentsMax.y, 1e-9);
+    ASSERT_EQ(1, metadata.layers.size());
+    ASSERT_EQ("0", metadata.layers[0].name);
+    ASSERT_EQ(metadata.layers[0].handle, metadata.header.currentLayer);
+
+    metadata = libopencad::ReadCADFileMetadata(libopencad::MappedCADFileIO("data/r2000/1arc.dwg"));
+    ASSERT_EQ(4, metadata.header.insertionUnits);
+    ASSERT_DOUBLE_EQ(50.0, metadata.header.extentsMin.x);
+    ASSERT_DOUBLE_EQ(75.0, metadata.header.extentsMax.y);
+    ASSERT_EQ(12, metadata.classes.size());
+}
+
+
+TEST(cadfile, lazylayers)
+{
+    libopencad::CADOpenOptions options;
+    options.geometryCacheSize = 64 * 1024;
+    libopencad::CADFile file("data/r2000/24127_circles_128_lines.dwg", options);
+    ASSERT_EQ(1, file.GetLayersCount());
+
+    // layers keep directory entries, nothing is decoded before it is asked for
+    libopencad::CADLayerPtr layer = file.GetLayer(0);
+    ASSERT_EQ("0", layer->GetName());
+    ASSERT_EQ(24127 + 128, layer->GetGeometryCount());
+    ASSERT_EQ(0, file.GetGeometryCacheStatistics().misses);
+
+    libopencad::CADGeometryPtr geometry = layer->GetGeometry(0);
+    ASSERT_NE(nullptr, geometry);
+    ASSERT_EQ(layer->GetGeometryHandle(0), geometry->GetHandle());
+    ASSERT_EQ(layer->GetGeometry(0), geometry);
+
+    size_t circlesCount = 0;
+    for (size_t idx = 0; idx < layer->GetGeometryCount(); ++idx)
+    {
+        libopencad::CADGeometryPtr entity = layer->GetGeometry(idx);
+        ASSERT_NE(nullptr, entity);
+        if (idx > 0)
+        {
+            ASSERT_LT(layer->GetGeometryHandle(idx - 1), entity->GetHandle());
+        }
+
+        auto circle = std::dynamic_pointer_cast<const libopencad::CADCircleGeometry>(entity);
+        if (circle)
+        {
+            ASSERT_GT(circle->GetData().radius, 0.0);
+            ++circlesCount;
+        }
+        else
+        {
+            ASSERT_EQ(libopencad::CADObject::LINE, entity->GetType());
+        }
+    }
+    ASSERT_EQ(24127, circlesCount);
+
+    libopencad::CADGeometryCacheStatistics statistics = file.GetGeometryCacheStatistics();
+    // the first geometry was decoded once and found twice
+    ASSERT_EQ(2, statistics.hits);
+    ASSERT_EQ(24127 + 128, statistics.misses);
+    ASSERT_GT(statistics.evictions, 0);
+    ASSERT_LE(statistics.bytesUsed, options.geometryCacheSize);
+
+    // without a cache every access decodes
+    libopencad::CADFile uncached("data/r2000/256_lwpolylines_7vertexes.dwg");
+    libopencad::CADLayerPtr polylines = uncached.GetLayer(0);
+    ASSERT_EQ(256, polylines->GetGeometryCount());
+    ASSERT_NE(polylines->GetGeometry(5), polylines->GetGeometry(5));
+    ASSERT_EQ(0, uncached.GetGeometryCacheStatistics().geometriesCount);
+    ASSERT_THROW(uncached.GetLayer(1), std::runtime_error);
+
+    // layers outlive their file
+    {
+        libopencad::CADFile circles("data/r2000/triple_circles.dwg");
+        layer = circles.GetLayer(0);
+    }
+    ASSERT_EQ(3, layer->GetGeometryCount());
+    for (size_t idx = 0; idx < layer->GetGeometryCount(); ++idx)
+        ASSERT_EQ(libopencad::CADObject::CIRCLE, layer->GetGeometry(idx)->GetType());
+
+    auto lwpolyline = std::dynamic_pointer_cast<const libopencad::CADLWPolylineGeometry>(polylines->GetGeometry(0));
+    ASSERT_NE(nullptr, lwpolyline);
+    ASSERT_EQ(7, lwpolyline->GetData().points.size());
+}
+
+
+// Fails every positional read once armed
+class FailingFileIO : public libopencad::MemoryCADFileIO
+{
+public:
+    explicit FailingFileIO(ByteArray&& buffer)
+        : libopencad::MemoryCADFileIO(std::move(buffer)),
+          _armed(false)
+    { }
+
+    using libopencad::MemoryCADFileIO::ReadAt;
+    virtual size_t ReadAt(size_t offset, void* buffer, size_t bytesCount) const
+    {
+        if (_armed)
+            throw std::runtime_error("FailingFileIO: read failed");
+        return libopencad::MemoryCADFileIO::ReadAt(offset, buffer, bytesCount);
+    }
+
+    virtual const uint8_t* ViewAt(size_t, size_t) const
+    { return nullptr; }
+
+    void Arm()
+    { _armed = true; }
+
+private:
+    std::atomic<bool>   _armed;
+};
+
+
+TEST(prefetcher, readerror)
+{
+    FailingFileIO fileIO(ReadWholeFile(TEST_FILE));
+    fileIO.Arm();
+
+    std::vector<libopencad::CADByteRange> ranges(10);
+    for (size_t idx = 0; idx < ranges.size(); ++idx)
+    {
+        ranges[idx].offset = idx * 16;
+        ranges[idx].size = 16;
+    }
+
+    // the worker's error is handed to the consumer, every later call sees it too
+    libopencad::CADPrefetcher prefetcher(fileIO, ranges, 2);
+    libopencad::CADByteRange range;
+    const ByteArray* data = nullptr;
+    ASSERT_THROW(prefetcher.Next(range, data), std::runtime_error);
+    ASSERT_THROW(prefetcher.Next(range, data), std::runtime_error);
+}
+
+
+TEST(filelayout, crcreaderrors)
+{
+    ByteArray data = ReadWholeFile(TEST_FILE);
+    libopencad::MemoryCADFileIO source(data.data(), data.size());
+    libopencad::CADFileLayout layout = libopencad::ReadCADFileLayout(source);
+    const libopencad::CADObjectDirectory& objects = layout.objects;
+
+    // objects running past the end of a truncated copy are unreadable, not read past
+    size_t truncatedSize = data.size() / 2;
+    RecordingFileIO truncated(ByteArray(data.begin(), data.begin() + truncatedSize));
+    size_t shortCount = 0;
+    for (size_t objectIdx = 0; objectIdx < objects.GetCount(); ++objectIdx)
+    {
+        size_t objectEnd = objects.GetDataOffset(objectIdx) + objects.GetSize(objectIdx) + 2;
+        if (objects.IsReadable(objectIdx) && objectEnd > truncatedSize)
+            ++shortCount;
+    }
+    ASSERT_LT(0, shortCount);
+
+    libopencad::CADObjectCrcValidator validator(truncated, objects, 2);
+    size_t unreadableCount = 0;
+    for (const libopencad::CADCrcMismatch& mismatch : validator.GetMismatches())
+    {
+        ASSERT_EQ(0, mismatch.range.size);
+        ++unreadableCount;
+    }
+    ASSERT_EQ(shortCount, unreadableCount);
+
+    // a read that throws comes out of GetMismatches()
+    FailingFileIO failing(std::move(data));
+    failing.Arm();
+    libopencad::CADObjectCrcValidator failed(failing, objects, 2);
+    ASSERT_THROW(failed.GetMismatches(), std::runtime_error);
+    ASSERT_THROW(failed.GetMismatches(), std::runtime_error);
+}
+
+
+TEST(cadfile, paralleldecode)
+{
+    libopencad::CADFile file("data/r2000/24127_circles_128_lines.dwg");
+    libopencad::CADLayerPtr layer = file.GetLayer(0);
+
+    // the same geometries in the same order whatever the count of threads
+    std::vector<libopencad::CADGeometryPtr> expected = layer->GetGeometries(1);
+    ASSERT_EQ(layer->GetGeometryCount(), expected.size());
+    for (size_t threadsCount : { 2, 3, 8, 0 })
+    {
+        std::vector<libopencad::CADGeometryPtr> geometries = layer->GetGeometries(threadsCount);
+        ASSERT_EQ(expected.size(), geometries.size());
+        for (size_t idx = 0; idx < geometries.size(); ++idx)
+        {
+            ASSERT_NE(nullptr, geometries[idx]);
+            ASSERT_EQ(layer->GetGeometryHandle(idx), geometries[idx]->GetHandle());
+            ASSERT_EQ(expected[idx]->GetType(), geometries[idx]->GetType());
+
+            auto circle = std::dynamic_pointer_cast<const libopencad::CADCircleGeometry>(geometries[idx]);
+            if (circle)
+            {
+                auto expectedCircle = std::static_pointer_cast<const libopencad::CADCircleGeometry>(expected[idx]);
+                ASSERT_EQ(expectedCircle->GetData().radius, circle->GetData().radius);
+            }
+        }
+    }
+
+    // objects read through the per-thread scratch buffers
+    std::shared_ptr<FailingFileIO> fileIO = std::make_shared<FailingFileIO>(
+        ReadWholeFile("data/r2000/256_lwpolylines_7vertexes.dwg"));
+    libopencad::CADFile polylines(fileIO);
+    libopencad::CADLayerPtr polylinesLayer = polylines.GetLayer(0);
+    std::vector<libopencad::CADGeometryPtr> geometries = polylinesLayer->GetGeometries(4);
+    ASSERT_EQ(256, geometries.size());
+    for (const libopencad::CADGeometryPtr& geometry : geometries)
+    {
+        auto lwpolyline = std::dynamic_pointer_cast<const libopencad::CADLWPolylineGeometry>(geometry);
+        ASSERT_NE(nullptr, lwpolyline);
+        ASSERT_EQ(7, lwpolyline->GetData().points.size());
+    }
+
+    // I/O errors reach the caller once every thread stopped
+    fileIO->Arm();
+    ASSERT_THROW(polylinesLayer->GetGeometries(4), std::runtime_error);
+}
+
+
+TEST(cadfile, visitentities)
+{
+    libopencad::CADFile file("data/r2000/24127_circles_128_lines.dwg");
+    const libopencad::CADObjectDirectory& objects = file.GetReader().GetLayout().objects;
+
+    // every model space entity once, in file order
+    std::vector<uint64_t> handles;
+    size_t lastOffset = 0;
+    libopencad::CADVisitStatistics statistics = file.VisitEntities(
+        [&](const libopencad::CADLayerData& layer, const libopencad::CADGeometry& geometry)
+        {
+            ASSERT_EQ("0", layer.name);
+            size_t offset = objects.GetOffset(objects.Find(geometry.GetHandle()));
+            ASSERT_LT(lastOffset, offset);
+            lastOffset = offset;
+            handles.push_back(geometry.GetHandle());
+        });
+    ASSERT_EQ(24127 + 128, statistics.visitedCount);
+    ASSERT_EQ(0, statistics.damagedCount);
+
+    libopencad::CADLayerPtr layer = file.GetLayer(0);
+    std::sort(handles.begin(), handles.end());
+    ASSERT_EQ(layer->GetGeometryCount(), handles.size());
+    for (size_t idx = 0; idx < handles.size(); ++idx)
+        ASSERT_EQ(layer->GetGeometryHandle(idx), handles[idx]);
+
+    // chunked memory lends most objects, the ones across two chunks are read
+    ByteArray data = ReadWholeFile("data/r2000/24127_circles_128_lines.dwg");
+    std::vector<libopencad::MemoryCADFileIO::Chunk> chunks;
+    for (size_t offset = 0; offset < data.size(); offset += 4096)
+    {
+        libopencad::MemoryCADFileIO::Chunk chunk = { data.data() + offset,
+                                                     std::min<size_t>(4096, data.size() - offset) };
+        chunks.push_back(chunk);
+    }
+
+    libopencad::CADFile chunked(std::make_shared<libopencad::MemoryCADFileIO>(chunks));
+    statistics = chunked.VisitEntities([](const libopencad::CADLayerData&, const libopencad::CADGeometry&) { });
+    ASSERT_EQ(24127 + 128, statistics.visitedCount);
+    ASSERT_EQ(0, statistics.damagedCount);
+
+    // files which can not lend their memory are read sequentially in few large reads
+    std::shared_ptr<RecordingFileIO> fileIO = std::make_shared<RecordingFileIO>(
+        ReadWholeFile("data/r2000/256_lwpolylines_7vertexes.dwg"));
+    libopencad::CADFile polylines(fileIO);
+    size_t openReadsCount = fileIO->GetRanges().size();
+
+    size_t pointsCount = 0;
+    statistics = polylines.VisitEntities(
+        [&](const libopencad::CADLayerData&, const libopencad::CADGeometry& geometry)
+        {
+            auto lwpolyline = dynamic_cast<const libopencad::CADLWPolylineGeometry*>(&geometry);
+            ASSERT_NE(nullptr, lwpolyline);
+            pointsCount += lwpolyline->GetData().points.size();
+        });
+    ASSERT_EQ(256, statistics.visitedCount);
+    ASSERT_EQ(256 * 7, pointsCount);
+
+    const std::vector<libopencad::CADByteRange>& ranges = fileIO->GetRanges();
+    ASSERT_GT(ranges.size(), openReadsCount);
+    ASSERT_LE(ranges.size() - openReadsCount, 2);
+    for (size_t idx = openReadsCount + 1; idx < ranges.size(); ++idx)
+        ASSERT_LE(ranges[idx - 1].offset + ranges[idx - 1].size, ranges[idx].offset);
+
+    // read errors of the read-ahead thread reach the caller
+    std::shared_ptr<FailingFileIO> failingIO = std::make_shared<FailingFileIO>(
+        ReadWholeFile("data/r2000/256_lwpolylines_7vertexes.dwg"));
+    libopencad::CADFile failing(failingIO);
+    failingIO->Arm();
+    ASSERT_THROW(failing.VisitEntities([](const libopencad::CADLayerData&, const libopencad::CADGeometry&) { }),
+                 std::runtime_error);
+}
+
+
+TEST(cadfile, readfilter)
+{
+    libopencad::CADFile file("data/r2000/24127_circles_128_lines.dwg");
+    const libopencad::CADObjectDirectory& objects = file.GetReader().GetLayout().objects;
+    auto visitor = [](const libopencad::CADLayerData&, const libopencad::CADGeometry& geometry)
+    { ASSERT_EQ(libopencad::CADObject::LINE, geometry.GetType()); };
+
+    // left out types are never read, the color is tested on the remaining ones only
+    size_t colorsCount = 0;
+    libopencad::CADReadFilter filter;
+    filter.types = { libopencad::CADObject::LINE, libopencad::CADObject::LWPOLYLINE };
+    filter.color = [&colorsCount](int16_t color) { ++colorsCount; return color == 256; };
+    libopencad::CADVisitStatistics statistics = file.VisitEntities(visitor, filter);
+    ASSERT_EQ(128, statistics.visitedCount);
+    ASSERT_EQ(128, colorsCount);
+    ASSERT_EQ(24127, statistics.filteredCount);
+
+    size_t circlesBytes = 0;
+    for (const uint32_t* objectIdx = objects.GetTypeBegin(libopencad::CADObject::CIRCLE);
+         objectIdx != objects.GetTypeEnd(libopencad::CADObject::CIRCLE); ++objectIdx)
+        circlesBytes += objects.GetSize(*objectIdx);
+    ASSERT_EQ(circlesBytes, statistics.filteredBytes);
+
+    // all entities are BYLAYER
+    filter.color = [](int16_t color) { return color != 256; };
+    statistics = file.VisitEntities(visitor, filter);
+    ASSERT_EQ(0, statistics.visitedCount);
+    ASSERT_EQ(24127 + 128, statistics.filteredCount);
+
+    // layers
+    uint64_t layerHandle = file.GetReader().GetLayers()[0].handle;
+    libopencad::CADReadFilter layerFilter;
+    layerFilter.layers = { layerHandle + 1 };
+    statistics = file.VisitEntities(visitor, layerFilter);
+    ASSERT_EQ(0, statistics.visitedCount);
+    ASSERT_EQ(24127 + 128, statistics.filteredCount);
+    ASSERT_EQ(0, statistics.damagedCount);
+
+    size_t circlesCount = 0;
+    layerFilter.layers.push_back(layerHandle);
+    statistics = file.VisitEntities(
+        [&circlesCount](const libopencad::CADLayerData& layer, const libopencad::CADGeometry& geometry)
+        {
+            ASSERT_EQ("0", layer.name);
+            auto circle = dynamic_cast<const libopencad::CADCircleGeometry*>(&geometry);
+            if (circle)
+            {
+                ASSERT_GT(circle->GetData().radius, 0.0);
+                ++circlesCount;
+            }
+        }, layerFilter);
+    ASSERT_EQ(24127 + 128, statistics.visitedCount);
+    ASSERT_EQ(24127, circlesCount);
+    ASSERT_EQ(0, statistics.filteredCount);
+}
+
+
+TEST(spatialindex, pack)
+{
+    std::mt19937 random(17);
+    std::uniform_real_distribution<double> coordinate(-1000.0, 1000.0);
+    std::uniform_real_distribution<double> extent(0.0, 20.0);
+
+    std::vector<uint64_t> handles;
+    std::vector<libopencad::CADBoundingBox> boxes;
+    for (uint64_t handle = 1; handle <= 5000; ++handle)
+    {
+        libopencad::CADBoundingBox box;
+        box.Extend(coordinate(random), coordinate(random));
+        box.Extend(box.minX + extent(random), box.minY + extent(random));
+        handles.push_back(handle * 3);
+        boxes.push_back(box);
+    }
+
+    std::vector<libopencad::CADBoundingBox> expectedBoxes = boxes;
+    libopencad::CADSpatialIndex index = libopencad::CADSpatialIndex::Pack(std::vector<uint64_t>(handles),
+                                                                          std::move(boxes));
+    ASSERT_EQ(5000, index.GetEntriesCount());
+    ASSERT_LE(-1000.0, index.GetBounds().minX);
+    ASSERT_GE(1020.0, index.GetBounds().maxX);
+
+    // same candidates as testing every box
+    for (size_t queryIdx = 0; queryIdx < 200; ++queryIdx)
+    {
+        libopencad::CADBoundingBox window;
+        window.Extend(coordinate(random), coordinate(random));
+        window.Extend(window.minX + extent(random) * 10.0, window.minY + extent(random) * 10.0);
+
+        std::vector<uint64_t> expected;
+        for (size_t idx = 0; idx < handles.size(); ++idx)
+        {
+            if (expectedBoxes[idx].Intersects(window))
+                expected.push_back(handles[idx]);
+        }
+
+        ASSERT_EQ(expected, index.Query(window));
+    }
+
+    libopencad::CADBoundingBox everything;
+    everything.Extend(-2000.0, -2000.0);
+    everything.Extend(2000.0, 2000.0);
+    ASSERT_EQ(5000, index.Query(everything).size());
+    ASSERT_TRUE(index.Query(libopencad::CADBoundingBox()).empty());
+
+    // raw arrays round trip, broken trees are rejected
+    libopencad::CADSpatialIndex copy(std::vector<uint64_t>(index.GetHandles()),
+                                     std::vector<libopencad::CADBoundingBox>(index.GetBoxes()),
+                                     std::vector<libopencad::CADSpatialNode>(index.GetNodes()));
+    ASSERT_EQ(index.Query(everything), copy.Query(everything));
+
+    std::vector<libopencad::CADSpatialNode> nodes = index.GetNodes();
+    nodes.back().firstChild = static_cast<uint32_t>(index.GetBoxes().size());
+    ASSERT_THROW(libopencad::CADSpatialIndex(std::vector<uint64_t>(index.GetHandles()),
+                                             std::vector<libopencad::CADBoundingBox>(index.GetBoxes()),
+                                             std::move(nodes)), std::runtime_error);
+
+    libopencad::CADSpatialIndex empty;
+    ASSERT_TRUE(empty.Query(everything).empty());
+    ASSERT_TRUE(empty.GetBounds().IsEmpty());
+}
+
+
+// Replaces the first run of bytes equal to from, starting at any bit, with to
+static bool ReplaceBits(uint8_t* data, size_t size, const ByteArray& from, const ByteArray& to)
+{
+    const size_t bitsCount = from.size() * 8;
+    for (size_t start = 0; start + bitsCount <= size * 8; ++start)
+    {
+        size_t bitIdx = 0;
+        while (bitIdx < bitsCount)
+        {
+            size_t position = start + bitIdx;
+            bool bit = (data[position / 8] >> (7 - position % 8)) & 1;
+            if (bit != (((from[bitIdx / 8] >> (7 - bitIdx % 8)) & 1) != 0))
+                break;
+            ++bitIdx;
+        }
+        if (bitIdx < bitsCount)
+            continue;
+
+        for (bitIdx = 0; bitIdx < bitsCount; ++bitIdx)
+        {
+            size_t position = start + bitIdx;
+            uint8_t mask = static_cast<uint8_t>(0x80 >> (position % 8));
+            if ((to[bitIdx / 8] >> (7 - bitIdx % 8)) & 1)
+                data[position / 8] |= mask;
+            else
+                data[position / 8] &= static_cast<uint8_t>(~mask);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+
+TEST(spatialindex, nanradius)
+{
+    // the circle of radius 16.6 gets a NaN one, which reads without error
+    ByteArray data = ReadWholeFile(TEST_FILE);
+    libopencad::MemoryCADFileIO source(data.data(), data.size());
+    libopencad::CADFileLayout layout = libopencad::ReadCADFileLayout(source);
+    size_t objectIdx = layout.objects.Find(0x1FF);
+    ASSERT_NE(libopencad::CADObjectDirectory::NPOS, objectIdx);
+
+    double radius = 16.6;
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    ByteArray from(sizeof(double));
+    ByteArray to(sizeof(double));
+    std::memcpy(from.data(), &radius, sizeof(double));
+    std::memcpy(to.data(), &nan, sizeof(double));
+    ASSERT_TRUE(ReplaceBits(data.data() + layout.objects.GetDataOffset(objectIdx),
+                            layout.objects.GetSize(objectIdx), from, to));
+
+    libopencad::CADFile file(std::make_shared<libopencad::MemoryCADFileIO>(std::move(data)));
+    auto circle = std::dynamic_pointer_cast<const libopencad::CADCircleGeometry>(file.GetGeometry(0x1FF));
+    ASSERT_NE(nullptr, circle);
+    ASSERT_TRUE(std::isnan(circle->GetData().radius));
+
+    // the entity is left out of the index, the others are packed around it
+    const libopencad::CADSpatialIndex& index = file.GetSpatialIndex();
+    ASSERT_EQ(2, index.GetEntriesCount());
+    ASSERT_EQ(std::vector<uint64_t>({ 0x200, 0x201 }), index.Query(index.GetBounds()));
+    ASSERT_TRUE(std::isfinite(index.GetBounds().minX));
+}
+
+
+TEST(spatialindex, drawing)
+{
+    const char* drawingPath = "spatial_test.dwg";
+    CopyFile("data/r2000/24127_circles_128_lines.dwg", drawingPath);
+    std::remove("spatial_test.dwg.rtree");
+
+    libopencad::CADOpenOptions options;
+    options.useSidecarIndex = true;
+    libopencad::CADFile file(drawingPath, options);
+    const libopencad::CADSpatialIndex& index = file.GetSpatialIndex();
+    ASSERT_FALSE(file.IsSpatialIndexLoaded());
+    ASSERT_EQ(24127 + 128, index.GetEntriesCount());
+
+    // boxes from the projected fields match the full geometries
+    const std::vector<uint64_t>& handles = index.GetHandles();
+    for (size_t idx = 0; idx < handles.size(); ++idx)
+    {
+        const libopencad::CADBoundingBox& box = index.GetBoxes()[idx];
+        libopencad::CADGeometryPtr geometry = file.GetGeometry(handles[idx]);
+        ASSERT_NE(nullptr, geometry);
+
+        auto circle = std::dynamic_pointer_cast<const libopencad::CADCircleGeometry>(geometry);
+        if (circle)
+        {
+            const libopencad::CADCircleData& data = circle->GetData();
+            ASSERT_EQ(data.center.x - data.radius, box.minX);
+            ASSERT_EQ(data.center.y + data.radius, box.maxY);
+            continue;
+        }
+
+        auto line = std::dynamic_pointer_cast<const libopencad::CADLineGeometry>(geometry);
+        ASSERT_NE(nullptr, line);
+        ASSERT_EQ(std::min(line->GetData().start.x, line->GetData().end.x), box.minX);
+        ASSERT_EQ(std::max(line->GetData().start.y, line->GetData().end.y), box.maxY);
+    }
+
+    // a window around one entity finds it among few candidates
+    libopencad::CADBoundingBox window = index.GetBoxes()[100];
+    std::vector<uint64_t> candidates = index.Query(window);
+    ASSERT_TRUE(std::binary_search(candidates.begin(), candidates.end(), handles[100]));
+    ASSERT_LT(candidates.size(), handles.size());
+    ASSERT_EQ(handles.size(), index.Query(index.GetBounds()).size());
+    ASSERT_EQ(nullptr, file.GetGeometry(file.GetReader().GetLayers()[0].handle));
+
+    // the packing does not depend on the count of threads
+    libopencad::CADSpatialIndex single = libopencad::BuildCADSpatialIndex(file.GetReader(), 1);
+    libopencad::CADSpatialIndex parallel = libopencad::BuildCADSpatialIndex(file.GetReader(), 4);
+    ASSERT_EQ(single.GetHandles(), parallel.GetHandles());
+    ASSERT_EQ(single.GetNodes().size(), parallel.GetNodes().size());
+    ASSERT_EQ(0, std::memcmp(single.GetBoxes().data(), parallel.GetBoxes().data(),
+                             single.GetBoxes().size() * sizeof(libopencad::CADBoundingBox)));
+
+    // later opens load the index stored next to the drawing
+    libopencad::CADFile reopened(drawingPath, options);
+    ASSERT_EQ(candidates, reopened.GetSpatialIndex().Query(window));
+    ASSERT_TRUE(reopened.IsSpatialIndexLoaded());
+
+    // lwpolyline boxes cover their vertices
+    libopencad::CADFile polylines("data/r2000/256_lwpolylines_7vertexes.dwg");
+    const libopencad::CADSpatialIndex& polylinesIndex = polylines.GetSpatialIndex();
+    ASSERT_EQ(256, polylinesIndex.GetEntriesCount());
+    for (size_t idx = 0; idx < polylinesIndex.GetEntriesCount(); ++idx)
+    {
+        auto lwpolyline = std::dynamic_pointer_cast<const libopencad::CADLWPolylineGeometry>(
+            polylines.GetGeometry(polylinesIndex.GetHandles()[idx]));
+        ASSERT_NE(nullptr, lwpolyline);
+        for (const libopencad::CADPoint2D& point : lwpolyline->GetData().points)
+        {
+            libopencad::CADBoundingBox vertex;
+            vertex.Extend(point.x, point.y);
+            ASSERT_TRUE(polylinesIndex.GetBoxes()[idx].Intersects(vertex));
+        }
+    }
+
+    // arc boxes stop at the quadrant points the arc passes through
+    libopencad::CADFile arc("data/r2000/1arc.dwg");
+    const libopencad::CADSpatialIndex& arcIndex = arc.GetSpatialIndex();
+    ASSERT_EQ(1, arcIndex.GetEntriesCount());
+    const libopencad::CADBoundingBox& arcBox = arcIndex.GetBoxes()[0];
+    ASSERT_NEAR(50.0, arcBox.minX, 1e-9);
+    ASSERT_NEAR(50.0, arcBox.minY, 1e-9);
+    ASSERT_NEAR(100.0, arcBox.maxX, 1e-9);
+    ASSERT_NEAR(75.0, arcBox.maxY, 1e-9);
+
+    auto arcGeometry = std::dynamic_pointer_cast<const libopencad::CADArcGeometry>(
+        arc.GetGeometry(arcIndex.GetHandles()[0]));
+    ASSERT_NE(nullptr, arcGeometry);
+    const libopencad::CADArcData& arcData = arcGeometry->GetData();
+    for (size_t step = 0; step <= 16; ++step)
+    {
+        double angle = arcData.startAngle + (arcData.endAngle - arcData.startAngle) * step / 16.0;
+        libopencad::CADBoundingBox point;
+        point.Extend(arcData.center.x + arcData.radius * std::cos(angle),
+                     arcData.center.y + arcData.radius * std::sin(angle));
+        point.Inflate(1e-9);
+        ASSERT_TRUE(arcBox.Intersects(point));
+    }
+
+    std::remove("spatial_test.dwg.rtree");
+    std::remove("spatial_test.dwg.idx");
+    std::remove(drawingPath);
+}
@@ -1,6 +1,11 @@
 #include "gtest/gtest.h"
+#include "internal/io/cadbitkernels.hpp"
 #include "internal/io/cadbitstreamreader.hpp"
 
+#include <cmath>
+#include <cstring>
+#include <random>
+
 #define TESTS_ITERATIONS 10000
 
 TEST(singlebit, all)
@@ -268,4 +273,645 @@ TEST(modularshort, all)
         libopencad::CADBitStreamReader reader(buffer);
         ASSERT_EQ(4650033, reader.ReadMShort());
     }
-}
\ No newline at end of file
+}
+
+
+TEST(modularchar, bulk)
+{
+    // same stream as modularchar.all, shifted by 3 bits
+    std::vector<unsigned char> buffer(9);
+    buffer[0] = 0b00010000;
+    buffer[1] = 0b01000100;
+    buffer[2] = 0b10011101;
+    buffer[3] = 0b00110010;
+    buffer[4] = 0b11111100;
+    buffer[5] = 0b11000110;
+    buffer[6] = 0b10110000;
+    buffer[7] = 0b10101001;
+    buffer[8] = 0b01100000;
+
+    int32_t values[3];
+    libopencad::CADBitStreamReader reader(buffer, 3);
+    reader.ReadMChars(values, 3);
+    ASSERT_EQ(4610, values[0]);
+    ASSERT_EQ(112823273, values[1]);
+    ASSERT_EQ(-1413, values[2]);
+    ASSERT_EQ(67, reader.GetOffset());
+    ASSERT_THROW(reader.ReadMChars(values, 1), std::runtime_error);
+}
+
+
+TEST(modularshort, bulk)
+{
+    // modularshort.all stream followed by a single word value 1
+    std::vector<unsigned char> buffer(6);
+    buffer[0] = 0b00110001;
+    buffer[1] = 0b11110100;
+    buffer[2] = 0b10001101;
+    buffer[3] = 0b00000000;
+    buffer[4] = 0b00000001;
+    buffer[5] = 0b00000000;
+
+    uint32_t values[2];
+    libopencad::CADBitStreamReader reader(buffer);
+    reader.ReadMShorts(values, 2);
+    ASSERT_EQ(4650033, values[0]);
+    ASSERT_EQ(1, values[1]);
+    ASSERT_EQ(48, reader.GetOffset());
+    ASSERT_THROW(reader.ReadMShorts(values, 1), std::runtime_error);
+}
+
+TEST(viewreader, all)
+{
+    for (size_t idx = 0; idx < TESTS_ITERATIONS; ++idx)
+    {
+        // stream: 00110000 11000011 11 (bitshort 4035), reader does not copy the bytes
+        unsigned char buffer[3];
+        buffer[0] = 0b00110000;
+        buffer[1] = 0b11000011;
+        buffer[2] = 0b11000000;
+
+        libopencad::CADBitStreamReader reader(buffer, sizeof(buffer));
+        ASSERT_EQ(buffer, reader.GetData());
+        ASSERT_EQ(4035, reader.ReadBitShort());
+
+        reader.SetOffset(2);
+        ASSERT_EQ(1, reader.ReadBit());
+        ASSERT_THROW(reader.SetOffset(25), std::runtime_error);
+    }
+}
+
+
+TEST(subreader, all)
+{
+    for (size_t idx = 0; idx < TESTS_ITERATIONS; ++idx)
+    {
+        // stream: 11111011 00000000 | 11000111 11111010 | 11111011 00001001
+        // contains: 251, -1337, 2555 as raw shorts, one per slice
+        std::vector<unsigned char> buffer(6);
+        buffer[0] = 0b11111011;
+        buffer[1] = 0b00000000;
+        buffer[2] = 0b11000111;
+        buffer[3] = 0b11111010;
+        buffer[4] = 0b11111011;
+        buffer[5] = 0b00001001;
+
+        libopencad::CADBitStreamReader reader(buffer);
+        libopencad::CADBitStreamReader second = reader.SubReader(2, 2);
+        libopencad::CADBitStreamReader third = reader.SubReader(4, 2);
+        ASSERT_EQ(reader.GetData() + 2, second.GetData());
+
+        // sub-readers keep the owned buffer alive
+        reader = libopencad::CADBitStreamReader(buffer, 16);
+
+        ASSERT_EQ(-1337, second.ReadRawShort());
+        ASSERT_EQ(2555, third.ReadRawShort());
+        ASSERT_EQ(-1337, reader.ReadRawShort());
+        ASSERT_THROW(second.ReadBit(), std::runtime_error);
+        ASSERT_THROW(reader.SubReader(4, 3), std::runtime_error);
+    }
+}
+
+
+// Reference decoders built from the plain fixed width reads
+static int16_t ReferenceBitShort(libopencad::CADBitStreamReader& reader)
+{
+    switch (reader.Read2Bits())
+    {
+    case 0: return reader.ReadRawShort();
+    case 1: return reader.ReadChar();
+    case 2: return 0;
+    default: return 256;
+    }
+}
+
+
+static int32_t ReferenceBitLong(libopencad::CADBitStreamReader& reader)
+{
+    switch (reader.Read2Bits())
+    {
+    case 0: return reader.ReadRawLong();
+    case 1: return reader.ReadChar();
+    default: return 0;
+    }
+}
+
+
+static double ReferenceBitDouble(libopencad::CADBitStreamReader& reader)
+{
+    switch (reader.Read2Bits())
+    {
+    case 0: return reader.ReadRawDouble();
+    case 1: return 1.0;
+    default: return 0.0;
+    }
+}
+
+
+static double ReferenceBitDoubleWd(libopencad::CADBitStreamReader& reader, double defaultValue)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &defaultValue, sizeof(bits));
+
+    switch (reader.Read2Bits())
+    {
+    case 0:
+        return defaultValue;
+    case 1:
+        bits = (bits & 0xFFFFFFFF00000000ULL) | static_cast<uint32_t>(reader.ReadRawLong());
+        break;
+    case 2:
+    {
+        uint64_t low = static_cast<uint32_t>(reader.ReadRawLong());
+        uint64_t high = static_cast<uint16_t>(reader.ReadRawShort());
+        bits = (bits & 0xFFFF000000000000ULL) | (high << 32) | low;
+        break;
+    }
+    default:
+        return reader.ReadRawDouble();
+    }
+
+    std::memcpy(&defaultValue, &bits, sizeof(bits));
+    return defaultValue;
+}
+
+
+static int32_t ReferenceMChar(libopencad::CADBitStreamReader& reader)
+{
+    int64_t result = 0;
+
+    for (size_t idx = 0; idx < 8; ++idx)
+    {
+        uint8_t byte = reader.ReadChar();
+
+        if (!(byte & 0x80))
+        {
+            result |= static_cast<int64_t>(byte & 0x3F) << (idx * 7);
+            if (byte & 0x40)
+                result = -result;
+            break;
+        }
+
+        result |= static_cast<int64_t>(byte & 0x7F) << (idx * 7);
+    }
+
+    return static_cast<int32_t>(result);
+}
+
+
+static uint32_t ReferenceMShort(libopencad::CADBitStreamReader& reader)
+{
+    uint32_t result = static_cast<uint16_t>(reader.ReadRawShort());
+
+    if (result & 0x8000)
+        result = (result & 0x7FFF) | ((static_cast<uint16_t>(reader.ReadRawShort()) & 0x7FFF) << 15);
+
+    return result;
+}
+
+
+// Bit for bit, random doubles include NaNs. Empty vectors may have no data to compare.
+static bool SameDoubleBits(const std::vector<double>& expected, const std::vector<double>& values)
+{
+    return expected.size() == values.size() &&
+           (values.empty() || std::memcmp(expected.data(), values.data(), values.size() * sizeof(double)) == 0);
+}
+
+
+static void CheckBitKernels(const libopencad::CADBitKernels& kernels)
+{
+    std::mt19937 random(1337);
+
+    for (size_t idx = 0; idx < 200; ++idx)
+    {
+        std::vector<unsigned char> buffer(1 + random() % 300);
+        for (size_t byteIdx = 0; byteIdx < buffer.size(); ++byteIdx)
+            buffer[byteIdx] = static_cast<unsigned char>(random());
+
+        const size_t count = buffer.size() * 8;
+        const size_t startOffset = random() % 8;
+
+        // reference values until the buffer runs out
+        std::vector<int16_t> expectedShorts;
+        std::vector<int32_t> expectedLongs;
+        std::vector<double> expectedDoubles;
+        std::vector<double> expectedRawDoubles;
+        std::vector<double> expectedWdDoubles;
+        std::vector<int32_t> expectedMChars;
+        std::vector<uint32_t> expectedMShorts;
+        std::vector<uint8_t> expected2Bits;
+        std::vector<uint8_t> expected3Bits;
+        size_t mcharsEnd = startOffset;
+        size_t mshortsEnd = startOffset;
+        size_t shortsEnd = startOffset;
+        size_t longsEnd = startOffset;
+        size_t doublesEnd = startOffset;
+        size_t wdDoublesEnd = startOffset;
+
+        std::vector<double> defaults(count);
+        for (size_t valueIdx = 0; valueIdx < count; ++valueIdx)
+            defaults[valueIdx] = static_cast<double>(random()) / 7.0;
+
+        libopencad::CADBitStreamReader reader(buffer, startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedShorts.push_back(ReferenceBitShort(reader));
+                shortsEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedLongs.push_back(ReferenceBitLong(reader));
+                longsEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedDoubles.push_back(ReferenceBitDouble(reader));
+                doublesEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedWdDoubles.push_back(ReferenceBitDoubleWd(reader, defaults[expectedWdDoubles.size()]));
+                wdDoublesEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedMChars.push_back(ReferenceMChar(reader));
+                mcharsEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        try
+        {
+            while (true)
+            {
+                expectedMShorts.push_back(ReferenceMShort(reader));
+                mshortsEnd = reader.GetOffset();
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        reader.SetOffset(startOffset);
+        while (reader.GetOffset() + 64 <= count)
+            expectedRawDoubles.push_back(reader.ReadRawDouble());
+
+        reader.SetOffset(startOffset);
+        while (reader.GetOffset() + 2 <= count)
+            expected2Bits.push_back(reader.Read2Bits());
+
+        reader.SetOffset(startOffset);
+        while (reader.GetOffset() + 3 <= count)
+            expected3Bits.push_back(reader.Read3Bits());
+
+        std::vector<int16_t> shorts(count);
+        size_t offset = startOffset;
+        shorts.resize(kernels.readBitShorts(buffer.data(), buffer.size(), offset, shorts.data(), count));
+        ASSERT_EQ(expectedShorts, shorts);
+        ASSERT_EQ(shortsEnd, offset);
+
+        std::vector<int32_t> longs(count);
+        offset = startOffset;
+        longs.resize(kernels.readBitLongs(buffer.data(), buffer.size(), offset, longs.data(), count));
+        ASSERT_EQ(expectedLongs, longs);
+        ASSERT_EQ(longsEnd, offset);
+
+        std::vector<double> doubles(count);
+        offset = startOffset;
+        doubles.resize(kernels.readBitDoubles(buffer.data(), buffer.size(), offset, doubles.data(), count));
+        ASSERT_EQ(expectedDoubles.size(), doubles.size());
+        ASSERT_TRUE(SameDoubleBits(expectedDoubles, doubles));
+        ASSERT_EQ(doublesEnd, offset);
+
+        doubles.resize(count);
+        offset = startOffset;
+        doubles.resize(kernels.readBitDoublesWd(buffer.data(), buffer.size(), offset, defaults.data(),
+                                                doubles.data(), count));
+        ASSERT_EQ(expectedWdDoubles.size(), doubles.size());
+        ASSERT_TRUE(SameDoubleBits(expectedWdDoubles, doubles));
+        ASSERT_EQ(wdDoublesEnd, offset);
+
+        doubles.resize(count);
+        offset = startOffset;
+        doubles.resize(kernels.readRawDoubles(buffer.data(), buffer.size(), offset, doubles.data(), count));
+        ASSERT_EQ(expectedRawDoubles.size(), doubles.size());
+        ASSERT_TRUE(SameDoubleBits(expectedRawDoubles, doubles));
+        ASSERT_EQ(startOffset + doubles.size() * 64, offset);
+
+        std::vector<int32_t> mchars(count);
+        offset = startOffset;
+        mchars.resize(kernels.readMChars(buffer.data(), buffer.size(), offset, mchars.data(), count));
+        ASSERT_EQ(expectedMChars, mchars);
+        ASSERT_EQ(mcharsEnd, offset);
+
+        std::vector<uint32_t> mshorts(count);
+        offset = startOffset;
+        mshorts.resize(kernels.readMShorts(buffer.data(), buffer.size(), offset, mshorts.data(), count));
+        ASSERT_EQ(expectedMShorts, mshorts);
+        ASSERT_EQ(mshortsEnd, offset);
+
+        std::vector<uint8_t> fields(count);
+        offset = startOffset;
+        fields.resize(kernels.read2Bits(buffer.data(), buffer.size(), offset, fields.data(), count));
+        ASSERT_EQ(expected2Bits, fields);
+
+        fields.resize(count);
+        offset = startOffset;
+        fields.resize(kernels.read3Bits(buffer.data(), buffer.size(), offset, fields.data(), count));
+        ASSERT_EQ(expected3Bits, fields);
+    }
+}
+
+
+TEST(bitkernels, portable)
+{
+    CheckBitKernels(libopencad::GetPortableCADBitKernels());
+}
+
+
+TEST(bitkernels, dispatched)
+{
+    CheckBitKernels(libopencad::GetCADBitKernels());
+
+    if (libopencad::GetBMI2CADBitKernels())
+        CheckBitKernels(*libopencad::GetBMI2CADBitKernels());
+}
+
+
+TEST(bitkernels, bulkreader)
+{
+    // stream: 00110000 11000011 11|011000 1010|10|11 + 00000000
+    // contains: bitshorts 4035, 138, 0, 256
+    std::vector<unsigned char> buffer(4);
+    buffer[0] = 0b00110000;
+    buffer[1] = 0b11000011;
+    buffer[2] = 0b11011000;
+    buffer[3] = 0b10101011;
+
+    int16_t values[4];
+    libopencad::CADBitStreamReader reader(buffer);
+    reader.ReadBitShorts(values, 4);
+    ASSERT_EQ(4035, values[0]);
+    ASSERT_EQ(138, values[1]);
+    ASSERT_EQ(0, values[2]);
+    ASSERT_EQ(256, values[3]);
+    ASSERT_EQ(32, reader.GetOffset());
+    ASSERT_THROW(reader.ReadBitShorts(values, 1), std::runtime_error);
+}
+
+
+TEST(bitkernels, bulkvectors)
+{
+    // stream: 2RD (1.0, 2.0) | DD 00 | DD 10 + 6 bytes | BD 01 10 01
+    std::vector<unsigned char> buffer(24, 0);
+    buffer[6] = 0xF0;
+    buffer[7] = 0x3F;
+    buffer[15] = 0x40;
+
+    // 0b00 then 0b10, patch the low 48 bits of 2.0 with 0x0000_0000_0001 -> 2.0 + 1 ulp
+    buffer[16] = 0b00100000;
+    buffer[17] = 0b00010000;
+    buffer[22] = 0b00000110;
+    buffer[23] = 0b01000000;
+
+    double xy[4];
+    libopencad::CADBitStreamReader reader(buffer);
+    reader.ReadRawVectors(xy, 1);
+    ASSERT_EQ(1.0, xy[0]);
+    ASSERT_EQ(2.0, xy[1]);
+    ASSERT_EQ(128, reader.GetOffset());
+
+    // second vertex relative to the first one
+    reader.ReadBitDoublesWd(xy, xy + 2, 2);
+    ASSERT_EQ(1.0, xy[2]);
+    ASSERT_EQ(std::nextafter(2.0, 3.0), xy[3]);
+    ASSERT_EQ(128 + 2 + 2 + 48, reader.GetOffset());
+
+    double xyz[3];
+    reader.ReadVectors(xyz, 1);
+    ASSERT_EQ(1.0, xyz[0]);
+    ASSERT_EQ(0.0, xyz[1]);
+    ASSERT_EQ(1.0, xyz[2]);
+
+    ASSERT_THROW(reader.ReadRawDoubles(xyz, 1), std::runtime_error);
+}
+
+
+// Reads and discards one field of the given kind
+static void ReadField(libopencad::CADBitStreamReader& reader, libopencad::CADFieldKind kind)
+{
+    using libopencad::CADFieldKind;
+
+    switch (kind)
+    {
+    case CADFieldKind::BIT:          reader.ReadBit(); break;
+    case CADFieldKind::BITS2:        reader.Read2Bits(); break;
+    case CADFieldKind::BITS3:        reader.Read3Bits(); break;
+    case CADFieldKind::BITSHORT:     reader.ReadBitShort(); break;
+    case CADFieldKind::BITLONG:      reader.ReadBitLong(); break;
+    case CADFieldKind::BITDOUBLE:    reader.ReadBitDouble(); break;
+    case CADFieldKind::BITDOUBLEWD:  reader.ReadBitDoubleWd(0.0); break;
+    case CADFieldKind::RAWCHAR:      reader.ReadChar(); break;
+    case CADFieldKind::RAWSHORT:     reader.ReadRawShort(); break;
+    case CADFieldKind::RAWLONG:      reader.ReadRawLong(); break;
+    case CADFieldKind::RAWDOUBLE:    reader.ReadRawDouble(); break;
+    case CADFieldKind::MODULARCHAR:  reader.ReadMChar(); break;
+    case CADFieldKind::MODULARSHORT: reader.ReadMShort(); break;
+    case CADFieldKind::TEXT:         reader.ReadTv(); break;
+    case CADFieldKind::HANDLE:       reader.ReadHandle(); break;
+    case CADFieldKind::VECTOR:       reader.ReadVector(); break;
+    case CADFieldKind::RAWVECTOR:    reader.ReadRawVector(); break;
+    case CADFieldKind::THICKNESS:    if (!reader.ReadBit()) reader.ReadBitDouble(); break;
+    case CADFieldKind::EXTRUSION:    if (!reader.ReadBit()) reader.ReadVector(); break;
+    }
+}
+
+
+TEST(seekfields, all)
+{
+    const size_t kindsCount = static_cast<size_t>(libopencad::CADFieldKind::EXTRUSION) + 1;
+    std::mt19937 random(4242);
+
+    for (size_t idx = 0; idx < 2000; ++idx)
+    {
+        std::vector<unsigned char> buffer(1 + random() % 64);
+        for (size_t byteIdx = 0; byteIdx < buffer.size(); ++byteIdx)
+            buffer[byteIdx] = static_cast<unsigned char>(random());
+
+        std::vector<libopencad::CADFieldKind> fields(1 + random() % 8);
+        for (size_t fieldIdx = 0; fieldIdx < fields.size(); ++fieldIdx)
+            fields[fieldIdx] = static_cast<libopencad::CADFieldKind>(random() % kindsCount);
+
+        const size_t startOffset = random() % 8;
+
+        libopencad::CADBitStreamReader reference(buffer, startOffset);
+        bool expectThrow = false;
+        try
+        {
+            for (size_t fieldIdx = 0; fieldIdx < fields.size(); ++fieldIdx)
+                ReadField(reference, fields[fieldIdx]);
+        }
+        catch (std::runtime_error&)
+        {
+            expectThrow = true;
+        }
+
+        libopencad::CADBitStreamReader reader(buffer, startOffset);
+        if (expectThrow)
+        {
+            ASSERT_THROW(reader.SeekFields(fields.data(), fields.size()), std::runtime_error);
+        }
+        else
+        {
+            reader.SeekFields(fields.data(), fields.size());
+            ASSERT_EQ(reference.GetOffset(), reader.GetOffset());
+        }
+    }
+
+    // stream: 10|01|0000 0001|0110 1000|0000
+    // contains: BS 0, TV of 1 char
+    std::vector<unsigned char> buffer(3);
+    buffer[0] = 0b10010000;
+    buffer[1] = 0b00010110;
+    buffer[2] = 0b10000000;
+
+    libopencad::CADBitStreamReader reader(buffer);
+    reader.SeekFields({ libopencad::CADFieldKind::BITSHORT, libopencad::CADFieldKind::TEXT });
+    ASSERT_EQ(20, reader.GetOffset());
+}
+
+
+TEST(uncheckedreader, all)
+{
+    std::mt19937 random(99);
+    std::vector<unsigned char> buffer(64);
+    for (size_t idx = 0; idx < buffer.size(); ++idx)
+        buffer[idx] = static_cast<unsigned char>(random());
+
+    // identical to the checked reader inside of the data
+    libopencad::CADBitStreamReader checked(buffer);
+    libopencad::CADUncheckedBitStreamReader unchecked =
+        checked.SubReader<libopencad::CADUncheckedBounds>(0, buffer.size());
+    for (size_t idx = 0; idx < 20; ++idx)
+    {
+        ASSERT_EQ(checked.ReadBitShort(), unchecked.ReadBitShort());
+        ASSERT_EQ(checked.ReadMChar(), unchecked.ReadMChar());
+        ASSERT_EQ(checked.Read3Bits(), unchecked.Read3Bits());
+    }
+    ASSERT_EQ(checked.GetOffset(), unchecked.GetOffset());
+    ASSERT_FALSE(unchecked.IsOverrun());
+
+    // past the end: zeros and the overrun state instead of exceptions
+    libopencad::CADUncheckedBitStreamReader tail = checked.SubReader<libopencad::CADUncheckedBounds>(60, 4);
+    ASSERT_EQ(static_cast<int32_t>(buffer[60] | buffer[61] << 8 | buffer[62] << 16 | buffer[63] << 24),
+              tail.ReadRawLong());
+    ASSERT_FALSE(tail.IsOverrun());
+    ASSERT_EQ(0, tail.ReadRawShort());
+    ASSERT_TRUE(tail.IsOverrun());
+
+    double values[4] = { 1.0, 1.0, 1.0, 1.0 };
+    tail.ReadRawDoubles(values, 4);
+    ASSERT_EQ(0.0, values[3]);
+    ASSERT_TRUE(tail.IsOverrun());
+
+    // the object range itself is always validated
+    ASSERT_THROW(checked.SubReader<libopencad::CADUncheckedBounds>(60, 5), std::runtime_error);
+    ASSERT_THROW(tail.SetOffset(33), std::runtime_error);
+}
+
+
+TEST(stickyreader, all)
+{
+    std::mt19937 random(7);
+
+    // same values as the checked reader up to its exception, zeros after it
+    for (size_t idx = 0; idx < 200; ++idx)
+    {
+        std::vector<unsigned char> buffer(1 + random() % 32);
+        for (size_t byteIdx = 0; byteIdx < buffer.size(); ++byteIdx)
+            buffer[byteIdx] = static_cast<unsigned char>(random());
+
+        libopencad::CADBitStreamReader checked(buffer);
+        libopencad::CADStickyBitStreamReader sticky(buffer);
+        try
+        {
+            while (true)
+            {
+                int32_t value = sticky.ReadBitLong();
+                ASSERT_EQ(checked.ReadBitLong(), value);
+                double doubleValue = sticky.ReadBitDouble();
+                double expectedDouble = checked.ReadBitDouble();
+                ASSERT_EQ(0, std::memcmp(&expectedDouble, &doubleValue, sizeof(double)));
+                std::string text = sticky.ReadTv();
+                ASSERT_EQ(checked.ReadTv(), text);
+            }
+        }
+        catch (std::runtime_error&)
+        { }
+
+        // the checked reader stops at the start of the failed read
+        size_t failedAt = checked.GetOffset();
+        ASSERT_EQ(libopencad::CADReadError::OUT_OF_RANGE, sticky.GetError());
+        ASSERT_EQ(failedAt, sticky.GetErrorOffset());
+        ASSERT_EQ(0, sticky.ReadBitShort());
+        ASSERT_EQ(0, sticky.ReadRawLong());
+        ASSERT_EQ("", sticky.ReadTv());
+        ASSERT_EQ(failedAt, sticky.GetErrorOffset());
+    }
+
+    std::vector<unsigned char> buffer(8, 0xFF);
+    libopencad::CADStickyBitStreamReader reader(buffer);
+    ASSERT_EQ(libopencad::CADReadError::NONE, reader.GetError());
+
+    // the first error sticks
+    reader.SeekBits(60);
+    reader.Fail(libopencad::CADReadError::CORRUPTED_DATA);
+    reader.SetOffset(1000);
+    ASSERT_EQ(libopencad::CADReadError::CORRUPTED_DATA, reader.GetError());
+    ASSERT_EQ(60, reader.GetErrorOffset());
+
+    // bulk reads zero the values they cannot decode
+    double values[2] = { 1.0, 1.0 };
+    reader.ReadBitDoubles(values, 2);
+    ASSERT_EQ(0.0, values[0]);
+    ASSERT_EQ(0.0, values[1]);
+
+    // a bad sub-range gives an empty reader in the error state
+    libopencad::CADStickyBitStreamReader source(buffer);
+    libopencad::CADStickyBitStreamReader subReader = source.SubReader(4, 8);
+    ASSERT_EQ(libopencad::CADReadError::OUT_OF_RANGE, subReader.GetError());
+    ASSERT_EQ(0, subReader.ReadChar());
+    ASSERT_EQ(libopencad::CADReadError::NONE, source.GetError());
+}
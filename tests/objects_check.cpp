@@ -0,0 +1,581 @@
+#include "gtest/gtest.h"
+#include "internal/objects/cadentityschemas.hpp"
+#include "internal/io/cadspatialindex.hpp"
+
+#include <cstring>
+
+// Minimal DWG bit stream encoder for building test objects
+class TestBitWriter
+{
+public:
+    void WriteBits(uint64_t value, size_t bitsCount)
+    {
+        for (size_t idx = bitsCount; idx > 0; --idx)
+        {
+            if (_bitsCount % 8 == 0)
+                _buffer.push_back(0);
+
+            if ((value >> (idx - 1)) & 1)
+                _buffer.back() |= static_cast<unsigned char>(0x80 >> (_bitsCount % 8));
+            ++_bitsCount;
+        }
+    }
+
+    void WriteBit(bool value)
+    { WriteBits(value ? 1 : 0, 1); }
+
+    void WriteRawBytes(uint64_t value, size_t bytesCount)
+    {
+        for (size_t idx = 0; idx < bytesCount; ++idx)
+            WriteBits((value >> (idx * 8)) & 0xFF, 8);
+    }
+
+    void WriteRawDouble(double value)
+    { WriteRawBytes(Bits(value), 8); }
+
+    void WriteBitShort(int16_t value)
+    {
+        WriteBits(0, 2);
+        WriteRawBytes(static_cast<uint16_t>(value), 2);
+    }
+
+    void WriteBitLong(int32_t value)
+    {
+        if (value >= 0 && value < 256)
+        {
+            WriteBits(1, 2);
+            WriteRawBytes(static_cast<uint32_t>(value), 1);
+            return;
+        }
+
+        WriteBits(0, 2);
+        WriteRawBytes(static_cast<uint32_t>(value), 4);
+    }
+
+    void WriteBitDouble(double value)
+    {
+        if (value == 0.0)
+            WriteBits(2, 2);
+        else if (value == 1.0)
+            WriteBits(1, 2);
+        else
+        {
+            WriteBits(0, 2);
+            WriteRawDouble(value);
+        }
+    }
+
+    // Uses the shortest encoding, to exercise all of the DD codes
+    void WriteBitDoubleWd(double value, double defaultValue)
+    {
+        uint64_t bits = Bits(value);
+        uint64_t defaultBits = Bits(defaultValue);
+
+        if (bits == defaultBits)
+            WriteBits(0, 2);
+        else if ((bits >> 32) == (defaultBits >> 32))
+        {
+            WriteBits(1, 2);
+            WriteRawBytes(bits, 4);
+        }
+        else if ((bits >> 48) == (defaultBits >> 48))
+        {
+            WriteBits(2, 2);
+            WriteRawBytes(bits, 6);
+        }
+        else
+        {
+            WriteBits(3, 2);
+            WriteRawDouble(value);
+        }
+    }
+
+    void WriteVector(const libopencad::CADPoint3D& value)
+    {
+        WriteBitDouble(value.x);
+        WriteBitDouble(value.y);
+        WriteBitDouble(value.z);
+    }
+
+    void WriteThickness(double value)
+    {
+        WriteBit(value == 0.0);
+        if (value != 0.0)
+            WriteBitDouble(value);
+    }
+
+    void WriteExtrusion(const libopencad::CADPoint3D& value)
+    {
+        bool isDefault = value.x == 0.0 && value.y == 0.0 && value.z == 1.0;
+        WriteBit(isDefault);
+        if (!isDefault)
+            WriteVector(value);
+    }
+
+    void WriteTv(const std::string& value)
+    {
+        WriteBitShort(static_cast<int16_t>(value.size()));
+        for (size_t idx = 0; idx < value.size(); ++idx)
+            WriteBits(static_cast<unsigned char>(value[idx]), 8);
+    }
+
+    size_t GetBitsCount() const
+    { return _bitsCount; }
+
+    const std::vector<unsigned char>& GetBuffer() const
+    { return _buffer; }
+
+private:
+    static uint64_t Bits(double value)
+    {
+        uint64_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+private:
+    std::vector<unsigned char> _buffer;
+    size_t _bitsCount = 0;
+};
+
+
+static libopencad::CADPoint3D Point(double x, double y, double z)
+{
+    libopencad::CADPoint3D result;
+    result.x = x;
+    result.y = y;
+    result.z = z;
+    return result;
+}
+
+
+static void ExpectPoint(const libopencad::CADPoint3D& expected, const libopencad::CADPoint3D& value)
+{
+    ASSERT_EQ(expected.x, value.x);
+    ASSERT_EQ(expected.y, value.y);
+    ASSERT_EQ(expected.z, value.z);
+}
+
+
+// Skip has to stop exactly where Read stops
+template<typename Schema>
+static void ExpectSkipMatchesRead(const TestBitWriter& writer)
+{
+    libopencad::CADBitStreamReader reader(writer.GetBuffer());
+    Schema::Skip(reader);
+    ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+}
+
+
+TEST(objectschema, line)
+{
+    for (int zIsZero = 0; zIsZero < 2; ++zIsZero)
+    {
+        libopencad::CADPoint3D start = Point(10.5, -3.25, zIsZero ? 0.0 : 7.0);
+        libopencad::CADPoint3D end = Point(10.5000001, 1e6, zIsZero ? 0.0 : 7.0);
+
+        TestBitWriter writer;
+        writer.WriteBit(zIsZero != 0);
+        writer.WriteRawDouble(start.x);
+        writer.WriteBitDoubleWd(end.x, start.x);
+        writer.WriteRawDouble(start.y);
+        writer.WriteBitDoubleWd(end.y, start.y);
+        if (!zIsZero)
+        {
+            writer.WriteRawDouble(start.z);
+            writer.WriteBitDoubleWd(end.z, start.z);
+        }
+        writer.WriteThickness(2.0);
+        writer.WriteExtrusion(Point(0.0, 0.0, 1.0));
+
+        libopencad::CADBitStreamReader reader(writer.GetBuffer());
+        libopencad::CADLineData line = libopencad::CADLineSchema::Decode(reader);
+        ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+        ASSERT_EQ(zIsZero != 0, line.zIsZero);
+        ExpectPoint(start, line.start);
+        ExpectPoint(end, line.end);
+        ASSERT_EQ(2.0, line.thickness);
+        ExpectPoint(Point(0.0, 0.0, 1.0), line.extrusion);
+
+        ExpectSkipMatchesRead<libopencad::CADLineSchema>(writer);
+
+        // end point only, its DD defaults come from the start point
+        typedef libopencad::CADLineSchema Schema;
+        libopencad::CADLineData projected;
+        libopencad::CADBitStreamReader projectionReader(writer.GetBuffer());
+        Schema::Project<libopencad::CADFieldSet<Schema::START_X, Schema::END_X, Schema::START_Y, Schema::END_Y>>(
+            projectionReader, projected);
+        ASSERT_EQ(end.x, projected.end.x);
+        ASSERT_EQ(end.y, projected.end.y);
+        ASSERT_EQ(0.0, projected.thickness);
+    }
+}
+
+
+TEST(objectschema, circlearc)
+{
+    TestBitWriter writer;
+    writer.WriteVector(Point(1.0, 2.0, 0.0));
+    writer.WriteBitDouble(5.5);
+    writer.WriteThickness(0.0);
+    writer.WriteExtrusion(Point(0.0, 1.0, 0.0));
+    size_t circleEnd = writer.GetBitsCount();
+    writer.WriteBitDouble(0.25);
+    writer.WriteBitDouble(3.0);
+
+    libopencad::CADBitStreamReader reader(writer.GetBuffer());
+    libopencad::CADCircleData circle = libopencad::CADCircleSchema::Decode(reader);
+    ASSERT_EQ(circleEnd, reader.GetOffset());
+    ExpectPoint(Point(1.0, 2.0, 0.0), circle.center);
+    ASSERT_EQ(5.5, circle.radius);
+    ASSERT_EQ(0.0, circle.thickness);
+    ExpectPoint(Point(0.0, 1.0, 0.0), circle.extrusion);
+
+    reader.SetOffset(0);
+    libopencad::CADArcData arc = libopencad::CADArcSchema::Decode(reader);
+    ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+    ASSERT_EQ(5.5, arc.radius);
+    ASSERT_EQ(0.25, arc.startAngle);
+    ASSERT_EQ(3.0, arc.endAngle);
+
+    ExpectSkipMatchesRead<libopencad::CADArcSchema>(writer);
+
+    // radius only: the projection stops right after it
+    typedef libopencad::CADArcSchema Schema;
+    libopencad::CADArcData projected;
+    reader.SetOffset(0);
+    Schema::Project<libopencad::CADFieldSet<Schema::RADIUS>>(reader, projected);
+    ASSERT_EQ(5.5, projected.radius);
+    ASSERT_EQ(0.0, projected.center.x);
+}
+
+
+TEST(objectschema, lwpolyline)
+{
+    const int16_t flags = 0x04 | 0x01 | 0x10 | 0x20;
+    std::vector<libopencad::CADPoint2D> points(5);
+    for (size_t idx = 0; idx < points.size(); ++idx)
+    {
+        points[idx].x = 100.0 + idx * 0.125;
+        points[idx].y = idx % 2 ? -50.0 : 1e-3 * idx;
+    }
+
+    TestBitWriter writer;
+    writer.WriteBitShort(flags);
+    writer.WriteBitDouble(0.5);
+    writer.WriteVector(Point(0.0, 0.0, -1.0));
+    writer.WriteBitLong(static_cast<int32_t>(points.size()));
+    writer.WriteBitLong(2);
+    writer.WriteBitLong(1);
+    writer.WriteRawDouble(points[0].x);
+    writer.WriteRawDouble(points[0].y);
+    for (size_t idx = 1; idx < points.size(); ++idx)
+    {
+        writer.WriteBitDoubleWd(points[idx].x, points[idx - 1].x);
+        writer.WriteBitDoubleWd(points[idx].y, points[idx - 1].y);
+    }
+    writer.WriteBitDouble(1.0);
+    writer.WriteBitDouble(-0.5);
+    writer.WriteBitDouble(0.0);
+    writer.WriteBitDouble(2.0);
+
+    libopencad::CADBitStreamReader reader(writer.GetBuffer());
+    libopencad::CADLWPolylineData polyline = libopencad::CADLWPolylineSchema::Decode(reader);
+    ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+    ASSERT_EQ(flags, polyline.flags);
+    ASSERT_EQ(0.5, polyline.constWidth);
+    ExpectPoint(Point(0.0, 0.0, -1.0), polyline.normal);
+    ASSERT_EQ(points.size(), polyline.points.size());
+    for (size_t idx = 0; idx < points.size(); ++idx)
+    {
+        ASSERT_EQ(points[idx].x, polyline.points[idx].x);
+        ASSERT_EQ(points[idx].y, polyline.points[idx].y);
+    }
+    ASSERT_EQ(2, polyline.bulges.size());
+    ASSERT_EQ(-0.5, polyline.bulges[1]);
+    ASSERT_EQ(1, polyline.widths.size());
+    ASSERT_EQ(0.0, polyline.widths[0].start);
+    ASSERT_EQ(2.0, polyline.widths[0].end);
+
+    ExpectSkipMatchesRead<libopencad::CADLWPolylineSchema>(writer);
+
+    // vertices only, the flags and counts in front of them are still decoded
+    typedef libopencad::CADLWPolylineSchema Schema;
+    libopencad::CADLWPolylineData projected;
+    reader.SetOffset(0);
+    Schema::Project<libopencad::CADFieldSet<Schema::POINTS>>(reader, projected);
+    ASSERT_EQ(points.size(), projected.points.size());
+    ASSERT_EQ(points.back().y, projected.points.back().y);
+    ASSERT_EQ(0.0, projected.constWidth);
+    ASSERT_TRUE(projected.bulges.empty());
+}
+
+
+TEST(objectschema, lwpolylinecorrupted)
+{
+    TestBitWriter writer;
+    writer.WriteBitShort(0);
+    writer.WriteBitLong(1000000);
+    writer.WriteRawDouble(1.0);
+    writer.WriteRawDouble(2.0);
+
+    libopencad::CADBitStreamReader reader(writer.GetBuffer());
+    ASSERT_THROW(libopencad::CADLWPolylineSchema::Decode(reader), std::runtime_error);
+
+    reader.SetOffset(0);
+    ASSERT_THROW(libopencad::CADLWPolylineSchema::Skip(reader), std::runtime_error);
+}
+
+
+TEST(objectschema, text)
+{
+    const uint8_t dataFlagsVariants[] = { 0x00, 0xFF, 0x02 | 0x08 | 0x40 };
+
+    for (size_t variant = 0; variant < sizeof(dataFlagsVariants); ++variant)
+    {
+        uint8_t dataFlags = dataFlagsVariants[variant];
+
+        TestBitWriter writer;
+        writer.WriteBits(dataFlags, 8);
+        if (!(dataFlags & 0x01))
+            writer.WriteRawDouble(12.0);
+        writer.WriteRawDouble(3.0);
+        writer.WriteRawDouble(4.0);
+        if (!(dataFlags & 0x02))
+        {
+            writer.WriteBitDoubleWd(3.0, 3.0);
+            writer.WriteBitDoubleWd(9.0, 4.0);
+        }
+        writer.WriteExtrusion(Point(0.0, 0.0, 1.0));
+        writer.WriteThickness(0.0);
+        if (!(dataFlags & 0x04))
+            writer.WriteRawDouble(0.1);
+        if (!(dataFlags & 0x08))
+            writer.WriteRawDouble(1.5);
+        writer.WriteRawDouble(2.5);
+        if (!(dataFlags & 0x10))
+            writer.WriteRawDouble(0.8);
+        writer.WriteTv("libopencad");
+        if (!(dataFlags & 0x20))
+            writer.WriteBitShort(2);
+        if (!(dataFlags & 0x40))
+            writer.WriteBitShort(1);
+        if (!(dataFlags & 0x80))
+            writer.WriteBitShort(3);
+
+        libopencad::CADBitStreamReader reader(writer.GetBuffer());
+        libopencad::CADTextData text = libopencad::CADTextSchema::Decode(reader);
+        ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+        ASSERT_EQ(dataFlags, text.dataFlags);
+        ASSERT_EQ(dataFlags & 0x01 ? 0.0 : 12.0, text.elevation);
+        ASSERT_EQ(3.0, text.insertion.x);
+        ASSERT_EQ(4.0, text.insertion.y);
+        ASSERT_EQ(dataFlags & 0x02 ? 0.0 : 9.0, text.alignment.y);
+        ASSERT_EQ(dataFlags & 0x08 ? 0.0 : 1.5, text.rotationAngle);
+        ASSERT_EQ(2.5, text.height);
+        ASSERT_EQ(dataFlags & 0x10 ? 1.0 : 0.8, text.widthFactor);
+        ASSERT_EQ("libopencad", text.value);
+        ASSERT_EQ(dataFlags & 0x40 ? 0 : 1, text.horizontalAlignment);
+        ASSERT_EQ(dataFlags & 0x80 ? 0 : 3, text.verticalAlignment);
+
+        ExpectSkipMatchesRead<libopencad::CADTextSchema>(writer);
+
+        typedef libopencad::CADTextSchema Schema;
+        libopencad::CADTextData projected;
+        reader.SetOffset(0);
+        Schema::Project<libopencad::CADFieldSet<Schema::VALUE, Schema::HEIGHT>>(reader, projected);
+        ASSERT_EQ("libopencad", projected.value);
+        ASSERT_EQ(2.5, projected.height);
+        ASSERT_EQ(0.0, projected.insertion.x);
+    }
+}
+
+
+TEST(objectschema, insert)
+{
+    for (uint8_t scaleFlags = 0; scaleFlags < 4; ++scaleFlags)
+    {
+        libopencad::CADPoint3D scale = Point(scaleFlags & 1 ? 1.0 : 2.0, 0.0, 0.0);
+        if (scaleFlags & 2)
+        {
+            scale.y = scale.x;
+            scale.z = scale.x;
+        }
+        else
+        {
+            scale.y = -scale.x;
+            scale.z = scale.x;
+        }
+
+        TestBitWriter writer;
+        writer.WriteVector(Point(5.0, 6.0, 0.0));
+        writer.WriteBits(scaleFlags, 2);
+        if (!(scaleFlags & 1))
+            writer.WriteRawDouble(scale.x);
+        if (!(scaleFlags & 2))
+        {
+            writer.WriteBitDoubleWd(scale.y, scale.x);
+            writer.WriteBitDoubleWd(scale.z, scale.x);
+        }
+        writer.WriteBitDouble(0.75);
+        writer.WriteVector(Point(0.0, 0.0, 1.0));
+        writer.WriteBit(true);
+
+        libopencad::CADBitStreamReader reader(writer.GetBuffer());
+        libopencad::CADInsertData insert = libopencad::CADInsertSchema::Decode(reader);
+        ASSERT_EQ(writer.GetBitsCount(), reader.GetOffset());
+        ExpectPoint(Point(5.0, 6.0, 0.0), insert.insertion);
+        ExpectPoint(scale, insert.scale);
+        ASSERT_EQ(0.75, insert.rotation);
+        ASSERT_TRUE(insert.hasAttributes);
+
+        ExpectSkipMatchesRead<libopencad::CADInsertSchema>(writer);
+    }
+}
+
+
+TEST(objectschema, unchecked)
+{
+    TestBitWriter writer;
+    writer.WriteVector(Point(1.0, 2.0, 3.0));
+    writer.WriteBitDouble(5.5);
+    writer.WriteThickness(0.25);
+    writer.WriteExtrusion(Point(0.0, 0.0, 1.0));
+
+    std::vector<unsigned char> buffer = writer.GetBuffer();
+    libopencad::CADBitStreamReader reader(buffer);
+
+    libopencad::CADUncheckedBitStreamReader object =
+        reader.SubReader<libopencad::CADUncheckedBounds>(0, buffer.size());
+    libopencad::CADCircleData circle = libopencad::CADCircleSchema::Decode(object);
+    ASSERT_FALSE(object.IsOverrun());
+    ASSERT_EQ(5.5, circle.radius);
+    ASSERT_EQ(0.25, circle.thickness);
+
+    // truncated object: no exception, the overrun is reported at the object boundary
+    libopencad::CADUncheckedBitStreamReader truncated =
+        reader.SubReader<libopencad::CADUncheckedBounds>(0, buffer.size() / 2);
+    libopencad::CADCircleSchema::Decode(truncated);
+    ASSERT_TRUE(truncated.IsOverrun());
+
+    // truncated polyline with a huge vertex count does not allocate for it
+    TestBitWriter polyline;
+    polyline.WriteBitShort(0);
+    polyline.WriteBitLong(1000000);
+    libopencad::CADUncheckedBitStreamReader polylineReader(polyline.GetBuffer().data(), polyline.GetBuffer().size());
+    ASSERT_THROW(libopencad::CADLWPolylineSchema::Decode(polylineReader), std::runtime_error);
+}
+
+
+TEST(objectschema, decodeobjects)
+{
+    TestBitWriter writer;
+    writer.WriteVector(Point(1.0, 2.0, 3.0));
+    writer.WriteBitDouble(5.5);
+    writer.WriteThickness(0.0);
+    writer.WriteExtrusion(Point(0.0, 0.0, 1.0));
+    std::vector<unsigned char> object = writer.GetBuffer();
+
+    TestBitWriter corrupted;
+    corrupted.WriteBitShort(0);
+    corrupted.WriteBitLong(1000000);
+
+    std::vector<unsigned char> buffer = object;
+    buffer.insert(buffer.end(), corrupted.GetBuffer().begin(), corrupted.GetBuffer().end());
+    buffer.insert(buffer.end(), object.begin(), object.end());
+
+    std::vector<libopencad::CADByteRange> ranges;
+    ranges.push_back(libopencad::CADByteRange { 0, object.size() });
+    ranges.push_back(libopencad::CADByteRange { 0, object.size() / 2 });
+    ranges.push_back(libopencad::CADByteRange { buffer.size() - object.size() / 2, object.size() });
+
+    libopencad::CADBitStreamReader source(buffer);
+    auto circles = libopencad::DecodeCADObjects<libopencad::CADCircleSchema>(source, ranges);
+    ASSERT_EQ(3, circles.size());
+    ASSERT_TRUE(circles[0].status.IsOk());
+    ASSERT_EQ(5.5, circles[0].object.radius);
+    ASSERT_EQ(libopencad::CADReadError::OUT_OF_RANGE, circles[1].status.error);
+    ASSERT_EQ(libopencad::CADReadError::OUT_OF_RANGE, circles[2].status.error);
+
+    std::vector<libopencad::CADByteRange> polylineRanges;
+    polylineRanges.push_back(libopencad::CADByteRange { object.size(), corrupted.GetBuffer().size() });
+
+    auto polylines = libopencad::DecodeCADObjects<libopencad::CADLWPolylineSchema>(source, polylineRanges);
+    ASSERT_EQ(libopencad::CADReadError::CORRUPTED_DATA, polylines[0].status.error);
+    ASSERT_TRUE(polylines[0].object.points.empty());
+}
+
+
+TEST(spatialindex, extent)
+{
+    const double PI = 3.14159265358979323846;
+
+    // Upper half arc: through the top quadrant point, ends on the X axis
+    TestBitWriter arc;
+    arc.WriteVector(Point(75.0, 50.0, 0.0));
+    arc.WriteBitDouble(25.0);
+    arc.WriteThickness(0.0);
+    arc.WriteExtrusion(Point(0.0, 0.0, 1.0));
+    arc.WriteBitDouble(0.0);
+    arc.WriteBitDouble(PI);
+
+    libopencad::CADStickyBitStreamReader arcStream(arc.GetBuffer().data(), arc.GetBuffer().size());
+    libopencad::CADBoundingBox box = libopencad::ReadCADEntityExtent(arcStream, libopencad::CADObject::ARC);
+    ASSERT_NEAR(50.0, box.minX, 1e-9);
+    ASSERT_NEAR(50.0, box.minY, 1e-9);
+    ASSERT_NEAR(100.0, box.maxX, 1e-9);
+    ASSERT_NEAR(75.0, box.maxY, 1e-9);
+
+    // Arc wrapping through angle 0, from the bottom to the top quadrant point
+    TestBitWriter wrapped;
+    wrapped.WriteVector(Point(0.0, 0.0, 0.0));
+    wrapped.WriteBitDouble(2.0);
+    wrapped.WriteThickness(0.0);
+    wrapped.WriteExtrusion(Point(0.0, 0.0, 1.0));
+    wrapped.WriteBitDouble(1.5 * PI);
+    wrapped.WriteBitDouble(0.5 * PI);
+
+    libopencad::CADStickyBitStreamReader wrappedStream(wrapped.GetBuffer().data(), wrapped.GetBuffer().size());
+    box = libopencad::ReadCADEntityExtent(wrappedStream, libopencad::CADObject::ARC);
+    ASSERT_NEAR(0.0, box.minX, 1e-9);
+    ASSERT_NEAR(-2.0, box.minY, 1e-9);
+    ASSERT_NEAR(2.0, box.maxX, 1e-9);
+    ASSERT_NEAR(2.0, box.maxY, 1e-9);
+
+    // Text with its alignment point, default width factor: the margin is the height
+    // times the length plus one
+    TestBitWriter text;
+    text.WriteBits(0x01 | 0x04 | 0x08 | 0x10 | 0x20 | 0x40 | 0x80, 8);
+    text.WriteRawDouble(3.0);
+    text.WriteRawDouble(4.0);
+    text.WriteBitDoubleWd(7.0, 3.0);
+    text.WriteBitDoubleWd(6.0, 4.0);
+    text.WriteExtrusion(Point(0.0, 0.0, 1.0));
+    text.WriteThickness(0.0);
+    text.WriteRawDouble(2.5);
+    text.WriteTv("libopencad");
+
+    libopencad::CADStickyBitStreamReader textStream(text.GetBuffer().data(), text.GetBuffer().size());
+    box = libopencad::ReadCADEntityExtent(textStream, libopencad::CADObject::TEXT);
+    ASSERT_EQ(libopencad::CADReadError::NONE, textStream.GetError());
+    ASSERT_DOUBLE_EQ(3.0 - 27.5, box.minX);
+    ASSERT_DOUBLE_EQ(4.0 - 27.5, box.minY);
+    ASSERT_DOUBLE_EQ(7.0 + 27.5, box.maxX);
+    ASSERT_DOUBLE_EQ(6.0 + 27.5, box.maxY);
+
+    // A wide text reaches further
+    TestBitWriter wide;
+    wide.WriteBits(0x01 | 0x02 | 0x04 | 0x08 | 0x20 | 0x40 | 0x80, 8);
+    wide.WriteRawDouble(0.0);
+    wide.WriteRawDouble(0.0);
+    wide.WriteExtrusion(Point(0.0, 0.0, 1.0));
+    wide.WriteThickness(0.0);
+    wide.WriteRawDouble(1.0);
+    wide.WriteRawDouble(2.0);
+    wide.WriteTv("abc");
+
+    libopencad::CADStickyBitStreamReader wideStream(wide.GetBuffer().data(), wide.GetBuffer().size());
+    box = libopencad::ReadCADEntityExtent(wideStream, libopencad::CADObject::TEXT);
+    ASSERT_DOUBLE_EQ(-7.0, box.minX);
+    ASSERT_DOUBLE_EQ(7.0, box.maxY);
+}